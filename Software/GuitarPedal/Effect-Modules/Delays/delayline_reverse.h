@@ -23,6 +23,8 @@
 #pragma once
 #ifndef DELAY_REVERSE_H
 #define DELAY_REVERSE_H
+#include "../../Util/masked_delay_line.h"
+#include "../../Util/staged_delay_line.h"
 #include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -30,9 +32,22 @@
 //{
 /** Reverse Delay line
 By: Adam Fulford
+
+The buffer is rounded up to a power of two (see MaskedDelayLine) so the read and write heads wrap with a mask instead of a
+divide. Delay times are still limited to max_size.
+
+The ...From / ...To variants read and write through a StagedDelayLine set up with BeginStage(), for processing a block out
+of internal RAM.
 */
-template <typename T, size_t max_size> class DelayLineReverse {
+template <typename T, size_t max_size, typename Storage = bkshepherd::NativeStorage<T>> class DelayLineReverse {
   public:
+    typedef bkshepherd::StaticMaskedDelayLine<T, bkshepherd::NextPowerOfTwo(max_size), bkshepherd::LinearInterpolation, Storage>
+        Buffer;
+
+    /** Staging for the two reverse heads, they move one sample per sample, plus the samples just before the block which a head
+        reads after jumping to the write position */
+    template <size_t MaxBlockSize> using Stage = bkshepherd::StagedDelayLine<Buffer, 3, MaxBlockSize, MaxBlockSize>;
+
     DelayLineReverse() {}
     ~DelayLineReverse() {}
     /** initializes the delay line by clearing the values within, and setting delay to min time.
@@ -45,10 +60,7 @@ template <typename T, size_t max_size> class DelayLineReverse {
         delay1_ = 2400;  // min Reverse delay time
         fadetime = 2300; // in samples
 
-        for (size_t i = 0; i < max_size; i++) {
-            line_[i] = T(0);
-        }
-        write_ptr_ = 0;
+        line_.Init();
         read_ptr1_ = 0;
         read_ptr2_ = 0;
         headDiff_ = 0;
@@ -78,19 +90,19 @@ template <typename T, size_t max_size> class DelayLineReverse {
 
     /** writes the sample of type T to the delay line, and advances the write ptr
      */
-    inline void Write(const T sample) {
-        line_[write_ptr_] = sample;
+    inline void Write(const T sample) { WriteTo(line_, sample); }
+
+    template <typename Line> inline void WriteTo(Line &line, const T sample) {
         // advance write ptr in forward direction
-        write_ptr_ = (write_ptr_ + 1 + max_size) % max_size; // increment forwards
+        line.Write(sample);
 
-        // increment head difference
-        headDiff_ = (headDiff_ + 1 + delay1_) % delay1_;
+        // increment head difference, only divide when the delay was shortened below it
+        headDiff_ = headDiff_ + 1 < delay1_ ? headDiff_ + 1 : (headDiff_ + 1) % delay1_;
 
         // advance read ptrs in reverse direction
-        read_ptr1_ = (read_ptr1_ - 1 + max_size) %
-                     max_size; // KAB TODO I think this is where I would multipy the speed for reverse octave --NOPE
-        read_ptr2_ = (read_ptr2_ - 1 + max_size) % max_size; // KAB TODO I think this is where I would multipy the speed for reverse
-                                                             // octave --NOPE high pitch error sounding noise
+        read_ptr1_ = line.Wrap(read_ptr1_ - 1); // KAB TODO I think this is where I would multipy the speed for reverse octave --NOPE
+        read_ptr2_ = line.Wrap(read_ptr2_ - 1); // KAB TODO I think this is where I would multipy the speed for reverse
+                                                // octave --NOPE high pitch error sounding noise
 
         if (headDiff_ > (delay1_ - fadetime - 1)) // start cross fade region
         {
@@ -99,12 +111,12 @@ template <typename T, size_t max_size> class DelayLineReverse {
 
                 if (!playinghead_) {
                     // jump ptr2 to fadetime beyond write position
-                    read_ptr2_ = write_ptr_ - 1;
+                    read_ptr2_ = line.Wrap(line.GetWritePosition() - 1);
                 }
 
                 else {
                     // jump ptr1 to fadetime beyond write position
-                    read_ptr1_ = write_ptr_ - 1;
+                    read_ptr1_ = line.Wrap(line.GetWritePosition() - 1);
                 }
             }
 
@@ -140,12 +152,11 @@ template <typename T, size_t max_size> class DelayLineReverse {
 
     /** returns the next sample of type T in the delay line, interpolated if necessary.
      */
-    inline const T ReadRev() const {
-        T a1 = line_[read_ptr1_];
-        T a2 = line_[(read_ptr2_)];
+    inline const T ReadRev() const { return ReadRevFrom(line_); }
 
-        // T a1 = line_[read_ptr1_];
-        // T a2 = line_[(read_ptr2_)];
+    template <typename Line> inline const T ReadRevFrom(const Line &line) const {
+        T a1 = line.ReadPosition(read_ptr1_);
+        T a2 = line.ReadPosition(read_ptr2_);
 
         float read1 = a1;
         float read2 = a2;
@@ -169,19 +180,40 @@ template <typename T, size_t max_size> class DelayLineReverse {
      */
     inline const T ReadFwd() const // read forward as feedback signal
     {
-        T a = line_[(write_ptr_ * indexMultiplier_ + delay1_) % max_size];
-        T b = line_[(write_ptr_ * indexMultiplier_ + delay1_ + 1) % max_size];
+        const size_t write_ptr = line_.GetWritePosition();
+        T a = line_.ReadPosition(write_ptr * indexMultiplier_ + delay1_);
+        T b = line_.ReadPosition(write_ptr * indexMultiplier_ + delay1_ + 1);
         return a + (b - a) * frac1_;
     }
 
+    /** Starts a block on a stage and loads the spans the reverse heads cover over the next count samples
+        \param stage Stage<> to read and write through until stage.End()
+        \param count Number of samples in the block
+    */
+    template <typename StageType> void BeginStage(StageType &stage, size_t count) {
+        stage.Begin(line_);
+
+        stage.LoadSpan(0, read_ptr1_ - (count - 1), read_ptr1_);
+        stage.LoadSpan(1, read_ptr2_ - (count - 1), read_ptr2_);
+
+        // A cross fade starting in this block jumps a head to the write position, from where it reads back into the samples
+        // written before the block
+        if (!fading_ && headDiff_ + count > delay1_ - fadetime - 1) {
+            const size_t write_ptr = line_.GetWritePosition();
+            stage.LoadSpan(2, write_ptr - count, write_ptr - 1);
+        }
+    }
+
+    /** Underlying buffer, for staging */
+    Buffer &GetBuffer() { return line_; }
+
   private:
     float frac1_;
-    size_t write_ptr_;
     size_t read_ptr1_;
     size_t read_ptr2_;
     size_t delay1_;
     size_t headDiff_;
-    T line_[max_size];
+    Buffer line_;
     size_t fadetime;
     bool playinghead_;
     float fadepos_;
@@ -1,6 +1,8 @@
 #pragma once
 #ifndef DELAYLINE_REVOCT_H
 #define DELAYLINE_REVOCT_H
+#include "../../Util/masked_delay_line.h"
+#include "../../Util/staged_delay_line.h"
 #include <stdint.h>
 #include <stdlib.h>
 // namespace daisysp
@@ -15,9 +17,22 @@ declaration example: (1 second of floats)
 DelayLine<float, SAMPLE_RATE> del;
 
 By: shensley
+
+The buffer is rounded up to a power of two (see MaskedDelayLine) so reads and writes mask instead of dividing. Delay times
+are still limited to max_size, and the octave head still sweeps back over max_size samples, not over the whole buffer.
+
+The ...From / ...To variants read and write through a StagedDelayLine set up with BeginStage(), for processing a block out
+of internal RAM.
 */
-template <typename T, size_t max_size> class DelayLineRevOct {
+template <typename T, size_t max_size, typename Storage = bkshepherd::NativeStorage<T>> class DelayLineRevOct {
   public:
+    typedef bkshepherd::StaticMaskedDelayLine<T, bkshepherd::NextPowerOfTwo(max_size), bkshepherd::LinearInterpolation, Storage>
+        Buffer;
+
+    /** Staging for the main and second tap read heads, each window fits the octave head (two samples per sample) with room
+        left for the delay to glide */
+    template <size_t MaxBlockSize> using Stage = bkshepherd::StagedDelayLine<Buffer, 2, 4 * MaxBlockSize + 64, MaxBlockSize>;
+
     DelayLineRevOct() {}
     ~DelayLineRevOct() {}
     /** initializes the delay line by clearing the values within, and setting delay to 1 sample.
@@ -26,10 +41,8 @@ template <typename T, size_t max_size> class DelayLineRevOct {
     /** clears buffer, sets write ptr to 0, and delay to 1 sample.
      */
     void Reset() {
-        for (size_t i = 0; i < max_size; i++) {
-            line_[i] = T(0);
-        }
-        write_ptr_ = 0;
+        line_.Init();
+        sweep_ = 0;
         delay_ = 1;
         speed = 1;
         delay_secondTap = 1;
@@ -82,66 +95,119 @@ template <typename T, size_t max_size> class DelayLineRevOct {
 
     /** writes the sample of type T to the delay line, and advances the write ptr
      */
-    inline void Write(const T sample) {
-        line_[write_ptr_] = sample;
-        write_ptr_ = (write_ptr_ - 1 + max_size) % max_size;
+    inline void Write(const T sample) { WriteTo(line_, sample); }
+
+    template <typename Line> inline void WriteTo(Line &line, const T sample) {
+        line.Write(sample);
+        sweep_ = sweep_ + 1 < max_size ? sweep_ + 1 : 0;
     }
 
     /** returns the next sample of type T in the delay line, interpolated if necessary.
+        In octave mode the read head moves at twice the speed of the write head.
      */
-    inline const T Read() const {
-        T a = line_[(write_ptr_ * speed + delay_) % max_size];
-        T b = line_[(write_ptr_ * speed + delay_ + 1) % max_size];
-        return a + (b - a) * frac_;
+    inline const T Read() const { return ReadFrom(line_); }
+
+    template <typename Line> inline const T ReadFrom(const Line &line) const {
+        return ReadHead(line, delay_, frac_);
     }
 
-    inline const T ReadSecondTap() const {
+    inline const T ReadSecondTap() const { return ReadSecondTapFrom(line_); }
+
+    template <typename Line> inline const T ReadSecondTapFrom(const Line &line) const {
+        // TODO IS pointer correct? was  "write_ptr_ * speed + delay_secondTap"
+        return ReadHead(line, delay_ + delay_secondTap, frac_secondTap);
+    }
 
-        T c = line_[(write_ptr_ * speed + delay_ + delay_secondTap) %
-                    max_size]; // TODO IS pointer correct? was  "write_ptr_ * speed + delay_secondTap"
-        T d = line_[(write_ptr_ * speed + delay_ + delay_secondTap + 1) % max_size];
-        return c + (d - c) * frac_secondTap;
+    /** Starts a block on a stage and loads the spans the read heads cover over the next count samples
+        \param stage Stage<> to read and write through until stage.End()
+        \param count Number of samples in the block
+        \param delayMin, delayMax Range the delay time stays in over the block
+        \param secondTap Also load the span of the second tap
+    */
+    template <typename StageType> void BeginStage(StageType &stage, size_t count, float delayMin, float delayMax, bool secondTap) {
+        stage.Begin(line_);
+
+        // The heads move speed samples per sample. When the octave head sweeps back within the block the spans are off for the
+        // rest of it, those reads fall back to the line.
+        const size_t first = line_.GetWritePosition();
+        const size_t last = line_.GetWritePosition() + (count - 1) * speed;
+        const size_t shortest = ClampDelay(delayMin);
+        const size_t longest = ClampDelay(delayMax);
+
+        // The interpolation also reads the sample before the head
+        stage.LoadSpan(0, first - HeadDelay(longest) - 1, last - HeadDelay(shortest));
+        if (secondTap) {
+            stage.LoadSpan(1, first - HeadDelay(longest + ClampDelay(delayMax * secondTapFraction)) - 1,
+                           last - HeadDelay(shortest + ClampDelay(delayMin * secondTapFraction)));
+        }
     }
 
     /** Read from a set location */
     inline const T Read(float delay) const {
         int32_t delay_integral = static_cast<int32_t>(delay);
         float delay_fractional = delay - static_cast<float>(delay_integral);
-        const T a = line_[(write_ptr_ + delay_integral) % max_size];
-        const T b = line_[(write_ptr_ + delay_integral + 1) % max_size];
-        return a + (b - a) * delay_fractional;
+        return ReadLinear(line_.GetWritePosition() - delay_integral, delay_fractional);
     }
 
     inline const T ReadHermite(float delay) const {
         int32_t delay_integral = static_cast<int32_t>(delay);
         float delay_fractional = delay - static_cast<float>(delay_integral);
 
-        int32_t t = (write_ptr_ + delay_integral + max_size);
-        const T xm1 = line_[(t - 1) % max_size];
-        const T x0 = line_[(t) % max_size];
-        const T x1 = line_[(t + 1) % max_size];
-        const T x2 = line_[(t + 2) % max_size];
-        const float c = (x1 - xm1) * 0.5f;
-        const float v = x0 - x1;
-        const float w = c + v;
-        const float a = w + v + (x2 - x0) * 0.5f;
-        const float b_neg = w + a;
-        const float f = delay_fractional;
-        return (((a * f) - b_neg) * f + c) * f + x0;
+        const size_t t = line_.GetWritePosition() - delay_integral;
+        return bkshepherd::CubicInterpolation::Interpolate(line_.ReadPosition(t + 1), line_.ReadPosition(t), line_.ReadPosition(t - 1),
+                                                           line_.ReadPosition(t - 2), delay_fractional);
     }
 
     inline const T Allpass(const T sample, size_t delay, const T coefficient) {
-        T read = line_[(write_ptr_ + delay) % max_size];
+        T read = line_.Read(delay);
         T write = sample + coefficient * read;
         Write(write);
         return -write * coefficient + read;
     }
 
+    /** Underlying buffer, for staging */
+    Buffer &GetBuffer() { return line_; }
+
   private:
+    // Reads between position and the sample before it (the older one)
+    inline const T ReadLinear(size_t position, float frac) const { return ReadLinear(line_, position, frac); }
+
+    template <typename Line> inline const T ReadLinear(const Line &line, size_t position, float frac) const {
+        const T a = line.ReadPosition(position);
+        const T b = line.ReadPosition(position - 1);
+        return a + (b - a) * frac;
+    }
+
+    // Reads a head between the sample at its delay and the one before it, the oldest sample is followed by the newest
+    template <typename Line> inline const T ReadHead(const Line &line, size_t delay, float frac) const {
+        const size_t age = HeadDelay(delay);
+        const T a = line.ReadPosition(line.GetWritePosition() - age);
+        const T b = line.ReadPosition(line.GetWritePosition() - (age < max_size ? age + 1 : 1));
+        return a + (b - a) * frac;
+    }
+
+    // Age of the sample under a head with the given delay, between 1 and max_size. The octave head gets one sample closer to
+    // the write head per sample and jumps back by max_size when it reaches it, the same sweep as the original modulo line.
+    inline size_t HeadDelay(size_t delay) const {
+        size_t age = delay + max_size - (speed == 2 ? sweep_ : 0);
+        while (age > max_size) {
+            age -= max_size;
+        }
+        return age;
+    }
+
+    inline size_t ClampDelay(float delay) const {
+        const int32_t int_delay = static_cast<int32_t>(delay);
+        if (int_delay < 0) {
+            return 0;
+        }
+        return static_cast<size_t>(int_delay) < max_size ? int_delay : max_size - 1;
+    }
+
     float frac_;
-    size_t write_ptr_;
     size_t delay_;
-    T line_[max_size];
+    size_t sweep_; // Samples written since the octave head last swept back, wraps at max_size
+    Buffer line_;
     int speed; // Either 1 or 2
 
     float frac_secondTap;
@@ -6,10 +6,13 @@ constexpr bool showCPU = false;
 
 using namespace bkshepherd;
 
+// What effects read before they are given the shared analysis
+static const SignalAnalysis s_silentAnalysis = {};
+
 // Default Constructor
 BaseEffectModule::BaseEffectModule()
     : m_paramCount(0), m_presetCount(1), m_currentPreset(0), m_params(nullptr), m_audioLeft(0.0f), m_audioRight(0.0f),
-      m_settingsArrayStartIdx(0), m_isEnabled(false) {
+      m_settingsArrayStartIdx(0), m_isEnabled(false), m_hasSharedMemory(false), m_signalAnalysis(&s_silentAnalysis) {
     m_name = "Base";
     m_paramMetaData = nullptr;
 }
@@ -378,6 +381,26 @@ void BaseEffectModule::ProcessStereo(float inL, float inR) {
     m_audioRight = inR;
 }
 
+void BaseEffectModule::ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        ProcessMono(in[i]);
+        outL[i] = m_audioLeft;
+        outR[i] = m_audioRight;
+    }
+}
+
+void BaseEffectModule::ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        ProcessStereo(inL[i], inR[i]);
+        outL[i] = m_audioLeft;
+        outR[i] = m_audioRight;
+    }
+}
+
+void BaseEffectModule::SetSignalAnalysis(const SignalAnalysis *analysis) {
+    m_signalAnalysis = analysis != nullptr ? analysis : &s_silentAnalysis;
+}
+
 float BaseEffectModule::GetAudioLeft() const { return m_audioLeft; }
 
 float BaseEffectModule::GetAudioRight() const { return m_audioRight; }
@@ -410,6 +433,29 @@ void BaseEffectModule::ParameterChanged(int parameter_id) {
     // Do nothing.
 }
 
+bool BaseEffectModule::AcquireSharedMemory(MemoryArena &arena) {
+    // Only flagged once everything is set up, the audio callback may look at it any time
+    m_hasSharedMemory = OnAcquireSharedMemory(arena);
+    return m_hasSharedMemory;
+}
+
+void BaseEffectModule::ReleaseSharedMemory() {
+    // Stop the processing first, the arena is reused as soon as this returns
+    m_hasSharedMemory = false;
+    OnReleaseSharedMemory();
+}
+
+bool BaseEffectModule::OnAcquireSharedMemory(MemoryArena &arena) {
+    // Do nothing.
+
+    // Most effects keep their state in the module itself and don't need the arena.
+    return true;
+}
+
+void BaseEffectModule::OnReleaseSharedMemory() {
+    // Do nothing.
+}
+
 void BaseEffectModule::MidiCCValueNotification(uint8_t control_num, uint8_t value) {
     // Handle the incoming Midi CC Value Notification if needed
     int effectParamID = GetMappedParameterIDForMidiCC(control_num);
@@ -2,6 +2,8 @@
 #ifndef BASE_EFFECT_MODULE_H
 #define BASE_EFFECT_MODULE_H
 
+#include "../Util/memory_arena.h"
+#include "../Util/signal_analysis.h"
 #include "daisy_seed.h"
 #include <stdint.h>
 #ifdef __cplusplus
@@ -228,6 +230,19 @@ class BaseEffectModule {
     */
     virtual void ProcessStereo(float inL, float inR);
 
+    /** Processes the Effect in Mono for a whole audio block.  The default implementation calls ProcessMono once per sample, effects
+     that work on buffers can override this to process the block in one pass. Don't mix calls with ProcessMono / ProcessStereoBlock.
+     \param in Input block. \param outL, outR Output blocks for the Left and Right channels. \param size Number of samples in the block.
+    */
+    virtual void ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size);
+
+    /** Processes the Effect in Stereo for a whole audio block.  The default implementation calls ProcessStereo once per sample,
+     effects that work on buffers can override this to process the block in one pass. Don't mix calls with ProcessStereo /
+     ProcessMonoBlock. \param inL, inR Input blocks Left and Right. \param outL, outR Output blocks Left and Right. \param size Number
+     of samples in the block.
+    */
+    virtual void ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size);
+
     /**  Gets the most recently calculated Sample Value for the Left Stereo Channel (or Mono)
      \return Last floating point sample for the left channel.
     */
@@ -308,10 +323,47 @@ class BaseEffectModule {
     /** Overridable callback when alternate footswitch is held for 1 second */
     virtual void AlternateFootswitchHeldFor1Second(){};
 
+    /** Leases the effect its buffers from the shared SDRAM arena, called when the effect becomes the active one. Only the
+     * active effect holds memory in the arena, so it is sized for the largest effect instead of the sum of all of them.
+     * \param arena The shared arena, reset for this effect.
+     * \return true if the effect got everything it needs. If it didn't the effect keeps passing the dry signal through.
+     */
+    bool AcquireSharedMemory(MemoryArena &arena);
+
+    /** Hands the leased buffers back, called before the arena is reset for the next active effect. */
+    void ReleaseSharedMemory();
+
+    /** Returns if the effect holds the memory it needs, effects aren't processed without it
+     \return Value True once AcquireSharedMemory succeeded and until ReleaseSharedMemory is called
+    */
+    bool HasSharedMemory() const { return m_hasSharedMemory; }
+
+    /** Returns if the effect allocates from the shared arena (overrides OnAcquireSharedMemory). Effects that don't are
+     activated without taking the arena from its owner, so the owner's buffers (a loop, delay tails) are still there when it
+     is selected again
+     \return Value False by default
+    */
+    virtual bool UsesSharedMemory() const { return false; }
+
     void SetCPUUsage(float cpuUsage) { m_cpuUsage = cpuUsage; };
     float GetCPUUsage() const { return m_cpuUsage; }
 
+    /** Sets the analysis of the input the effect reads, updated by the audio callback before every block it processes.
+     * Until it is set the effect reads an analysis of silence.
+     * \param analysis Analysis that outlives the effect, nullptr goes back to silence.
+     */
+    void SetSignalAnalysis(const SignalAnalysis *analysis);
+
+    /** Effects that read the frequency of the signal analysis override this and return true, pitch detection only runs while
+     * the active effect needs it.
+     * \return Value True if the effect needs the pitch of the input
+     */
+    virtual bool NeedsPitchAnalysis() const { return false; }
+
   protected:
+    /** Analysis of the input of the block being processed, see SignalAnalysis */
+    const SignalAnalysis &GetSignalAnalysis() const { return *m_signalAnalysis; }
+
     /** Initializes the Parameter Storage and creates space for the specified number of stored Effect Parameters
         \param count  The number of stored parameters
     */
@@ -324,6 +376,17 @@ class BaseEffectModule {
      */
     virtual void ParameterChanged(int parameter_id);
 
+    /** This function gets called when the effect is given the shared SDRAM arena. Effects with large buffers override it to
+     * allocate them from the arena and to (re)initialize everything that points into them, including any state set up from
+     * the parameters. Nothing in the arena survives deactivation. By default it does nothing.
+     * @param arena  The arena to allocate from.
+     * @return false if an allocation failed.
+     */
+    virtual bool OnAcquireSharedMemory(MemoryArena &arena);
+
+    /** This function gets called before the shared arena is taken back, effects drop their pointers into it here. */
+    virtual void OnReleaseSharedMemory();
+
     float GetSampleRate() const { return m_sampleRate; }
 
     const char *m_name;                       // Name of the Effect
@@ -337,8 +400,10 @@ class BaseEffectModule {
     uint32_t m_settingsArrayStartIdx;         // Start index of settings persistent storage struct
   private:
     bool m_isEnabled;
-    float m_sampleRate; // Current Sample Rate this Effect was initialized for.
-    float m_cpuUsage;   // CPU usage of the audio callback, can be used for rendering to display
+    volatile bool m_hasSharedMemory;        // Checked from the audio callback while the main loop swaps the lease
+    const SignalAnalysis *m_signalAnalysis; // Shared analysis of the input, see SetSignalAnalysis
+    float m_sampleRate;                     // Current Sample Rate this Effect was initialized for.
+    float m_cpuUsage;                       // CPU usage of the audio callback, can be used for rendering to display
 };
 } // namespace bkshepherd
 #endif
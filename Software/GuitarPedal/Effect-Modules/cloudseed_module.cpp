@@ -1,27 +1,15 @@
 #include "cloudseed_module.h"
 #include "../Util/audio_utilities.h"
-
-// This is used in the modified CloudSeed code for allocating
-// delay line memory to SDRAM (64MB available on Daisy)
-// #define CUSTOM_POOL_SIZE (48*1024*1024)
-// #define CUSTOM_POOL_SIZE (48*512*512) // works
-#define CUSTOM_POOL_SIZE (48 * 384 * 384) // Works! test more thoroughly with other presets, if it freezes, check here first TODO
-// #define CUSTOM_POOL_SIZE (48*256*256) // freezes
-
-DSY_SDRAM_BSS char custom_pool[CUSTOM_POOL_SIZE];
-size_t pool_index = 0;
-int allocation_count = 0;
-void *custom_pool_allocate(size_t size) {
-    if (pool_index + size >= CUSTOM_POOL_SIZE) {
-        return 0;
-    }
-    void *ptr = &custom_pool[pool_index];
-    pool_index += size;
-    return ptr;
-}
+#include "../Util/memory_arena.h"
 
 using namespace bkshepherd;
 
+// This is used in the modified CloudSeed code for allocating delay line memory to SDRAM (64MB available on Daisy).
+// The pool is leased from the shared SDRAM while the effect is active and is sized from the reverb configuration.
+static MemoryArena s_customPoolArena;
+
+void *custom_pool_allocate(size_t size) { return s_customPoolArena.Allocate(size, CloudSeed::Utils::PoolAlignment); }
+
 static const char *s_presetNames[8] = {"FChorus", "DullEchos", "Hyperplane", "MedSpace", "Hallway", "RubiKa", "SmallRoom", "90s"};
 
 static const int s_paramCount = 11;
@@ -80,8 +68,9 @@ static ParameterMetaData s_metaData[s_paramCount] = {
 //        Mostly these:  LineCount, LateDiffusionStages      And to a lesser degree these:  DiffusionStages, TapCount (Added tapcount
 //        as param, halved the full range)
 //     Increasing the above params past what I have them set at in "ReverbController.h" may freeze the pedal processing.
-//     Currently the max stereo line count is 2 on the Daisy Seed, so the presets will sound different than the desktop CloudSeed
-//     plugin.
+//     The late reverb lines are processed together (see DelayLineBank.h) and the reverb runs on whole audio blocks, which should
+//     leave room for more than the s_reverbLineCount stereo lines used now, but that needs a cycle count on the Daisy Seed
+//     first. The desktop CloudSeed plugin uses up to 12, so the presets will still sound a bit different.
 
 // Default Constructor
 CloudSeedModule::CloudSeedModule() : BaseEffectModule(), m_gainMin(0.0f), m_gainMax(1.0f), m_cachedEffectMagnitudeValue(1.0f) {
@@ -96,9 +85,7 @@ CloudSeedModule::CloudSeedModule() : BaseEffectModule(), m_gainMin(0.0f), m_gain
 }
 
 // Destructor
-CloudSeedModule::~CloudSeedModule() {
-    // No Code Needed
-}
+CloudSeedModule::~CloudSeedModule() { DestroyReverb(); }
 
 void CloudSeedModule::Init(float sample_rate) {
     BaseEffectModule::Init(sample_rate);
@@ -106,16 +93,87 @@ void CloudSeedModule::Init(float sample_rate) {
     AudioLib::ValueTables::Init();
     CloudSeed::FastSin::Init();
 
-    reverb = new CloudSeed::ReverbController(sample_rate);
-    reverb->ClearBuffers();
-    reverb->initFactoryRubiKaFields();                // Not setting a preset at the beginning allows you to save the previous preset
-    reverb->SetParameter(::Parameter2::LineCount, 3); // 2 on factory chorus for stereo is max, 3 froze it
+    // The reverb is built once, only its audio buffers come from the custom pool when it is leased (see OnAcquireSharedMemory)
+    CreateReverb(sample_rate);
     CalculateMix();
 }
 
+bool CloudSeedModule::OnAcquireSharedMemory(MemoryArena &arena) {
+    void *pool = arena.Allocate(s_sharedMemorySize);
+
+    if (pool == nullptr) {
+        return false;
+    }
+
+    s_customPoolArena.Init(pool, s_sharedMemorySize);
+
+    // Without a reverb the effect passes the dry signal through, like it does when the configuration doesn't fit the pool
+    if (reverb == nullptr) {
+        return true;
+    }
+
+    // The buffers held whatever the previous owner of the shared memory left in them
+    reverb->AllocateBuffers();
+    reverb->ClearBuffers();
+
+    // Reload the selected preset (and the knobs on top if they override it), its seed series are cached since Init
+    ParameterChanged(6);
+
+    return true;
+}
+
+void CloudSeedModule::OnReleaseSharedMemory() {
+    if (reverb != nullptr) {
+        reverb->ReleaseBuffers();
+    }
+
+    // Nothing else lives in the pool, so it can be fully released. Failures are kept to be reported.
+    s_customPoolArena.Reset();
+}
+
+void CloudSeedModule::CreateReverb(float sample_rate) {
+    DestroyReverb();
+
+    // Check that the configuration fits in the pool, drop lines until it does
+    const int samplerate = static_cast<int>(sample_rate);
+    int lineCount = s_reverbLineCount;
+    while (lineCount > 1 && CloudSeed::ReverbController::RequiredPoolBytes(samplerate, lineCount) > s_sharedMemorySize) {
+        lineCount--;
+    }
+
+    if (CloudSeed::ReverbController::RequiredPoolBytes(samplerate, lineCount) > s_sharedMemorySize) {
+        // Doesn't fit at all, the effect passes the dry signal through instead of crashing on a failed allocation
+        m_reverbLineCount = 0;
+        return;
+    }
+
+    m_reverbLineCount = lineCount;
+    reverb = new CloudSeed::ReverbController(samplerate, m_reverbLineCount);
+
+    // Load every factory preset once so the seed series they use are in the ShaRandom cache, switching presets later on
+    // then only has to look them up instead of hashing while the footswitch is pressed
+    for (int preset = 0; preset < s_factoryPresetCount; preset++) {
+        LoadFactoryPreset(preset);
+    }
+
+    reverb->initFactoryRubiKaFields(); // Not setting a preset at the beginning allows you to save the previous preset
+    reverb->SetParameter(::Parameter2::LineCount, m_reverbLineCount);
+}
+
+void CloudSeedModule::DestroyReverb() {
+    if (reverb != nullptr) {
+        delete reverb;
+        reverb = nullptr;
+    }
+}
+
 void CloudSeedModule::ParameterChanged(int parameter_id) // Somewhere here is causeing issues on start up, if I take them out it works,
                                                          // adding them in breaks, but it worked once???
 {
+    if (reverb == nullptr) {
+        return;
+    }
+
     if (parameter_id == 6) { // Preset
         // Change the preset and then override with current knob settings
         changePreset();
@@ -192,24 +250,30 @@ void CloudSeedModule::AlternateFootswitchPressed() {
 
 void CloudSeedModule::changePreset() {
 
-    int c = (GetParameterAsBinnedValue(6) - 1);
+    if (reverb == nullptr) {
+        return;
+    }
+
     reverb->ClearBuffers();
+    LoadFactoryPreset(GetParameterAsBinnedValue(6) - 1);
+}
 
-    if (c == 0) {
+void CloudSeedModule::LoadFactoryPreset(int preset) {
+    if (preset == 0) {
         reverb->initFactoryChorus();
-    } else if (c == 1) {
+    } else if (preset == 1) {
         reverb->initFactoryDullEchos();
-    } else if (c == 2) {
+    } else if (preset == 2) {
         reverb->initFactoryHyperplane();
-    } else if (c == 3) {
+    } else if (preset == 3) {
         reverb->initFactoryMediumSpace();
-    } else if (c == 4) {
+    } else if (preset == 4) {
         reverb->initFactoryNoiseInTheHallway();
-    } else if (c == 5) {
+    } else if (preset == 5) {
         reverb->initFactoryRubiKaFields();
-    } else if (c == 6) {
+    } else if (preset == 6) {
         reverb->initFactorySmallRoom();
-    } else if (c == 7) {
+    } else if (preset == 7) {
         reverb->initFactory90sAreBack();
     }
 }
@@ -233,73 +297,85 @@ CloudSeedModule::Mix CloudSeedModule::CalculateMix(float mixValue) {
     return Mix{wetMix, dryMix};
 }
 
-static float inMuted[1] = {0};
+// Silent input used for the reverb when the wet input is muted, sized for one audio block
+static constexpr size_t s_maxBlockSize = 48;
+static float s_inMuted[s_maxBlockSize] = {0};
 
 void CloudSeedModule::ProcessMono(float in) {
     BaseEffectModule::ProcessMono(in);
 
-    float inL[1];
-    float outL[1];
-    float inR[1];
-    float outR[1];
+    float outL;
+    float outR;
+    ProcessMonoBlock(&in, &outL, &outR, 1);
 
-    inL[0] = m_audioLeft;
-    inR[0] = m_audioLeft;
+    m_audioLeft = outL;
+    m_audioRight = outR;
+}
 
-    if (inputMuteForWet) {
-        reverb->Process(inMuted, inMuted, outL, outR, 1);
-    } else {
-        reverb->Process(inL, inR, outL, outR, 1);
-    }
+void CloudSeedModule::ProcessStereo(float inL, float inR) {
+    BaseEffectModule::ProcessStereo(inL, inR);
 
-    // Gradually ramp dryMix if transition is active
-    if (linearChangeDryLevel.isActive()) {
-        currentMix.dry = linearChangeDryLevel.getNextValue();
-    }
+    float outL;
+    float outR;
+    ProcessStereoBlock(&inL, &inR, &outL, &outR, 1);
 
-    if (GetParameterAsBool(7)) { // If "Sum2Mono" is on, combine L and R signals and half the level
-        m_audioLeft = ((outL[0] + outR[0]) / 2.0) * currentMix.wet + inL[0] * currentMix.dry;
-        m_audioRight = m_audioLeft;
-    } else {
-        m_audioLeft = outL[0] * currentMix.wet + inL[0] * currentMix.dry;
-        m_audioRight = outR[0] * currentMix.wet + inR[0] * currentMix.dry;
-    }
+    m_audioLeft = outL;
+    m_audioRight = outR;
 }
 
-void CloudSeedModule::ProcessStereo(float inL, float inR) {
-    // Calculate the mono effect
-    // ProcessMono(inL);
-    BaseEffectModule::ProcessStereo(inL, inR);
+void CloudSeedModule::ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) {
+    ProcessReverb(in, in, outL, outR, size);
+    MixBlock(in, in, outL, outR, size);
+}
 
-    float inL2[1];
-    float outL[1];
-    float inR2[1];
-    float outR[1];
+void CloudSeedModule::ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) {
+    // If Stereo In is false, the left input feeds both reverb channels (TODO Verify this works)
+    const float *inR2 = GetParameterAsBool(8) ? inR : inL;
 
-    inL2[0] = m_audioLeft;
-    if (GetParameterAsBool(8)) { // If Stereo In is true (TODO Verify this works)
-        inR2[0] = m_audioRight;
-    } else {
-        inR2[0] = m_audioLeft;
+    ProcessReverb(inL, inR2, outL, outR, size);
+    MixBlock(inL, inR2, outL, outR, size);
+}
+
+void CloudSeedModule::ProcessReverb(const float *inL, const float *inR, float *outL, float *outR, size_t size) {
+    if (reverb == nullptr) {
+        for (size_t i = 0; i < size; i++) {
+            outL[i] = 0.0f;
+            outR[i] = 0.0f;
+        }
+        return;
     }
 
-    if (inputMuteForWet) {
-        reverb->Process(inMuted, inMuted, outL, outR, 1);
-    } else {
-        reverb->Process(inL2, inR2, outL, outR, 1);
+    if (!inputMuteForWet) {
+        // The reverb only reads from the input buffers
+        reverb->Process(const_cast<float *>(inL), const_cast<float *>(inR), outL, outR, size);
+        return;
     }
 
-    // Gradually ramp dryMix if transition is active
-    if (linearChangeDryLevel.isActive()) {
-        currentMix.dry = linearChangeDryLevel.getNextValue();
+    while (size > 0) {
+        const size_t count = size < s_maxBlockSize ? size : s_maxBlockSize;
+        reverb->Process(s_inMuted, s_inMuted, outL, outR, count);
+        outL += count;
+        outR += count;
+        size -= count;
     }
+}
 
-    if (GetParameterAsBool(7)) { // If "Sum2Mono" is on, combine L and R signals and half the level
-        m_audioLeft = ((outL[0] + outR[0]) / 2.0) * currentMix.wet + inL2[0] * currentMix.dry;
-        m_audioRight = m_audioLeft;
-    } else {
-        m_audioLeft = outL[0] * currentMix.wet + inL2[0] * currentMix.dry;
-        m_audioRight = outR[0] * currentMix.wet + inR2[0] * currentMix.dry;
+void CloudSeedModule::MixBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) {
+    const bool sumToMono = GetParameterAsBool(7);
+
+    for (size_t i = 0; i < size; i++) {
+        // Gradually ramp dryMix if transition is active
+        if (linearChangeDryLevel.isActive()) {
+            currentMix.dry = linearChangeDryLevel.getNextValue();
+        }
+
+        if (sumToMono) { // If "Sum2Mono" is on, combine L and R signals and half the level
+            outL[i] = ((outL[i] + outR[i]) / 2.0) * currentMix.wet + inL[i] * currentMix.dry;
+            outR[i] = outL[i];
+        } else {
+            outL[i] = outL[i] * currentMix.wet + inL[i] * currentMix.dry;
+            outR[i] = outR[i] * currentMix.wet + inR[i] * currentMix.dry;
+        }
     }
 }
 
@@ -321,4 +397,25 @@ float CloudSeedModule::GetBrightnessForLED(int led_id) const {
     }
 
     return value;
-}
\ No newline at end of file
+}
+
+void CloudSeedModule::DrawUI(OneBitGraphicsDisplay &display, int currentIndex, int numItemsTotal, Rectangle boundsToDrawIn,
+                             bool isEditing) {
+    BaseEffectModule::DrawUI(display, currentIndex, numItemsTotal, boundsToDrawIn, isEditing);
+
+    // Nothing to report until the custom pool is leased
+    if (!HasSharedMemory()) {
+        return;
+    }
+
+    // Report how the reverb fits the custom pool, a failed allocation means the pool is sized too small for the presets
+    char strbuff[64];
+    if (m_reverbLineCount == 0) {
+        sprintf(strbuff, "No room, dry only");
+    } else if (s_customPoolArena.HasFailed()) {
+        sprintf(strbuff, "Pool full %lu", static_cast<unsigned long>(s_customPoolArena.GetFailedCount()));
+    } else {
+        sprintf(strbuff, "%d lines %uKB", m_reverbLineCount, static_cast<unsigned int>(s_customPoolArena.GetHighWaterMark() / 1024));
+    }
+    display.WriteStringAligned(strbuff, Font_7x10, boundsToDrawIn, Alignment::bottomCentered, true);
+}
@@ -2,6 +2,7 @@
 #ifndef CLOUDSEED_MODULE_H
 #define CLOUDSEED_MODULE_H
 
+#include "../Util/memory_arena.h"
 #include "base_effect_module.h"
 #include "linear_change.h"
 #include "daisysp.h"
@@ -26,14 +27,33 @@ class CloudSeedModule : public BaseEffectModule {
     CloudSeedModule();
     ~CloudSeedModule();
 
+    // Number of late reverb delay lines per channel, each one takes about 540KB of the custom pool. 3 is what is known to fit
+    // the audio callback on the Daisy Seed, the line bank takes up to DelayLineBank::MaxLineCount but more lines have to be
+    // timed on the pedal first (more than 3 used to freeze it)
+    static constexpr int s_reverbLineCount = 3;
+
+    // Highest sample rate the custom pool is sized for, higher rates will drop late reverb lines until it fits
+    static constexpr int s_poolSampleRate = 48000;
+
+    // Shared SDRAM taken while the effect is active, all of it backs the CloudSeed custom pool
+    static constexpr size_t s_sharedMemorySize =
+        MemoryArena::AlignedSize(CloudSeed::ReverbController::RequiredPoolBytes(s_poolSampleRate, s_reverbLineCount));
+
     void Init(float sample_rate) override;
+    bool UsesSharedMemory() const override { return true; }
+    bool OnAcquireSharedMemory(MemoryArena &arena) override;
+    void OnReleaseSharedMemory() override;
     void ParameterChanged(int parameter_id) override;
     void changePreset();
     void ProcessMono(float in) override;
     void ProcessStereo(float inL, float inR) override;
+    void ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) override;
+    void ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) override;
     float GetBrightnessForLED(int led_id) const override;
     bool AlternateFootswitchForTempo() const override { return false; }
     void AlternateFootswitchPressed() override;
+    void DrawUI(OneBitGraphicsDisplay &display, int currentIndex, int numItemsTotal, Rectangle boundsToDrawIn,
+                bool isEditing) override;
 
   private:
     struct Mix {
@@ -44,7 +64,17 @@ class CloudSeedModule : public BaseEffectModule {
     void CalculateMix();
     Mix CalculateMix(float mixValue);
 
+    void CreateReverb(float sample_rate);
+    void DestroyReverb();
+    void LoadFactoryPreset(int preset);
+
+    void ProcessReverb(const float *inL, const float *inR, float *outL, float *outR, size_t size);
+    void MixBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size);
+
+    static constexpr int s_factoryPresetCount = 8;
+
     CloudSeed::ReverbController *reverb = 0;
+    int m_reverbLineCount = 0; // Late reverb lines that fit the custom pool, 0 if the reverb couldn't be created
 
     float m_gainMin;
     float m_gainMax;
@@ -1,5 +1,6 @@
 #include "delay_module.h"
 #include "../Util/audio_utilities.h"
+#include "../Util/memory_placement.h"
 
 using namespace bkshepherd;
 
@@ -11,11 +12,12 @@ static const char *s_modParamNames[4] = {"None", "DelayTime", "DelayLevel", "Del
 static const char *s_delayModes[3] = {"Normal", "Triplett", "Dotted 8th"};
 static const char *s_delayTypes[6] = {"Forward", "Reverse", "Octave", "ReverseOct", "Dual", "DualOct"};
 
-DelayLineRevOct<float, MAX_DELAY_NORM> DSY_SDRAM_BSS delayLineLeft;
-DelayLineRevOct<float, MAX_DELAY_NORM> DSY_SDRAM_BSS delayLineRight;
-DelayLineReverse<float, MAX_DELAY_REV> DSY_SDRAM_BSS delayLineRevLeft;
-DelayLineReverse<float, MAX_DELAY_REV> DSY_SDRAM_BSS delayLineRevRight;
-DelayLine<float, MAX_DELAY_SPREAD> DSY_SDRAM_BSS delayLineSpread;
+// Block staging for the SDRAM delay lines (about 6KB), in DTCM so the reads in the sample loop stay in internal RAM
+static HOT_DTCM delayRevOct::LineStage s_stageLeft;
+static HOT_DTCM delayRevOct::LineStage s_stageRight;
+static HOT_DTCM delayRevOct::ReverseStage s_reverseStageLeft;
+static HOT_DTCM delayRevOct::ReverseStage s_reverseStageRight;
+
 
 static const int s_paramCount =
     12; // TODO: TEST STARTING WITH THE EXTREMES OF ALL PARAMETERS (high and low, this is where errors tend to occur)
@@ -168,28 +170,24 @@ void DelayModule::CalculateDelayMix() {
 void DelayModule::Init(float sample_rate) {
     BaseEffectModule::Init(sample_rate);
 
-    delayLineLeft.Init();
-    delayLineRevLeft.Init();
-    delayLeft.del = &delayLineLeft;
-    delayLeft.delreverse = &delayLineRevLeft;
+    // The delay lines themselves are leased with the shared SDRAM, see OnAcquireSharedMemory
+    delayLeft.stage = &s_stageLeft;
+    delayLeft.reverseStage = &s_reverseStageLeft;
+    delayRight.stage = &s_stageRight;
+    delayRight.reverseStage = &s_reverseStageRight;
+
     delayLeft.delayTarget = 24000; // in samples
     delayLeft.feedback = 0.0;
     delayLeft.active = true; // Default to no delay
     delayLeft.toneOctLP.Init(sample_rate);
     delayLeft.toneOctLP.SetFreq(20000.0);
 
-    delayLineRight.Init();
-    delayLineRevRight.Init();
-    delayRight.del = &delayLineRight;
-    delayRight.delreverse = &delayLineRevRight;
     delayRight.delayTarget = 24000; // in samples
     delayRight.feedback = 0.0;
     delayRight.active = true; // Default to no
     delayRight.toneOctLP.Init(sample_rate);
     delayRight.toneOctLP.SetFreq(20000.0);
 
-    delayLineSpread.Init();
-    delaySpread.del = &delayLineSpread;
     delaySpread.delayTarget = 1500; // in samples
     delaySpread.active = true;
 
@@ -207,6 +205,39 @@ void DelayModule::Init(float sample_rate) {
     CalculateDelayMix();
 }
 
+bool DelayModule::OnAcquireSharedMemory(MemoryArena &arena) {
+    delayLeft.del = arena.New<delayRevOct::Line>();
+    delayLeft.delreverse = arena.New<delayRevOct::ReverseLine>();
+    delayRight.del = arena.New<delayRevOct::Line>();
+    delayRight.delreverse = arena.New<delayRevOct::ReverseLine>();
+    delaySpread.del = arena.New<delay_spread::Line>();
+
+    if (delayLeft.del == nullptr || delayLeft.delreverse == nullptr || delayRight.del == nullptr ||
+        delayRight.delreverse == nullptr || delaySpread.del == nullptr) {
+        OnReleaseSharedMemory();
+        return false;
+    }
+
+    delayLeft.del->Init();
+    delayLeft.delreverse->Init();
+    delayRight.del->Init();
+    delayRight.delreverse->Init();
+    delaySpread.del->Init();
+
+    // Init clears the second tap, set it up again for the current delay mode
+    ParameterChanged(3);
+
+    return true;
+}
+
+void DelayModule::OnReleaseSharedMemory() {
+    delayLeft.del = nullptr;
+    delayLeft.delreverse = nullptr;
+    delayRight.del = nullptr;
+    delayRight.delreverse = nullptr;
+    delaySpread.del = nullptr;
+}
+
 void DelayModule::ParameterChanged(int parameter_id) {
     if (parameter_id == 0) { // Delay Time
         UpdateLEDRate();
@@ -217,12 +248,15 @@ void DelayModule::ParameterChanged(int parameter_id) {
         if (delay_mode_temp > 0) {
             delayLeft.secondTapOn = true;  // triplett, dotted 8th
             delayRight.secondTapOn = true; // triplett, dotted 8th
-            if (delay_mode_temp == 1) {
-                delayLeft.del->set2ndTapFraction(0.6666667);  // triplett
-                delayRight.del->set2ndTapFraction(0.6666667); // triplett
-            } else if (delay_mode_temp == 2) {
-                delayLeft.del->set2ndTapFraction(0.75);  // dotted eighth
-                delayRight.del->set2ndTapFraction(0.75); // dotted eighth
+            // The lines only exist while the effect is active, this is applied again when they are leased
+            if (delayLeft.del != nullptr) {
+                if (delay_mode_temp == 1) {
+                    delayLeft.del->set2ndTapFraction(0.6666667);  // triplett
+                    delayRight.del->set2ndTapFraction(0.6666667); // triplett
+                } else if (delay_mode_temp == 2) {
+                    delayLeft.del->set2ndTapFraction(0.75);  // dotted eighth
+                    delayRight.del->set2ndTapFraction(0.75); // dotted eighth
+                }
             }
         } else {
             delayLeft.secondTapOn = false;
@@ -320,81 +354,50 @@ void DelayModule::ProcessModulation() {
 void DelayModule::ProcessMono(float in) {
     BaseEffectModule::ProcessMono(in);
 
-    m_LEDValue = led_osc.Process(); // update the tempo LED
-
-    // Calculate the effect
-    int delayType = GetParameterAsBinnedValue(4) - 1;
+    ProcessDelays(false);
+}
 
-    float timeParam = GetParameterAsFloat(0);
+void DelayModule::ProcessStereo(float inL, float inR) {
+    // Calculate the mono effect
+    // ProcessMono(inL);
 
-    delayLeft.delayTarget = m_delaySamplesMin + (m_delaySamplesMax - m_delaySamplesMin) * timeParam;
-    delayRight.delayTarget = m_delaySamplesMin + (m_delaySamplesMax - m_delaySamplesMin) * timeParam;
+    // Do the base stereo calculation (which resets the right signal to be the inputR instead of combined mono)
+    BaseEffectModule::ProcessStereo(inL, inR);
 
-    delayLeft.feedback = GetParameterAsFloat(1);
-    delayRight.feedback = GetParameterAsFloat(1);
-    if (delayType == 1 || delayType == 3) {
-        delayLeft.reverseMode = true;
-        delayRight.reverseMode = true;
-    } else {
-        delayLeft.reverseMode = false;
-        delayRight.reverseMode = false;
-    }
-    if (delayType == 2 || delayType == 3 || delayType == 5) {
-        delayLeft.del->setOctave(true);
-        delayRight.del->setOctave(true);
-    } else {
-        delayLeft.del->setOctave(false);
-        delayRight.del->setOctave(false);
-    }
-    if (delayType == 4 || delayType == 5) {
-        delayLeft.dual_delay = true;
-        delayRight.dual_delay = true;
-    } else {
-        delayLeft.dual_delay = false;
-        delayRight.dual_delay = false;
-    }
+    ProcessDelays(false);
+}
 
-    if (delayType == 4 || delayType == 5) { // If dual delay is turned on, spread controls the L/R panning of the two delays
-        delayLeft.level = GetParameterAsFloat(6) + 1.0;
-        delayRight.level = 1.0 - GetParameterAsFloat(6);
+void DelayModule::ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) {
+    ProcessStereoBlock(in, in, outL, outR, size);
+}
 
-        delayLeft.level_reverse = 1.0 - GetParameterAsFloat(6);
-        delayRight.level_reverse = GetParameterAsFloat(6) + 1.0;
+void DelayModule::ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) {
+    while (size > 0) {
+        const size_t count = size < DELAY_STAGE_BLOCK_SIZE ? size : DELAY_STAGE_BLOCK_SIZE;
 
-    } else { // If dual delay is off reset the levels to normal, spread controls the amount of additional delay applied to the right
-             // channel
-        delayLeft.level = 1.0;
-        delayRight.level = 1.0;
-        delayLeft.level_reverse = 1.0;
-        delayRight.level_reverse = 1.0;
-    }
+        // Stage the SDRAM spans the delays read over this chunk, the sample loop then runs from internal RAM
+        delayLeft.BeginBlock(count);
+        delayRight.BeginBlock(count);
 
-    // Modulation, this overwrites any previous parameter settings for the modulated param - TODO Better way to do this for less
-    // processing?
-    ProcessModulation();
+        for (size_t i = 0; i < count; i++) {
+            BaseEffectModule::ProcessStereo(inL[i], inR[i]);
+            ProcessDelays(true);
+            outL[i] = m_audioLeft;
+            outR[i] = m_audioRight;
+        }
 
-    float delLeft_out = delayLeft.Process(m_audioLeft);
-    float delRight_out = delayRight.Process(m_audioRight);
-    // float delRight_out = delLeft_out;
+        delayLeft.EndBlock();
+        delayRight.EndBlock();
 
-    // Calculate any delay spread
-    delaySpread.delayTarget = m_delaySpreadMin + (m_delaySpreadMax - m_delaySpreadMin) * GetParameterAsFloat(6);
-    float delSpread_out = delaySpread.Process(delRight_out);
-    if (GetParameterRaw(6) > 0 && delayType != 4 && delayType != 5) {
-        delRight_out = delSpread_out;
+        inL += count;
+        inR += count;
+        outL += count;
+        outR += count;
+        size -= count;
     }
-
-    m_audioLeft = delLeft_out * delayWetMix + m_audioLeft * delayDryMix;
-    m_audioRight = delRight_out * delayWetMix + m_audioRight * delayDryMix;
 }
 
-void DelayModule::ProcessStereo(float inL, float inR) {
-    // Calculate the mono effect
-    // ProcessMono(inL);
-
-    // Do the base stereo calculation (which resets the right signal to be the inputR instead of combined mono)
-    BaseEffectModule::ProcessStereo(inL, inR);
-
+void DelayModule::ProcessDelays(bool staged) {
     m_LEDValue = led_osc.Process(); // update the tempo LED
 
     // Calculate the effect
@@ -448,8 +451,8 @@ void DelayModule::ProcessStereo(float inL, float inR) {
     // processing?
     ProcessModulation();
 
-    float delLeft_out = delayLeft.Process(m_audioLeft);
-    float delRight_out = delayRight.Process(m_audioRight);
+    float delLeft_out = staged ? delayLeft.ProcessStaged(m_audioLeft) : delayLeft.Process(m_audioLeft);
+    float delRight_out = staged ? delayRight.ProcessStaged(m_audioRight) : delayRight.Process(m_audioRight);
     // float delRight_out = delLeft_out;
 
     // Calculate any delay spread
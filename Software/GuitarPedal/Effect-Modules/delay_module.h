@@ -23,6 +23,13 @@ constexpr size_t MAX_DELAY_REV =
                                          // opposite directions in the buffer)
 constexpr size_t MAX_DELAY_SPREAD = static_cast<size_t>(4800.0f); //  50 ms for Spread effect
 
+// The long delay lines are stored as dithered 16 bit samples, which halves their SDRAM (4 x 1MB instead of 4 x 2MB).
+// Use bkshepherd::NativeStorage<float> to keep them as float, or bkshepherd::Packed24Storage<> for 24 bit.
+typedef bkshepherd::Int16Storage<> DelayStorage;
+
+// Largest block the delay lines are staged for, blocks from the audio callback are split into chunks of this size
+constexpr size_t DELAY_STAGE_BLOCK_SIZE = 48;
+
 // This is the core delay struct, which actually includes two delays,
 // one for forwared/octave, and one for reverse. This is required
 // because the reverse delayline needs to be double the size of the
@@ -33,9 +40,20 @@ constexpr size_t MAX_DELAY_SPREAD = static_cast<size_t>(4800.0f); //  50 ms for
 // octave delay, or create a "fading into the distance" effect for the
 // forward and reverse delays. A "level" param is included for modulation
 // of the output volume, for stereo panning.
+//
+// For block processing the SDRAM lines are staged (see StagedDelayLine): BeginBlock() copies the spans the read heads will
+// cover into the stages, ProcessStaged() runs out of them, and EndBlock() writes the block back to the lines.
 struct delayRevOct {
-    DelayLineRevOct<float, MAX_DELAY_NORM> *del;
-    DelayLineReverse<float, MAX_DELAY_REV> *delreverse;
+    typedef DelayLineRevOct<float, MAX_DELAY_NORM, DelayStorage> Line;
+    typedef DelayLineReverse<float, MAX_DELAY_REV, DelayStorage> ReverseLine;
+    typedef Line::Stage<DELAY_STAGE_BLOCK_SIZE> LineStage;
+    typedef ReverseLine::Stage<DELAY_STAGE_BLOCK_SIZE> ReverseStage;
+
+    Line *del = nullptr;
+    ReverseLine *delreverse = nullptr;
+    // Stages for block processing, these are kept in DTCM (HOT_DTCM module globals)
+    LineStage *stage = nullptr;
+    ReverseStage *reverseStage = nullptr;
     float currentDelay;
     float delayTarget;
     float feedback = 0.0;
@@ -47,32 +65,49 @@ struct delayRevOct {
     bool dual_delay = false;
     bool secondTapOn = false;
 
-    float Process(float in) {
+    float Process(float in) { return Process(del->GetBuffer(), delreverse->GetBuffer(), in); }
+
+    // Starts a staged block of up to DELAY_STAGE_BLOCK_SIZE samples
+    void BeginBlock(size_t count) {
+        // Upper bound of how far the delay glides over the block, with a little room for the modulation moving the target
+        const float glide = fabsf(delayTarget - currentDelay) * .0002f * count + 2.0f;
+        del->BeginStage(*stage, count, currentDelay - glide, currentDelay + glide, secondTapOn);
+        delreverse->BeginStage(*reverseStage, count);
+    }
+
+    float ProcessStaged(float in) { return Process(*stage, *reverseStage, in); }
+
+    void EndBlock() {
+        stage->End();
+        reverseStage->End();
+    }
+
+    template <typename LineAccess, typename ReverseAccess> float Process(LineAccess &line, ReverseAccess &reverse, float in) {
         // set delay times
         fonepole(currentDelay, delayTarget, .0002f);
         del->SetDelay(currentDelay);
         delreverse->SetDelay1(currentDelay);
 
-        float del_read = del->Read();
+        float del_read = del->ReadFrom(line);
 
-        float read_reverse = delreverse->ReadRev(); // REVERSE
+        float read_reverse = delreverse->ReadRevFrom(reverse); // REVERSE
 
         float read =
             toneOctLP.Process(del_read); // LP filter, tames harsh high frequencies on octave, has fading effect for normal/reverse
 
         float secondTap = 0.0;
         if (secondTapOn) {
-            secondTap = del->ReadSecondTap();
+            secondTap = del->ReadSecondTapFrom(line);
         }
         // float read2 = delreverse->ReadFwd();
         if (active) {
-            del->Write((feedback * read) + in);
-            delreverse->Write((feedback * read) +
-                              in); // Writing the read from fwd/oct delay line allows for combining oct and rev for reverse octave!
+            del->WriteTo(line, (feedback * read) + in);
+            // Writing the read from fwd/oct delay line allows for combining oct and rev for reverse octave!
+            delreverse->WriteTo(reverse, (feedback * read) + in);
             // delreverse->Write((feedback * read2) + in);
         } else {
-            del->Write(feedback * read); // if not active, don't write any new sound to buffer
-            delreverse->Write(feedback * read);
+            del->WriteTo(line, feedback * read); // if not active, don't write any new sound to buffer
+            delreverse->WriteTo(reverse, feedback * read);
             // delreverse->Write((feedback * read2));
         }
 
@@ -93,7 +128,9 @@ struct delayRevOct {
 //    A short, zero feedback (one repeat) delay for stereo spread
 
 struct delay_spread {
-    DelayLine<float, MAX_DELAY_SPREAD> *del;
+    typedef DelayLine<float, MAX_DELAY_SPREAD> Line;
+
+    Line *del = nullptr;
     float currentDelay;
     float delayTarget;
     float active = false;
@@ -119,17 +156,30 @@ class DelayModule : public BaseEffectModule {
     DelayModule();
     ~DelayModule();
 
+    // Shared SDRAM taken while the effect is active (the forward/octave and reverse lines of both channels and the spread line)
+    static constexpr size_t s_sharedMemorySize =
+        2 * (MemoryArena::AlignedSize(sizeof(delayRevOct::Line)) + MemoryArena::AlignedSize(sizeof(delayRevOct::ReverseLine))) +
+        MemoryArena::AlignedSize(sizeof(delay_spread::Line));
+
     void Init(float sample_rate) override;
+    bool UsesSharedMemory() const override { return true; }
+    bool OnAcquireSharedMemory(MemoryArena &arena) override;
+    void OnReleaseSharedMemory() override;
     void UpdateLEDRate();
     void CalculateDelayMix();
     void ParameterChanged(int parameter_id) override;
     void ProcessModulation();
     void ProcessMono(float in) override;
     void ProcessStereo(float inL, float inR) override;
+    void ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) override;
+    void ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) override;
     void SetTempo(uint32_t bpm) override;
     float GetBrightnessForLED(int led_id) const override;
 
   private:
+    // Runs the delays on m_audioLeft / m_audioRight, through the stages while a staged block is in progress
+    void ProcessDelays(bool staged);
+
     float m_delaylpFreqMin;
     float m_delaylpFreqMax;
     float m_delaySamplesMin;
@@ -0,0 +1,136 @@
+#include "fdn_reverb_module.h"
+#include <math.h>
+
+using namespace bkshepherd;
+
+static const int s_paramCount = 4;
+static const ParameterMetaData s_metaData[s_paramCount] = {{
+                                                               name : "Time",
+                                                               valueType : ParameterValueType::Float,
+                                                               valueBinCount : 0,
+                                                               defaultValue : {.float_value = 0.3f},
+                                                               knobMapping : 0,
+                                                               midiCCMapping : 1
+                                                           },
+                                                           {
+                                                               name : "Damp",
+                                                               valueType : ParameterValueType::Float,
+                                                               valueBinCount : 0,
+                                                               defaultValue : {.float_value = 0.4f},
+                                                               knobMapping : 1,
+                                                               midiCCMapping : 21
+                                                           },
+                                                           {
+                                                               name : "Mix",
+                                                               valueType : ParameterValueType::Float,
+                                                               valueBinCount : 0,
+                                                               defaultValue : {.float_value = 0.35f},
+                                                               knobMapping : 2,
+                                                               midiCCMapping : 22
+                                                           },
+                                                           {
+                                                               name : "Size",
+                                                               valueType : ParameterValueType::Float,
+                                                               valueBinCount : 0,
+                                                               defaultValue : {.float_value = 0.7f},
+                                                               knobMapping : 3,
+                                                               midiCCMapping : 23
+                                                           }};
+
+// Default Constructor
+FdnReverbModule::FdnReverbModule() : BaseEffectModule() {
+    // Set the name of the effect
+    m_name = "FDN Reverb";
+
+    // Setup the meta data reference for this Effect
+    m_paramMetaData = s_metaData;
+
+    // Initialize Parameters for this Effect
+    this->InitParams(s_paramCount);
+}
+
+// Destructor
+FdnReverbModule::~FdnReverbModule() {
+    // No Code Needed
+}
+
+void FdnReverbModule::Init(float sample_rate) {
+    BaseEffectModule::Init(sample_rate);
+
+    // The reverb is set up when its delay memory is leased, see OnAcquireSharedMemory
+}
+
+bool FdnReverbModule::OnAcquireSharedMemory(MemoryArena &arena) {
+    // Delay memory for the 8 lines (128KB)
+    float *buffer = arena.NewArray<float>(FdnReverb::BufferSize);
+
+    if (buffer == nullptr) {
+        return false;
+    }
+
+    m_reverb.Init(GetSampleRate(), buffer);
+
+    ParameterChanged(0);
+    ParameterChanged(1);
+    ParameterChanged(3);
+
+    return true;
+}
+
+void FdnReverbModule::ParameterChanged(int parameter_id) {
+    if (parameter_id == 0) { // Time, squared so more of the knob goes to the shorter decays
+        const float time = GetParameterAsFloat(0);
+        m_reverb.SetDecayTime(m_timeMin + time * time * (m_timeMax - m_timeMin));
+    } else if (parameter_id == 1) { // Damp, knob right is more damping
+        const float invertedFreq = 1.0f - GetParameterAsFloat(1);
+        m_reverb.SetDampingFrequency(m_dampFreqMin + invertedFreq * invertedFreq * (m_dampFreqMax - m_dampFreqMin));
+    } else if (parameter_id == 3) { // Size
+        m_reverb.SetSize(GetParameterAsFloat(3));
+    }
+}
+
+void FdnReverbModule::ProcessMono(float in) {
+    BaseEffectModule::ProcessMono(in);
+
+    float outL;
+    float outR;
+    ProcessMonoBlock(&in, &outL, &outR, 1);
+
+    m_audioLeft = outL;
+    m_audioRight = outR;
+}
+
+void FdnReverbModule::ProcessStereo(float inL, float inR) {
+    BaseEffectModule::ProcessStereo(inL, inR);
+
+    float outL;
+    float outR;
+    ProcessStereoBlock(&inL, &inR, &outL, &outR, 1);
+
+    m_audioLeft = outL;
+    m_audioRight = outR;
+}
+
+void FdnReverbModule::ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) {
+    ProcessStereoBlock(in, in, outL, outR, size);
+}
+
+void FdnReverbModule::ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) {
+    m_reverb.Process(inL, inR, outL, outR, size);
+
+    const float mix = GetParameterAsFloat(2);
+    for (size_t i = 0; i < size; i++) {
+        outL[i] = outL[i] * mix + inL[i] * (1.0f - mix);
+        outR[i] = outR[i] * mix + inR[i] * (1.0f - mix);
+    }
+}
+
+float FdnReverbModule::GetBrightnessForLED(int led_id) const {
+    float value = BaseEffectModule::GetBrightnessForLED(led_id);
+
+    if (led_id == 1) {
+        return value * GetParameterAsFloat(2);
+    }
+
+    return value;
+}
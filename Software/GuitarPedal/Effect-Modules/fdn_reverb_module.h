@@ -0,0 +1,45 @@
+#pragma once
+#ifndef FDN_REVERB_MODULE_H
+#define FDN_REVERB_MODULE_H
+
+#include "../Util/fdn_reverb.h"
+#include "base_effect_module.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+
+/** @file fdn_reverb_module.h */
+
+namespace bkshepherd {
+
+/** Stereo reverb built on FdnReverb, an 8 line feedback delay network. It is much lighter than ReverbSc and CloudSeed (see
+    fdn_reverb.h for the CPU and memory budget) so it can run after an amp model */
+class FdnReverbModule : public BaseEffectModule {
+  public:
+    FdnReverbModule();
+    ~FdnReverbModule();
+
+    // Shared SDRAM taken while the effect is active
+    static constexpr size_t s_sharedMemorySize = MemoryArena::AlignedSize(sizeof(float) * FdnReverb::BufferSize);
+
+    void Init(float sample_rate) override;
+    bool UsesSharedMemory() const override { return true; }
+    bool OnAcquireSharedMemory(MemoryArena &arena) override;
+    void ParameterChanged(int parameter_id) override;
+    void ProcessMono(float in) override;
+    void ProcessStereo(float inL, float inR) override;
+    void ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) override;
+    void ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) override;
+    float GetBrightnessForLED(int led_id) const override;
+
+  private:
+    FdnReverb m_reverb;
+
+    float m_timeMin = 0.3f;
+    float m_timeMax = 10.0f;
+    float m_dampFreqMin = 1000.0f;
+    float m_dampFreqMax = 16000.0f;
+};
+} // namespace bkshepherd
+#endif
+#endif
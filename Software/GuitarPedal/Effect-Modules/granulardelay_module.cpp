@@ -4,11 +4,6 @@
 
 using namespace bkshepherd;
 
-// 1/2 second at 48kHz
-#define MAX_SAMPLE_GRAN 24000
-
-float DSY_SDRAM_BSS buffer_gran_delay[MAX_SAMPLE_GRAN];
-
 static const char *s_grainEnvNames[3] = {"Cos", "SlowAtk", "FastAtk"};
 
 static const int s_paramCount = 7;
@@ -101,23 +96,38 @@ GranularDelayModule::~GranularDelayModule() {
 void GranularDelayModule::Init(float sample_rate) {
     BaseEffectModule::Init(sample_rate);
 
+    // The looper and the granular player are set up when the sample buffer is leased, see OnAcquireSharedMemory
+    m_pitch = 0.0;
+
+    m_hold = false;
+}
+
+bool GranularDelayModule::OnAcquireSharedMemory(MemoryArena &arena) {
+    float *buffer = arena.NewArray<float>(s_sampleBufferSize);
+
+    if (buffer == nullptr) {
+        return false;
+    }
+
+    for (size_t i = 0; i < s_sampleBufferSize; i++) {
+        buffer[i] = 0.;
+    }
+
     // Init the looper
-    m_looper.Init(buffer_gran_delay, MAX_SAMPLE_GRAN);
+    m_looper.Init(buffer, s_sampleBufferSize);
     m_looper.SetMode(static_cast<daisysp::Looper::Mode>(3)); // Frippertronics mode
 
-    granular.Init(buffer_gran_delay, MAX_SAMPLE_GRAN, sample_rate, 0.0, 0.5);
+    granular.Init(buffer, s_sampleBufferSize, GetSampleRate(), 0.0, 0.5);
 
-    m_pitch = 0.0;
-
-    m_hold = false;
+    // Record the first half second again, the buffer starts out empty
     m_loop_recorded = false;
     first_count = 0;
 
-    for (int i = 0; i < MAX_SAMPLE_GRAN; i++) {
-        buffer_gran_delay[i] = 0.;
-    }
+    // Apply the current spread and envelope to the new granular player
+    ParameterChanged(3);
+    ParameterChanged(4);
 
-    granular.setStereoSpread(0.4);
+    return true;
 }
 
 void GranularDelayModule::ParameterChanged(int parameter_id) {
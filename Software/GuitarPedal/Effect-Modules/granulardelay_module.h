@@ -20,8 +20,16 @@ class GranularDelayModule : public BaseEffectModule {
     GranularDelayModule();
     ~GranularDelayModule();
 
+    // Length of the sample buffer, 1/2 second at 48kHz
+    static constexpr size_t s_sampleBufferSize = 24000;
+
+    // Shared SDRAM taken while the effect is active
+    static constexpr size_t s_sharedMemorySize = MemoryArena::AlignedSize(sizeof(float) * s_sampleBufferSize);
+
     void Init(float sample_rate) override;
     void ParameterChanged(int parameter_id) override;
+    bool UsesSharedMemory() const override { return true; }
+    bool OnAcquireSharedMemory(MemoryArena &arena) override;
     void ProcessMono(float in) override;
     void ProcessStereo(float inL, float inR) override;
     float GetBrightnessForLED(int led_id) const override;
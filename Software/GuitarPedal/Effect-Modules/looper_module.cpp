@@ -4,12 +4,6 @@
 
 using namespace bkshepherd;
 
-// 60 seconds at 48kHz
-#define kBuffSize 48000 * 60
-
-float DSY_SDRAM_BSS buffer[kBuffSize];
-float DSY_SDRAM_BSS bufferR[kBuffSize];
-
 static const char *s_loopModeNames[4] = {"Normal", "One-time", "Replace", "Fripp"};
 
 static const char *s_loopSpeedMode[3] = {"None", "Stepped", "Smooth"};
@@ -100,20 +94,34 @@ LooperModule::~LooperModule() {
 void LooperModule::Init(float sample_rate) {
     BaseEffectModule::Init(sample_rate);
 
-    // Init the looper
-    m_looper.Init(buffer, kBuffSize);
-    m_looperR.Init(bufferR, kBuffSize);
-
-    SetLooperMode();
+    // The loopers are set up when the loop buffers are leased, see OnAcquireSharedMemory
     tone.Init(sample_rate);
     toneR.Init(sample_rate);
     currentSpeed = 1.0;
 }
 
+bool LooperModule::OnAcquireSharedMemory(MemoryArena &arena) {
+    LoopCore::Stored *buffer = arena.NewArray<LoopCore::Stored>(s_loopBufferSize);
+    LoopCore::Stored *bufferR = arena.NewArray<LoopCore::Stored>(s_loopBufferSize);
+
+    if (buffer == nullptr || bufferR == nullptr) {
+        return false;
+    }
+
+    // Init the looper, this clears the buffers so any loop recorded before the effect was switched away is gone
+    m_looper.Init(buffer, s_loopBufferSize);
+    m_looperR.Init(bufferR, s_loopBufferSize);
+
+    SetLooperMode();
+    currentSpeed = 1.0;
+
+    return true;
+}
+
 void LooperModule::SetLooperMode() {
     const int modeIndex = GetParameterAsBinnedValue(2) - 1;
-    m_looper.SetMode(static_cast<daisysp::Looper::Mode>(modeIndex));
-    m_looperR.SetMode(static_cast<daisysp::Looper::Mode>(modeIndex));
+    m_looper.SetMode(static_cast<LoopCore::Mode>(modeIndex));
+    m_looperR.SetMode(static_cast<LoopCore::Mode>(modeIndex));
 }
 
 void LooperModule::ParameterChanged(int parameter_id) {
@@ -128,145 +136,140 @@ void LooperModule::AlternateFootswitchPressed() {
 }
 
 void LooperModule::AlternateFootswitchHeldFor1Second() {
+    // Nothing to clear before the loop buffers are leased
+    if (!HasSharedMemory()) {
+        return;
+    }
+
     // clear the loop
     m_looper.Clear();
     m_looperR.Clear();
 }
 
-void LooperModule::ProcessMono(float in) {
-    BaseEffectModule::ProcessMono(in);
+// Largest block the looper processes in one pass, the audio callback's block size
+static constexpr size_t s_maxBlockSize = 48;
 
-    const float inputLevel = m_inputLevelMin + (GetParameterAsFloat(0) * (m_inputLevelMax - m_inputLevelMin));
-
-    const float loopLevel = m_loopLevelMin + (GetParameterAsFloat(1) * (m_loopLevelMax - m_loopLevelMin));
-
-    float input = in * inputLevel;
+// Per sample smoothing of the speed in Smooth mode (like a tape reel)
+static const float s_speedSmoothing = 0.00006f;
 
+void LooperModule::UpdateControls(size_t size) {
     // Set low pass filter as exponential taper
-    tone.SetFreq(m_toneFreqMin + GetParameterAsFloat(5) * GetParameterAsFloat(5) * (m_toneFreqMax - m_toneFreqMin));
+    const float toneFreq = m_toneFreqMin + GetParameterAsFloat(5) * GetParameterAsFloat(5) * (m_toneFreqMax - m_toneFreqMin);
+    tone.SetFreq(toneFreq);
+    toneR.SetFreq(toneFreq);
 
-    // Handle speed and direction changes smoothly (like a tape reel)
-    // TODO maybe move out to only do this when speed param changes
-    int speedModeIndex = GetParameterAsBinnedValue(3) - 1;
+    // Handle speed and direction changes once per block, the loopers glide to the new speed across the block
+    const int speedModeIndex = GetParameterAsBinnedValue(3) - 1;
 
+    float speed = 1.0f;
     if (speedModeIndex == 2) {
-        float speed = GetParameterAsFloat(4);
-        daisysp::fonepole(currentSpeed, speed, .00006f);
-        if (currentSpeed < 0.0) {
-            m_looper.SetReverse(true);
-        } else {
-            m_looper.SetReverse(false);
+        // The same one pole smoothing as per sample, applied for the whole block at once
+        const float coefficient = 1.0f - powf(1.0f - s_speedSmoothing, static_cast<float>(size));
+        currentSpeed += coefficient * (GetParameterAsFloat(4) - currentSpeed);
+
+        // The smoothing only gets there asymptotically, land on the knob once within a fifth of a cent so unity speed gets
+        // back to copying samples
+        if (fabsf(GetParameterAsFloat(4) - currentSpeed) < 0.0001f) {
+            currentSpeed = GetParameterAsFloat(4);
         }
-        float speed_input_abs = abs(currentSpeed);
-        m_looper.SetIncrementSize(speed_input_abs);
-
+        speed = currentSpeed;
     } else if (speedModeIndex == 1) {
-        float speed = GetParameterAsFloat(4) * 2;
-        int temp_speed = speed;
-        float ftemp_speed = temp_speed;
-        float stepped_speed = ftemp_speed / 2;
+        // Half steps, at least half speed
+        const float stepped = static_cast<int>(GetParameterAsFloat(4) * 2) / 2.0f;
+        speed = fabsf(stepped) < 0.5f ? (GetParameterAsFloat(4) < 0.0f ? -0.5f : 0.5f) : stepped;
+    }
 
-        if (speed < 0.0) {
-            m_looper.SetReverse(true);
-        } else {
-            m_looper.SetReverse(false);
-        }
-        float speed_input_abs = abs(stepped_speed);
-        if (speed_input_abs < 0.5) {
-            speed_input_abs = 0.5;
-        }
-        m_looper.SetIncrementSize(speed_input_abs);
+    m_looper.SetReverse(speed < 0.0f);
+    m_looperR.SetReverse(speed < 0.0f);
+    m_looper.SetIncrementSize(fabsf(speed));
+    m_looperR.SetIncrementSize(fabsf(speed));
+}
 
-    } else {
-        m_looper.SetReverse(false);
-        m_looper.SetIncrementSize(1.0);
-    }
-    /////////////////////////
+void LooperModule::ProcessMono(float in) {
+    BaseEffectModule::ProcessMono(in);
 
-    // store signal = loop signal * loop gain + in * in_gain
-    float looperOutput = m_looper.Process(input) * loopLevel + input;
-    float filter_out = tone.Process(looperOutput); // Apply tone Low Pass filter (useful to tame aliasing noise on variable speeds)
+    float outL;
+    float outR;
+    ProcessMonoBlock(&in, &outL, &outR, 1);
 
-    m_audioRight = m_audioLeft = filter_out;
+    m_audioLeft = outL;
+    m_audioRight = outR;
 }
 
 void LooperModule::ProcessStereo(float inL, float inR) {
-    // Calculate the mono effect
-    // ProcessMono(inL);
-
     BaseEffectModule::ProcessStereo(inL, inR);
 
-    const float inputLevel = m_inputLevelMin + (GetParameterAsFloat(0) * (m_inputLevelMax - m_inputLevelMin));
+    float outL;
+    float outR;
+    ProcessStereoBlock(&inL, &inR, &outL, &outR, 1);
 
-    const float loopLevel = m_loopLevelMin + (GetParameterAsFloat(1) * (m_loopLevelMax - m_loopLevelMin));
+    m_audioLeft = outL;
+    m_audioRight = outR;
+}
 
-    float inputR = 0.0;
-    float input = m_audioLeft * inputLevel;
-    if (!GetParameterAsBool(6)) { // If "MISO" is on, copy left input to right, otherwise do true stereo
-        inputR = m_audioRight * inputLevel;
-    } else {
-        inputR = input;
-    }
+void LooperModule::ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) {
+    UpdateControls(size);
 
-    // Set low pass filter as exponential taper
-    tone.SetFreq(m_toneFreqMin + GetParameterAsFloat(5) * GetParameterAsFloat(5) * (m_toneFreqMax - m_toneFreqMin));
-    toneR.SetFreq(m_toneFreqMin + GetParameterAsFloat(5) * GetParameterAsFloat(5) * (m_toneFreqMax - m_toneFreqMin));
+    const float inputLevel = m_inputLevelMin + (GetParameterAsFloat(0) * (m_inputLevelMax - m_inputLevelMin));
+    const float loopLevel = m_loopLevelMin + (GetParameterAsFloat(1) * (m_loopLevelMax - m_loopLevelMin));
 
-    // Handle speed and direction changes smoothly (like a tape reel)
-    // TODO maybe move out to only do this when speed param changes
-    int speedModeIndex = GetParameterAsBinnedValue(3) - 1;
+    while (size > 0) {
+        const size_t count = size < s_maxBlockSize ? size : s_maxBlockSize;
 
-    if (speedModeIndex == 2) {
-        float speed = GetParameterAsFloat(4);
-        daisysp::fonepole(currentSpeed, speed, .00006f);
-        if (currentSpeed < 0.0) {
-            m_looper.SetReverse(true);
-            m_looperR.SetReverse(true);
-        } else {
-            m_looper.SetReverse(false);
-            m_looperR.SetReverse(false);
+        float input[s_maxBlockSize];
+        float loop[s_maxBlockSize];
+        for (size_t i = 0; i < count; i++) {
+            input[i] = in[i] * inputLevel;
         }
-        float speed_input_abs = abs(currentSpeed);
-        m_looper.SetIncrementSize(speed_input_abs);
-        m_looperR.SetIncrementSize(speed_input_abs);
+        m_looper.Process(input, loop, count);
 
-    } else if (speedModeIndex == 1) {
-        float speed = GetParameterAsFloat(4) * 2;
-        int temp_speed = speed;
-        float ftemp_speed = temp_speed;
-        float stepped_speed = ftemp_speed / 2;
-
-        if (speed < 0.0) {
-            m_looper.SetReverse(true);
-            m_looperR.SetReverse(true);
-        } else {
-            m_looper.SetReverse(false);
-            m_looperR.SetReverse(false);
+        // store signal = loop signal * loop gain + in * in_gain, then the tone low pass
+        for (size_t i = 0; i < count; i++) {
+            outL[i] = tone.Process(loop[i] * loopLevel + input[i]);
+            outR[i] = outL[i];
         }
-        float speed_input_abs = abs(stepped_speed);
-        if (speed_input_abs < 0.5) {
-            speed_input_abs = 0.5;
-        }
-        m_looper.SetIncrementSize(speed_input_abs);
-        m_looperR.SetIncrementSize(speed_input_abs);
 
-    } else {
-        m_looper.SetReverse(false);
-        m_looper.SetIncrementSize(1.0);
-        m_looperR.SetReverse(false);
-        m_looperR.SetIncrementSize(1.0);
+        in += count;
+        outL += count;
+        outR += count;
+        size -= count;
     }
-    /////////////////////////
+}
+
+void LooperModule::ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) {
+    UpdateControls(size);
+
+    const float inputLevel = m_inputLevelMin + (GetParameterAsFloat(0) * (m_inputLevelMax - m_inputLevelMin));
+    const float loopLevel = m_loopLevelMin + (GetParameterAsFloat(1) * (m_loopLevelMax - m_loopLevelMin));
 
-    // store signal = loop signal * loop gain + in * in_gain
-    float looperOutput = m_looper.Process(input) * loopLevel + input;
-    float filter_out = tone.Process(looperOutput); // Apply tone Low Pass filter (useful to tame aliasing noise on variable speeds)
+    // If "MISO" is on, copy left input to right, otherwise do true stereo
+    const float *inR2 = GetParameterAsBool(6) ? inL : inR;
 
-    float looperOutputR = m_looperR.Process(inputR) * loopLevel + inputR;
-    float filter_outR = toneR.Process(looperOutputR); // Apply tone Low Pass filter (useful to tame aliasing noise on variable speeds)
+    while (size > 0) {
+        const size_t count = size < s_maxBlockSize ? size : s_maxBlockSize;
+
+        float input[s_maxBlockSize];
+        float inputR[s_maxBlockSize];
+        float loop[s_maxBlockSize];
+        float loopR[s_maxBlockSize];
+        for (size_t i = 0; i < count; i++) {
+            input[i] = inL[i] * inputLevel;
+            inputR[i] = inR2[i] * inputLevel;
+        }
+        m_looper.Process(input, loop, count);
+        m_looperR.Process(inputR, loopR, count);
 
-    m_audioLeft = filter_out;
-    m_audioRight = filter_outR;
+        for (size_t i = 0; i < count; i++) {
+            outL[i] = tone.Process(loop[i] * loopLevel + input[i]);
+            outR[i] = toneR.Process(loopR[i] * loopLevel + inputR[i]);
+        }
+
+        inL += count;
+        inR2 += count;
+        outL += count;
+        outR += count;
+        size -= count;
+    }
 }
 
 float LooperModule::GetBrightnessForLED(int led_id) const {
@@ -2,6 +2,7 @@
 #ifndef LOOPER_MODULE_H
 #define LOOPER_MODULE_H
 
+#include "../Util/looper_core.h"
 #include "base_effect_module.h"
 #include "daisysp.h"
 #include <stdint.h>
@@ -16,10 +17,26 @@ class LooperModule : public BaseEffectModule {
     LooperModule();
     ~LooperModule();
 
+    // Loops are kept as 16 bit samples with 12dB of headroom above full scale for overdubs to build up in, at half the
+    // memory of float. Playback and dubs leave the recorded layers bit for bit, each layer is quantized (with dither) once,
+    // so it sits 16 bit (dithered) below float where daisysp::Looper doesn't quantize at all. Packed24Storage would give 80
+    // seconds in the same memory without the dither noise
+    typedef LooperCore<Int16Storage<2>> LoopCore;
+
+    // Length of each loop buffer, 120 seconds at 48kHz
+    static constexpr size_t s_loopBufferSize = 48000 * 120;
+
+    // Shared SDRAM taken while the looper is active (both loop buffers)
+    static constexpr size_t s_sharedMemorySize = 2 * MemoryArena::AlignedSize(sizeof(LoopCore::Stored) * s_loopBufferSize);
+
     void Init(float sample_rate) override;
     void ParameterChanged(int parameter_id) override;
+    bool UsesSharedMemory() const override { return true; }
+    bool OnAcquireSharedMemory(MemoryArena &arena) override;
     void ProcessMono(float in) override;
     void ProcessStereo(float inL, float inR) override;
+    void ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) override;
+    void ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) override;
     float GetBrightnessForLED(int led_id) const override;
     bool AlternateFootswitchForTempo() const override { return false; }
     void AlternateFootswitchPressed() override;
@@ -29,10 +46,14 @@ class LooperModule : public BaseEffectModule {
 
   private:
     void SetLooperMode();
-    daisysp::Tone tone;  // Low Pass
+
+    // Sets the tone and the speed of both loopers for a block of size samples
+    void UpdateControls(size_t size);
+
+    daisysp::Tone tone;  // Low Pass, a tone control (the loopers band limit variable speeds themselves)
     daisysp::Tone toneR; // Low Pass
-    daisysp::Looper m_looper;
-    daisysp::Looper m_looperR; // Added another looper for stereo loops
+    LoopCore m_looper;
+    LoopCore m_looperR; // Added another looper for stereo loops
 
     float m_inputLevelMin;
     float m_inputLevelMax;
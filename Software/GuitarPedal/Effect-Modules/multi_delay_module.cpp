@@ -1,40 +1,25 @@
 #include "multi_delay_module.h"
 #include "../Util/audio_utilities.h"
-#include "Delays/delayline_reverse.h"
-#include "Delays/delayline_revoct.h"
+#include "../Util/memory_placement.h"
 #include "daisysp.h"
 
 using namespace bkshepherd;
 
-PitchShifter DSY_SDRAM_BSS ps_taps[4];
-// Delay Max Definitions (Assumes 48kHz samplerate)
-constexpr size_t MAX_DELAY_TAP = static_cast<size_t>(48000.0f * 8.f);
-DelayLine<float, MAX_DELAY_TAP> DSY_SDRAM_BSS delayLineLeft0;
-DelayLine<float, MAX_DELAY_TAP> DSY_SDRAM_BSS delayLineRight0;
+// All taps read one line leased from the shared SDRAM, the tap state and block scratch stay in DTCM
+static HOT_DTCM MultiTapDelay<MultiDelayModule::s_tapCount> s_taps;
 
-float tap_delays[4] = {0.0f, 0.0f, 0.0f, 0.0f};
-namespace {
-struct delay {
-    DelayLine<float, MAX_DELAY_TAP> *del;
-    float currentDelay;
-    float delayTarget;
+// Tap layout of s_taps
+static constexpr size_t s_mainTapLeft = 0;
+static constexpr size_t s_mainTapRight = 1;
+static constexpr size_t s_shiftTapFirst = 2; // Shift Tap 1..4, the first two on the left
+static constexpr size_t s_patternTapLeft = 6;
+static constexpr size_t s_patternTapRight = 7;
 
-    float Process(float feedback, float in) {
-        // set delay times
-        fonepole(currentDelay, delayTarget, .0002f);
-        del->SetDelay(currentDelay);
-
-        float read = del->Read();
-        del->Write((feedback * read) + in);
-
-        return read;
-    }
-};
-} // namespace
-delay delays[2];
+static const float s_patternFractions[4] = {0.0f, 0.5f, 0.6666667f, 0.75f};
 
 static const char *s_typeBinNames[] = {"Follower", "Time"};
-static const int s_paramCount = 13;
+static const char *s_patternBinNames[] = {"Off", "8th", "Triplett", "Dotted 8th"};
+static const int s_paramCount = 14;
 static const ParameterMetaData s_metaData[s_paramCount] = {{
                                                                name : "Wet %",
                                                                valueType : ParameterValueType::Float,
@@ -173,6 +158,15 @@ static const ParameterMetaData s_metaData[s_paramCount] = {{
                                                                minValue : 0,
                                                                maxValue : 4000,
                                                                fineStepSize : 0.00025f
+                                                           },
+                                                           {
+                                                               name : "Pattern",
+                                                               valueType : ParameterValueType::Binned,
+                                                               valueBinCount : 4,
+                                                               valueBinNames : s_patternBinNames,
+                                                               defaultValue : {.uint_value = 0},
+                                                               knobMapping : -1,
+                                                               midiCCMapping : 32
                                                            }};
 
 // Default Constructor
@@ -196,91 +190,130 @@ MultiDelayModule::~MultiDelayModule() {
     // No Code Needed
 }
 
-void MultiDelayModule::Init(float sample_rate) {
-    BaseEffectModule::Init(sample_rate);
-    delayLineLeft0.Init();
-    delayLineRight0.Init();
-    delays[0].del = &delayLineLeft0;
-    delays[0].currentDelay = GetParameterAsFloat(1);
-    delays[1].del = &delayLineRight0;
-    delays[1].currentDelay = GetParameterAsFloat(2);
-
-    for (int i = 0; i < 4; ++i) {
-        ps_taps[i].Init(sample_rate);
+void MultiDelayModule::Init(float sample_rate) { BaseEffectModule::Init(sample_rate); }
+
+bool MultiDelayModule::OnAcquireSharedMemory(MemoryArena &arena) {
+    float *line = arena.NewArray<float>(s_lineSize);
+    if (line == nullptr) {
+        return false;
+    }
+
+    s_taps.Init(line, s_lineSize);
+    UpdateTaps();
+
+    // Start at the current settings instead of gliding up from the shortest delay
+    for (size_t tap = 0; tap < s_tapCount; tap++) {
+        s_taps.SnapTapDelay(tap);
     }
+
+    return true;
+}
+
+void MultiDelayModule::OnReleaseSharedMemory() {
+    // Nothing to release, the taps only read the line while the effect is processing
 }
 
 void MultiDelayModule::ParameterChanged(int parameter_id) {
     if (parameter_id == 1) {
-        delays[0].delayTarget = 48.0f * GetParameterAsFloat(1);
+        m_delayTarget[0] = 48.0f * GetParameterAsFloat(1);
         if (GetParameterAsBinnedValue(4) == 1) {
-            SetTargetTapDelayTime(0, delays[0].delayTarget, 2.0f);
-            SetTargetTapDelayTime(1, delays[0].delayTarget, 4.0f);
+            SetTargetTapDelayTime(0, m_delayTarget[0], 2.0f);
+            SetTargetTapDelayTime(1, m_delayTarget[0], 4.0f);
         }
     } else if (parameter_id == 2) {
-        delays[1].delayTarget = 48.0f * GetParameterAsFloat(2);
+        m_delayTarget[1] = 48.0f * GetParameterAsFloat(2);
         if (GetParameterAsBinnedValue(4) == 1) {
-            SetTargetTapDelayTime(2, delays[1].delayTarget, 2.0f);
-            SetTargetTapDelayTime(3, delays[1].delayTarget, 4.0f);
+            SetTargetTapDelayTime(2, m_delayTarget[1], 2.0f);
+            SetTargetTapDelayTime(3, m_delayTarget[1], 4.0f);
         }
     } else if (parameter_id == 4) {
         if (GetParameterAsBinnedValue(parameter_id) == 1) {
-            SetTargetTapDelayTime(0, delays[0].delayTarget, 2.0f);
-            SetTargetTapDelayTime(1, delays[0].delayTarget, 4.0f);
-            SetTargetTapDelayTime(2, delays[1].delayTarget, 2.0f);
-            SetTargetTapDelayTime(3, delays[1].delayTarget, 4.0f);
+            SetTargetTapDelayTime(0, m_delayTarget[0], 2.0f);
+            SetTargetTapDelayTime(1, m_delayTarget[0], 4.0f);
+            SetTargetTapDelayTime(2, m_delayTarget[1], 2.0f);
+            SetTargetTapDelayTime(3, m_delayTarget[1], 4.0f);
         }
-    } else if (parameter_id > 4 && parameter_id < 9 && m_isInitialized == true) {
-        ps_taps[parameter_id - 5].SetTransposition(m_pitchShiftMin +
-                                                   (m_pitchShiftMax - m_pitchShiftMin) * GetParameterAsFloat(parameter_id));
-    } else if (parameter_id > 8 && parameter_id < 11) {
+    } else if (parameter_id > 8 && parameter_id < 13) {
         m_tapTargetDelay[parameter_id - 9] = 48.0f * GetParameterAsFloat(parameter_id);
     }
+
+    // The taps only exist while the effect is active, they are set up again when the line is leased
+    if (m_isInitialized && HasSharedMemory()) {
+        UpdateTaps();
+    }
 }
 
 void MultiDelayModule::SetTargetTapDelayTime(uint8_t index, float value, float multiplier) {
     m_tapTargetDelay[index] = value * multiplier;
 }
 
-void PreProcessTaps(float *current, float target) { fonepole(*current, target, .0002f); }
+void MultiDelayModule::UpdateTaps() {
+    const float feedback = GetParameterAsFloat(3);
+    const float patternFraction = s_patternFractions[GetParameterAsBinnedValue(13) - 1];
 
-void MultiDelayModule::ProcessMono(float in) {
-    BaseEffectModule::ProcessMono(in);
-
-    float taps[2];
-    float sig = delays[0].Process(GetParameterAsFloat(3), m_audioLeft) / 3.f;
-    for (int i = 0; i < 2; ++i) {
-        PreProcessTaps(&tap_delays[i], m_tapTargetDelay[i]);
-        taps[i] = delays[0].del->Read(tap_delays[i]);
-        // temporary workaround, only process one pitch shifter for now, using all 4 causes right channel to be silent.
-        if (i == 0)
-            taps[i] = ps_taps[i].Process(taps[i]);
+    // Main delays, both regenerate into the shared line so each feeds back half
+    for (size_t side = 0; side < 2; side++) {
+        const size_t tap = side == 0 ? s_mainTapLeft : s_mainTapRight;
+        s_taps.SetTapDelay(tap, m_delayTarget[side]);
+        s_taps.SetTapLevel(tap, 1.0f / 3.0f);
+        s_taps.SetTapPan(tap, side == 0 ? -1.0f : 1.0f);
+        s_taps.SetTapFeedback(tap, feedback * 0.5f);
     }
 
-    sig += taps[0] / 3.f + taps[1] / 3.f;
+    // Shift taps, the first two on the left and the others on the right
+    for (size_t i = 0; i < 4; i++) {
+        const size_t tap = s_shiftTapFirst + i;
+        s_taps.SetTapDelay(tap, m_tapTargetDelay[i]);
+        s_taps.SetTapPitch(tap, m_pitchShiftMin + (m_pitchShiftMax - m_pitchShiftMin) * GetParameterAsFloat(5 + i));
+        s_taps.SetTapLevel(tap, 1.0f / 3.0f);
+        s_taps.SetTapPan(tap, i < 2 ? -1.0f : 1.0f);
+    }
 
-    m_audioLeft = sig * GetParameterAsFloat(0) + m_audioLeft * (1.0f - GetParameterAsFloat(0));
-    m_audioRight = m_audioLeft;
+    // Pattern taps subdivide the main delays
+    s_taps.SetTapDelay(s_patternTapLeft, m_delayTarget[0] * patternFraction);
+    s_taps.SetTapDelay(s_patternTapRight, m_delayTarget[1] * patternFraction);
+    s_taps.SetTapLevel(s_patternTapLeft, patternFraction > 0.0f ? 1.0f / 3.0f : 0.0f);
+    s_taps.SetTapLevel(s_patternTapRight, patternFraction > 0.0f ? 1.0f / 3.0f : 0.0f);
+    s_taps.SetTapPan(s_patternTapLeft, -1.0f);
+    s_taps.SetTapPan(s_patternTapRight, 1.0f);
+}
+
+void MultiDelayModule::ProcessMono(float in) {
+    float outL, outR;
+    ProcessMonoBlock(&in, &outL, &outR, 1);
+    m_audioLeft = outL;
+    m_audioRight = outR;
 }
 
 void MultiDelayModule::ProcessStereo(float inL, float inR) {
-    // Calculate the mono effect
-    ProcessMono(inL);
-    inR = inL;
-    // Do the base stereo calculation (which resets the right signal to be the inputR instead of combined mono)
-    BaseEffectModule::ProcessStereo(m_audioLeft, inR);
-    float taps[2];
-    float sig = delays[1].Process(GetParameterAsFloat(3), m_audioRight) / 3.f;
-    for (int i = 0; i < 2; ++i) {
-        PreProcessTaps(&tap_delays[i + 2], m_tapTargetDelay[i + 2]);
-        taps[i] = delays[1].del->Read(tap_delays[i + 2]);
-        // temporary workaround, only process one pitch shifter for now, using all 4 causes right channel to be silent.
-        if (i == 0)
-            taps[i] = ps_taps[i + 2].Process(taps[i]);
+    float outL, outR;
+    ProcessStereoBlock(&inL, &inR, &outL, &outR, 1);
+    m_audioLeft = outL;
+    m_audioRight = outR;
+}
+
+void MultiDelayModule::ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) {
+    ProcessStereoBlock(in, in, outL, outR, size);
+
+    // Mono keeps the left side, as the two sides are different delays
+    for (size_t i = 0; i < size; i++) {
+        outR[i] = outL[i];
+    }
+}
+
+void MultiDelayModule::ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) {
+    // The delays are fed from the left input only
+    s_taps.Process(inL, outL, outR, size);
+
+    const float wet = GetParameterAsFloat(0);
+    for (size_t i = 0; i < size; i++) {
+        const float dry = inL[i] * (1.0f - wet);
+        outL[i] = outL[i] * wet + dry;
+        outR[i] = outR[i] * wet + dry;
     }
-    sig += taps[0] / 3.f + taps[1] / 3.f;
 
-    m_audioRight = sig * GetParameterAsFloat(0) + m_audioRight * (1.0f - GetParameterAsFloat(0));
+    m_audioLeft = outL[size - 1];
+    m_audioRight = outR[size - 1];
 }
 
 void MultiDelayModule::SetTempo(uint32_t bpm) {
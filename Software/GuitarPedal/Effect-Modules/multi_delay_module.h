@@ -2,6 +2,7 @@
 #ifndef MULTI_DELAY_MODULE_H
 #define MULTI_DELAY_MODULE_H
 
+#include "../Util/multi_tap_delay.h"
 #include "base_effect_module.h"
 #include "daisysp.h"
 #include <stdint.h>
@@ -18,22 +19,42 @@ class MultiDelayModule : public BaseEffectModule {
     MultiDelayModule();
     ~MultiDelayModule();
 
+    // Delay Max Definitions (Assumes 48kHz samplerate)
+    static constexpr size_t s_maxDelaySamples = static_cast<size_t>(48000.0f * 8.f);
+
+    // Taps of the shared line: the two main delays (left and right), the four shift taps and two pattern taps
+    static constexpr size_t s_tapCount = 8;
+
+    // The line is rounded up to a power of two and keeps room for the pitch shift window above the longest delay
+    static constexpr size_t s_lineSize = NextPowerOfTwo(s_maxDelaySamples + MultiTapDelay<s_tapCount>::PitchWindow + 2);
+
+    // Shared SDRAM taken while the effect is active (the line all the taps read)
+    static constexpr size_t s_sharedMemorySize = MemoryArena::AlignedSize(sizeof(float) * s_lineSize);
+
     void Init(float sample_rate) override;
+    bool UsesSharedMemory() const override { return true; }
+    bool OnAcquireSharedMemory(MemoryArena &arena) override;
+    void OnReleaseSharedMemory() override;
     void ProcessMono(float in) override;
     void ProcessStereo(float inL, float inR) override;
+    void ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) override;
+    void ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) override;
     void SetTempo(uint32_t bpm) override;
     float GetBrightnessForLED(int led_id) const override;
-    void SetDelayTime(uint8_t index, float delay);
     void ParameterChanged(int parameter_id);
     void SetTargetTapDelayTime(uint8_t index, float value, float multiplier);
 
   private:
+    // Pushes the delay, shift, level and feedback settings to the taps
+    void UpdateTaps();
+
     bool m_isInitialized;
     float m_cachedEffectMagnitudeValue;
     float m_delaySamplesMin;
     float m_delaySamplesMax;
     float m_pitchShiftMin;
     float m_pitchShiftMax;
+    float m_delayTarget[2] = {0.0f, 0.0f};
     float m_tapTargetDelay[4] = {0.0f, 0.0f, 0.0f, 0.0f};
 };
 } // namespace bkshepherd
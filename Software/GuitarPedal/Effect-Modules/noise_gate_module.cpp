@@ -1,5 +1,5 @@
 #include "noise_gate_module.h"
-#include <q/fx/envelope.hpp>
+#include <math.h>
 
 using namespace bkshepherd;
 
@@ -8,9 +8,6 @@ using namespace bkshepherd;
 // signal
 const float maxThreshold = 0.2;
 
-// These are placeholder values that will get overwritten with the attack and release parameters at initialization
-cycfi::q::ar_envelope_follower env_follower(48000.0, 0.002f, 0.020f);
-
 static const int s_paramCount = 5;
 static const ParameterMetaData s_metaData[s_paramCount] = {{
                                                                name : "Threshold",
@@ -62,7 +59,9 @@ static const ParameterMetaData s_metaData[s_paramCount] = {{
                                                            }};
 
 // Default Constructor
-NoiseGateModule::NoiseGateModule() : BaseEffectModule() {
+NoiseGateModule::NoiseGateModule()
+    : BaseEffectModule(), m_envelope(0.0f), m_attackCoefficient(1.0f), m_releaseCoefficient(1.0f), m_holdTimer(0.0f),
+      m_gateOpen(false), m_currentGain(0.0f) {
     // Set the name of the effect
     m_name = "Noise Gate";
 
@@ -81,37 +80,39 @@ NoiseGateModule::~NoiseGateModule() {
 void NoiseGateModule::Init(float sample_rate) {
     BaseEffectModule::Init(sample_rate);
 
-    env_follower.config(GetParameterAsFloat(1) / 1000.f, GetParameterAsFloat(2) / 1000.f, sample_rate);
+    m_attackCoefficient = Coefficient(GetParameterAsFloat(1) / 1000.f);
+    m_releaseCoefficient = Coefficient(GetParameterAsFloat(2) / 1000.f);
 }
 
+float NoiseGateModule::Coefficient(float seconds) const { return 1.0f - expf(-1.0f / (seconds * GetSampleRate())); }
+
 void NoiseGateModule::ParameterChanged(int parameter_id) {
     switch (parameter_id) {
     case 1:
-        env_follower.attack(GetParameterAsFloat(1) / 1000.f, GetSampleRate());
+        m_attackCoefficient = Coefficient(GetParameterAsFloat(1) / 1000.f);
         break;
     case 2:
-        env_follower.release(GetParameterAsFloat(2) / 1000.f, GetSampleRate());
+        m_releaseCoefficient = Coefficient(GetParameterAsFloat(2) / 1000.f);
         break;
     }
 }
 
 void NoiseGateModule::ProcessMono(float in) {
-    // Update envelope follower with input signal
-    const float raw_env_level = env_follower(std::abs(in));
+    // Follow the peak of the block from the shared analysis. It is held for the whole block, which smooths the envelope and
+    // opens the gate up to a block ahead of the attack
+    const float peak = GetSignalAnalysis().peak;
+    m_envelope += (peak > m_envelope ? m_attackCoefficient : m_releaseCoefficient) * (peak - m_envelope);
 
-    // Run a smoothing filter on the envelope to prevent crackling due to rapid adjustments of the envelope state
-    const float currentTimeInSeconds = static_cast<float>(daisy::System::GetNow()) / 1000.f;
-    const float smoothed_env_level = m_smoothingFilter(raw_env_level, currentTimeInSeconds);
+    // Time advances by a sample
+    const float dt = 1.0f / GetSampleRate();
 
-    if (smoothed_env_level > GetParameterAsFloat(0) * maxThreshold) {
+    if (m_envelope > GetParameterAsFloat(0) * maxThreshold) {
         // Signal is above the threshold, open the gate and reset the timer
         m_gateOpen = true;
         m_holdTimer = 0.0f;
         m_currentGain = 1.0f; // Fully open
     } else if (m_gateOpen) {
         // Signal is below the threshold but within hold time
-
-        const float dt = currentTimeInSeconds - m_prevTimeSeconds;
         m_holdTimer += dt;
 
         if (m_holdTimer >= (GetParameterAsFloat(3) / 1000.0f)) {
@@ -125,8 +126,6 @@ void NoiseGateModule::ProcessMono(float in) {
         }
     }
 
-    m_prevTimeSeconds = currentTimeInSeconds;
-
     // Apply noise gate using the smoothed envelope value and hold time, and
     // also the current gain value (used for fade)
     const float out = m_gateOpen ? in * m_currentGain : 0.0f;
@@ -4,7 +4,6 @@
 
 #include <stdint.h>
 
-#include "../Util/1efilter.hpp"
 #include "base_effect_module.h"
 
 #ifdef __cplusplus
@@ -25,16 +24,16 @@ class NoiseGateModule : public BaseEffectModule {
     float GetBrightnessForLED(int led_id) const override;
 
   private:
-    // inputs:
-    // estimated frequency: overwritten by timestamps at runtime and not used
-    // cutoff freq
-    // beta: 0.0f disables it entirely, but used for scaling cutoff frequency
-    // derivative cutoff freq: used when beta is > 0
-    one_euro_filter<float, float> m_smoothingFilter{48000, 0.5f, 0.05f, 1.0f};
+    // One pole coefficient per sample for a time in seconds
+    float Coefficient(float seconds) const;
+
+    // Envelope of the block peaks of the shared analysis with the attack and release of the parameters
+    float m_envelope;
+    float m_attackCoefficient;
+    float m_releaseCoefficient;
 
     float m_holdTimer; // Timer tracking hold duration
     bool m_gateOpen;   // Is the gate currently open?
-    float m_prevTimeSeconds;
 
     float m_currentGain;
 };
@@ -10,6 +10,7 @@ using namespace bkshepherd;
 static const char *s_semitoneBinNames[8] = {"1", "2", "3", "4", "5", "6", "7", "OCT"};
 static const char *s_directionBinNames[2] = {"DOWN", "UP"};
 static const char *s_modeBinNames[2] = {"LATCH", "MOMENT"};
+static const char *s_engineBinNames[2] = {"DELAY", "PSOLA"};
 
 // How many samples to delay to based on the "Delay" knob and parameter
 // when the time knob is set to max, this is used for the ramp up/down
@@ -23,9 +24,12 @@ const uint32_t k_maxSamplesMaxTime = 48000 * 2;
 // but is a whopping 125 ms, nearly unusable? kind of cool when blended
 // with the dry signal though
 const uint32_t k_defaultSamplesDelayPitchShifter = 2048;
-const uint32_t k_maxSamplesDelayPitchShifter = 6000;
+const uint32_t k_maxSamplesDelayPitchShifter = PitchShifterModule::s_maxDelaySamples;
 
-static const int s_paramCount = 6;
+// The delay engine works on anything (chords included) but its latency is the delay size. PSOLA follows the detected
+// pitch, so it's for single notes, with a latency of at most one period. On the host (ci/pitch_shifter_benchmark)
+// the delay engine takes about 9ns per sample and PSOLA 6ns shifting an octave down to 16ns an octave up
+static const int s_paramCount = 7;
 static const ParameterMetaData s_metaData[s_paramCount] = {
     {
         name : "Semitone",
@@ -78,11 +82,17 @@ static const ParameterMetaData s_metaData[s_paramCount] = {
         knobMapping : 5,
         midiCCMapping : -1
     },
+    {
+        name : "Engine",
+        valueType : ParameterValueType::Binned,
+        valueBinCount : 2,
+        valueBinNames : s_engineBinNames,
+        defaultValue : {.uint_value = 0},
+        knobMapping : -1,
+        midiCCMapping : -1
+    },
 };
 
-DSY_SDRAM_BSS float pitch_delay_buffer_a[k_maxSamplesDelayPitchShifter];
-DSY_SDRAM_BSS float pitch_delay_buffer_b[k_maxSamplesDelayPitchShifter];
-
 static daisysp_modified::PitchShifter pitchShifter;
 static daisysp::CrossFade pitchCrossfade;
 
@@ -129,22 +139,31 @@ void PitchShifterModule::SetTranspose(float semitone) {
         pitchShifter.SetDelSize(std::clamp(delaySize, k_defaultSamplesDelayPitchShifter, k_maxSamplesDelayPitchShifter));
     }
     pitchShifter.SetTransposition(semitone);
+
+    // Both engines follow the transposition so switching between them doesn't need a reset
+    m_psola.SetTransposition(semitone);
 }
 
-void PitchShifterModule::Init(float sample_rate) {
-    BaseEffectModule::Init(sample_rate);
+float PitchShifterModule::ProcessEngine(float in) {
+    if (m_psolaEngine) {
+        m_psola.SetFrequency(GetSignalAnalysis().frequency);
+        return m_psola.Process(in);
+    }
 
-    // clear and initialize SDRAM for pitch shift buffers
-    memset(pitch_delay_buffer_a, 0, sizeof(pitch_delay_buffer_a));
-    memset(pitch_delay_buffer_b, 0, sizeof(pitch_delay_buffer_b));
+    return pitchShifter.Process(in);
+}
 
-    pitchShifter.Init(sample_rate, pitch_delay_buffer_a, pitch_delay_buffer_b, k_maxSamplesDelayPitchShifter);
+void PitchShifterModule::Init(float sample_rate) {
+    BaseEffectModule::Init(sample_rate);
 
+    // The pitch shifter is set up when its buffers are leased, see OnAcquireSharedMemory
     pitchCrossfade.Init(CROSSFADE_CPOW);
     pitchCrossfade.SetPos(GetParameterAsFloat(1));
 
     m_latching = GetParameterAsBinnedValue(3) == 1;
 
+    m_psolaEngine = GetParameterAsBinnedValue(6) == 2;
+
     m_directionDown = GetParameterAsBinnedValue(2) == 1;
 
     ProcessSemitoneTargetChange();
@@ -155,6 +174,31 @@ void PitchShifterModule::Init(float sample_rate) {
     m_samplesToDelayReturn = static_cast<uint32_t>(static_cast<float>(k_maxSamplesMaxTime) * GetParameterAsFloat(5));
 }
 
+bool PitchShifterModule::OnAcquireSharedMemory(MemoryArena &arena) {
+    float *bufferA = arena.NewArray<float>(s_delayBufferSize);
+    float *bufferB = arena.NewArray<float>(s_delayBufferSize);
+    float *psolaBuffer = arena.NewArray<float>(s_psolaBufferSize);
+
+    if (bufferA == nullptr || bufferB == nullptr || psolaBuffer == nullptr) {
+        return false;
+    }
+
+    // clear and initialize SDRAM for pitch shift buffers
+    memset(bufferA, 0, sizeof(float) * s_delayBufferSize);
+    memset(bufferB, 0, sizeof(float) * s_delayBufferSize);
+
+    pitchShifter.Init(GetSampleRate(), bufferA, bufferB, k_maxSamplesDelayPitchShifter);
+    m_psola.Init(GetSampleRate(), psolaBuffer, s_psolaBufferSize);
+
+    // Init resets the delay size, apply the current transposition again
+    if (!m_latching) {
+        pitchShifter.SetDelSize(k_defaultSamplesDelayPitchShifter);
+    }
+    SetTranspose(m_semitoneTarget);
+
+    return true;
+}
+
 void PitchShifterModule::ParameterChanged(int parameter_id) {
     if (parameter_id == 0 || parameter_id == 2) {
         m_directionDown = GetParameterAsBinnedValue(2) == 1;
@@ -172,6 +216,8 @@ void PitchShifterModule::ParameterChanged(int parameter_id) {
         m_samplesToDelayShift = static_cast<uint32_t>(static_cast<float>(k_maxSamplesMaxTime) * GetParameterAsFloat(4));
     } else if (parameter_id == 5) {
         m_samplesToDelayReturn = static_cast<uint32_t>(static_cast<float>(k_maxSamplesMaxTime) * GetParameterAsFloat(5));
+    } else if (parameter_id == 6) {
+        m_psolaEngine = GetParameterAsBinnedValue(6) == 2;
     }
 
     // Parameters changed, reset the transposition target just in case (mostly
@@ -221,7 +267,7 @@ void PitchShifterModule::ProcessMono(float in) {
     if (m_latching) {
         // When in latching mode, just process the target semitone at all times
         // immediately
-        float shifted = pitchShifter.Process(in);
+        float shifted = ProcessEngine(in);
         out = pitchCrossfade.Process(in, shifted);
     } else {
         out = ProcessMomentaryMode(in);
@@ -232,6 +278,28 @@ void PitchShifterModule::ProcessMono(float in) {
 
 void PitchShifterModule::ProcessStereo(float inL, float inR) { ProcessMono(inL); }
 
+void PitchShifterModule::ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) {
+    // Momentary transitions change the transposition every sample and PSOLA reads the pitch per sample, those go sample by
+    // sample
+    if (!m_latching || m_psolaEngine) {
+        BaseEffectModule::ProcessMonoBlock(in, outL, outR, size);
+        return;
+    }
+
+    pitchShifter.Process(in, outL, size);
+    for (size_t i = 0; i < size; i++) {
+        float dry = in[i];
+        outL[i] = pitchCrossfade.Process(dry, outL[i]);
+        outR[i] = outL[i];
+    }
+
+    m_audioLeft = m_audioRight = size > 0 ? outL[size - 1] : 0.0f;
+}
+
+void PitchShifterModule::ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) {
+    ProcessMonoBlock(inL, outL, outR, size);
+}
+
 float PitchShifterModule::ProcessMomentaryMode(float in) {
     // ---- Process when NOT in a ramp up/ramp down state ----
     if (!m_transitioningShift && !m_transitioningReturn) {
@@ -248,7 +316,7 @@ float PitchShifterModule::ProcessMomentaryMode(float in) {
 
         // Process the pitch shift for completely active to the target
         SetTranspose(semitone);
-        float shifted = pitchShifter.Process(in);
+        float shifted = ProcessEngine(in);
         float out = pitchCrossfade.Process(in, shifted);
         return out;
     }
@@ -280,7 +348,7 @@ float PitchShifterModule::ProcessMomentaryMode(float in) {
         SetTranspose(m_semitoneTarget * (1.0f - m_percentageTransitionComplete));
     }
 
-    float shifted = pitchShifter.Process(in);
+    float shifted = ProcessEngine(in);
     float pitchOut = pitchCrossfade.Process(in, shifted);
 
     // Increment the counter for the next pass
@@ -4,6 +4,8 @@
 
 #include <stdint.h>
 
+#include "../Util/masked_delay_line.h"
+#include "../Util/psola_shifter.h"
 #include "base_effect_module.h"
 #ifdef __cplusplus
 
@@ -16,11 +18,31 @@ class PitchShifterModule : public BaseEffectModule {
     PitchShifterModule();
     ~PitchShifterModule();
 
+    // Longest delay the pitch shifter uses, 125ms at 48kHz for a full octave
+    static constexpr uint32_t s_maxDelaySamples = 6000;
+
+    // The delay lines wrap with a mask, so the buffers are rounded up to a power of two
+    static constexpr size_t s_delayBufferSize = NextPowerOfTwo(s_maxDelaySamples);
+
+    // Input of the PSOLA engine, 4 periods of the lowest note it shifts (23Hz at 48kHz)
+    static constexpr size_t s_psolaBufferSize = 8192;
+
+    // Shared SDRAM taken while the effect is active (the two delay buffers and the PSOLA input)
+    static constexpr size_t s_sharedMemorySize =
+        2 * MemoryArena::AlignedSize(sizeof(float) * s_delayBufferSize) + MemoryArena::AlignedSize(sizeof(float) * s_psolaBufferSize);
+
     void Init(float sample_rate) override;
+    bool UsesSharedMemory() const override { return true; }
+    bool OnAcquireSharedMemory(MemoryArena &arena) override;
     void ProcessMono(float in) override;
     void ProcessStereo(float inL, float inR) override;
+    void ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) override;
+    void ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) override;
     void ParameterChanged(int parameter_id) override;
 
+    // The PSOLA engine places its grains on the period of the input
+    bool NeedsPitchAnalysis() const override { return m_psolaEngine; }
+
     bool AlternateFootswitchForTempo() const override { return false; }
     void AlternateFootswitchPressed() override;
     void AlternateFootswitchReleased() override;
@@ -29,10 +51,12 @@ class PitchShifterModule : public BaseEffectModule {
 
   private:
     void SetTranspose(float semitone);
+    float ProcessEngine(float in);
     float ProcessMomentaryMode(float in);
     void ProcessSemitoneTargetChange();
 
     bool m_latching = true;
+    bool m_psolaEngine = false;
     bool m_directionDown = true;
     bool m_alternateFootswitchPressed = false;
 
@@ -46,6 +70,8 @@ class PitchShifterModule : public BaseEffectModule {
     bool m_transitioningReturn = false;
 
     float m_percentageTransitionComplete = 0.0;
+
+    PsolaShifter m_psola;
 };
 } // namespace bkshepherd
 #endif
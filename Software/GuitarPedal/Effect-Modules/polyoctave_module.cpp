@@ -1,5 +1,6 @@
 #include "polyoctave_module.h"
 #include "../Util/audio_utilities.h"
+#include "../Util/memory_placement.h"
 
 #include <q/fx/biquad.hpp>
 #include <q/support/literals.hpp>
@@ -8,19 +9,35 @@
 #include "../Util/Multirate.h"
 #include "../Util/OctaveGenerator.h"
 
+#include <atomic>
+
 using namespace bkshepherd;
 namespace q = cycfi::q;
 using namespace q::literals;
 
-static Decimator2 decimate;
-static Interpolator interpolate;
-static const auto sample_rate_temp =
-    48000; // hard code for now                          // NOTE: the sample_rate must be divisible by the resample_factor (48/6 = 8)
-static OctaveGenerator octave(sample_rate_temp / resample_factor); // resample_factor is defined in Multirate.h and equals 6
-static q::highshelf eq1(-11, 140_Hz, sample_rate_temp);
-static q::lowshelf eq2(5, 160_Hz, sample_rate_temp);
+// Filter and band states, all of them run every sample. Everything is set up for the engine's sample rate in Init(): the
+// octave generator runs at about 8kHz, 1 / resample_factor_for(sample_rate) of it (4 at 32kHz, 6 at 48kHz, 12 at 96kHz), and
+// the decimation / interpolation filters are designed for that rate and factor (see Multirate.h)
+static HOT_DTCM PolyphaseDecimator decimate;
+static HOT_DTCM PolyphaseInterpolator interpolate;
+static HOT_DTCM OctaveGenerator octave;
+static HOT_DTCM q::highshelf eq1(-11, 140_Hz, 48000);
+static HOT_DTCM q::lowshelf eq2(5, 160_Hz, 48000);
+
+// Bands designed on the main loop when the Bands parameter changes, the audio callback only copies them over (see
+// UpdateBandCount). Read once per change, so it can stay out of DTCM
+static WARM_SRAM OctaveGenerator::Design s_pendingDesign;
+
+// Largest block processed in one pass, longer blocks are split. The low rate samples of a pass, 8 for a 48 sample block at
+// 48kHz
+static constexpr size_t s_maxBlockSize = 48;
+static HOT_DTCM float s_lowRate[s_maxBlockSize];
 
-static const int s_paramCount = 4;
+// Bands the octave generator runs with, fewer bands track less cleanly for less CPU (see ci/octave_benchmark.cpp)
+static const char *s_bandNames[3] = {"40", "60", "80"};
+static const int s_bandCounts[3] = {40, 60, 80};
+
+static const int s_paramCount = 5;
 static const ParameterMetaData s_metaData[s_paramCount] = {
     {name : "Dry", valueType : ParameterValueType::Float, defaultValue : {.float_value = 0.5f}, knobMapping : 0, midiCCMapping : 14},
     {
@@ -44,6 +61,15 @@ static const ParameterMetaData s_metaData[s_paramCount] = {
         knobMapping : 3,
         midiCCMapping : 17
     },
+    {
+        name : "Bands",
+        valueType : ParameterValueType::Binned,
+        valueBinCount : 3,
+        valueBinNames : s_bandNames,
+        defaultValue : {.uint_value = 2},
+        knobMapping : -1,
+        midiCCMapping : 18
+    },
 };
 
 // Default Constructor
@@ -68,32 +94,67 @@ PolyOctaveModule::~PolyOctaveModule() {
 void PolyOctaveModule::Init(float sample_rate) {
     BaseEffectModule::Init(sample_rate);
 
+    m_factor = resample_factor_for(sample_rate);
+    decimate.init(m_factor, sample_rate);
+    interpolate.init(m_factor, sample_rate);
+    eq1 = q::highshelf(-11, 140_Hz, sample_rate);
+    eq2 = q::lowshelf(5, 160_Hz, sample_rate);
+
+    m_designReady = false;
+    m_bandCount = s_bandCounts[GetParameterAsBinnedValue(4) - 1];
+    octave.init(sample_rate / m_factor, m_bandCount);
+
     // Initialize buffers to 0
-    for (int j = 0; j < 6; ++j) {
+    bin_counter = 0;
+    for (size_t j = 0; j < s_maxFactor; ++j) {
         buff[j] = 0.0;
         buff_out[j] = 0.0;
     }
 }
 
+void PolyOctaveModule::ParameterChanged(int parameter_id) {
+    // Init() designs the first bands
+    if (parameter_id != 4 || m_bandCount == 0) {
+        return;
+    }
+
+    const int bands = s_bandCounts[GetParameterAsBinnedValue(4) - 1];
+    if (bands == m_bandCount) {
+        return;
+    }
+
+    // Up to 80 bands of double precision cos / sin / exp, too slow for the audio callback. The callback interrupts the main
+    // loop but not the other way round, so it doesn't look at the design while the flag is clear
+    m_designReady = false;
+    OctaveGenerator::design(s_pendingDesign, GetSampleRate() / m_factor, bands);
+    m_bandCount = bands;
+    std::atomic_signal_fence(std::memory_order_release);
+    m_designReady = true;
+}
+
+void PolyOctaveModule::UpdateBandCount() {
+    if (m_designReady) {
+        octave.load(s_pendingDesign);
+        m_designReady = false;
+    }
+}
+
 void PolyOctaveModule::ProcessMono(float in) {
     BaseEffectModule::ProcessMono(in);
 
-    buff[bin_counter] = in; // making a workaround for only processing sample by sample instead of block, will add 6 samples of latency
+    // Collects a chunk of m_factor samples (the block path doesn't need this), adds that many samples of latency
+    buff[bin_counter] = in;
 
     float dryLevel = GetParameterAsFloat(0);
     float down1Level = GetParameterAsFloat(1);
     float down2Level = GetParameterAsFloat(2);
     float up1Level = GetParameterAsFloat(3);
 
-    // for (size_t i = 0; i <= (size - resample_factor); i += resample_factor)  // Every 6 samples until block size
-    //{
-
-    // do calculation every 6 samples
-    if (bin_counter > 4) {
+    // do calculation every m_factor samples
+    if (bin_counter == static_cast<int>(m_factor) - 1) {
+        UpdateBandCount();
 
-        std::span<const float, resample_factor> in_chunk(&(buff[0]), resample_factor); // std::span is c++ 20 feature
-
-        const auto sample = decimate(in_chunk);
+        const auto sample = decimate(buff);
 
         float octave_mix = 0;
         octave.update(sample);
@@ -101,8 +162,9 @@ void PolyOctaveModule::ProcessMono(float in) {
         octave_mix += down1Level * octave.down1() * 4.0;
         octave_mix += down2Level * octave.down2() * 4.0;
 
-        auto out_chunk = interpolate(octave_mix);
-        for (size_t j = 0; j < out_chunk.size(); ++j) {
+        float out_chunk[s_maxFactor];
+        interpolate(octave_mix, out_chunk);
+        for (size_t j = 0; j < m_factor; ++j) {
             float mix = eq2(eq1(out_chunk[j]));
 
             mix += dryLevel * buff[j];
@@ -111,15 +173,70 @@ void PolyOctaveModule::ProcessMono(float in) {
         }
     }
 
-    // Sets increments the buffer index from 0 to 5 (workaround to adapt code)
+    // Sets increments the buffer index from 0 to m_factor - 1
     bin_counter += 1;
-    if (bin_counter > 5)
+    if (bin_counter >= static_cast<int>(m_factor))
         bin_counter = 0;
 
     m_audioLeft = buff_out[bin_counter];
     m_audioRight = m_audioLeft;
 }
 
+void PolyOctaveModule::ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) {
+    // Blocks that don't divide into low rate samples, or a chunk ProcessMono left half filled, go sample by sample
+    if (size % m_factor != 0 || bin_counter != 0) {
+        BaseEffectModule::ProcessMonoBlock(in, outL, outR, size);
+        return;
+    }
+
+    UpdateBandCount();
+
+    const float dryLevel = GetParameterAsFloat(0);
+    const float down1Level = GetParameterAsFloat(1) * 4.0f;
+    const float down2Level = GetParameterAsFloat(2) * 4.0f;
+    const float up1Level = GetParameterAsFloat(3) * 4.0f;
+
+    // Whole low rate samples per pass
+    const size_t maxCount = s_maxBlockSize - s_maxBlockSize % m_factor;
+
+    while (size > 0) {
+        const size_t count = size < maxCount ? size : maxCount;
+        const size_t lowRateCount = count / m_factor;
+
+        // Decimate the whole pass
+        for (size_t i = 0; i < lowRateCount; i++) {
+            s_lowRate[i] = decimate(in + i * m_factor);
+        }
+
+        // Octaves at the low rate
+        for (size_t i = 0; i < lowRateCount; i++) {
+            octave.update(s_lowRate[i]);
+            s_lowRate[i] = up1Level * octave.up1() + down1Level * octave.down1() + down2Level * octave.down2();
+        }
+
+        // Back to the engine rate, without the latency of the sample path
+        for (size_t i = 0; i < lowRateCount; i++) {
+            float out_chunk[s_maxFactor];
+            interpolate(s_lowRate[i], out_chunk);
+            for (size_t j = 0; j < m_factor; j++) {
+                const size_t k = i * m_factor + j;
+                outL[k] = eq2(eq1(out_chunk[j])) + dryLevel * in[k];
+                outR[k] = outL[k];
+            }
+        }
+
+        in += count;
+        outL += count;
+        outR += count;
+        size -= count;
+    }
+}
+
+void PolyOctaveModule::ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) {
+    // Mono only for now, like ProcessStereo
+    ProcessMonoBlock(inL, outL, outR, size);
+}
+
 void PolyOctaveModule::ProcessStereo(float inL, float inR) {
     // Calculate the mono effect
     ProcessMono(inL);
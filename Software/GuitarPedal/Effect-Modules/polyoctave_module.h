@@ -25,12 +25,33 @@ class PolyOctaveModule : public BaseEffectModule {
     void Init(float sample_rate) override;
     void ProcessMono(float in) override;
     void ProcessStereo(float inL, float inR) override;
+    void ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) override;
+    void ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) override;
+    void ParameterChanged(int parameter_id) override;
     float GetBrightnessForLED(int led_id) const override;
 
   private:
+    // Largest resample factor (max_resample_factor in Multirate.h), 12 at 96kHz
+    static constexpr size_t s_maxFactor = 12;
+
+    // Switches the octave generator to the bands designed by ParameterChanged(), from the audio callback between two low rate
+    // samples
+    void UpdateBandCount();
+
+    // Low rate samples are taken every m_factor samples, chosen for the sample rate in Init()
+    size_t m_factor = 6;
+
+    // Bands of the latest design, 0 until Init()
+    int m_bandCount = 0;
+
+    // Set by the main loop once a new design is complete, cleared by the audio callback when it switched to it
+    volatile bool m_designReady = false;
+
+    // Sample path (ProcessMono / ProcessStereo), collects a chunk of m_factor samples and adds that much latency. The block
+    // path processes whole chunks straight away
     int bin_counter = 0;
-    float buff[6];
-    float buff_out[6];
+    float buff[s_maxFactor];
+    float buff_out[s_maxFactor];
 
     float m_tremoloFreqMin;
     float m_tremoloFreqMax;
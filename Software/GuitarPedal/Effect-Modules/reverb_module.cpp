@@ -28,7 +28,6 @@ static const ParameterMetaData s_metaData[s_paramCount] = {{
                                                                midiCCMapping : 22
                                                            }};
 
-ReverbSc DSY_SDRAM_BSS reverbStereo;
 // Default Constructor
 ReverbModule::ReverbModule()
     : BaseEffectModule(), m_timeMin(0.6f), m_timeMax(1.0f), m_lpFreqMin(600.0f), m_lpFreqMax(16000.0f)
@@ -51,10 +50,23 @@ ReverbModule::~ReverbModule() {
 
 void ReverbModule::Init(float sample_rate) {
     BaseEffectModule::Init(sample_rate);
-    m_reverbStereo = &reverbStereo;
-    m_reverbStereo->Init(sample_rate);
+    // The reverb is created when the shared SDRAM is leased, see OnAcquireSharedMemory
+    m_reverbStereo = nullptr;
 }
 
+bool ReverbModule::OnAcquireSharedMemory(MemoryArena &arena) {
+    m_reverbStereo = arena.New<ReverbSc>();
+
+    if (m_reverbStereo == nullptr) {
+        return false;
+    }
+
+    m_reverbStereo->Init(GetSampleRate());
+    return true;
+}
+
+void ReverbModule::OnReleaseSharedMemory() { m_reverbStereo = nullptr; }
+
 void ReverbModule::ProcessMono(float in) {
     BaseEffectModule::ProcessMono(in);
 
@@ -18,7 +18,13 @@ class ReverbModule : public BaseEffectModule {
     ReverbModule();
     ~ReverbModule();
 
+    // Shared SDRAM taken while the effect is active (the reverb and its delay memory)
+    static constexpr size_t s_sharedMemorySize = MemoryArena::AlignedSize(sizeof(ReverbSc));
+
     void Init(float sample_rate) override;
+    bool UsesSharedMemory() const override { return true; }
+    bool OnAcquireSharedMemory(MemoryArena &arena) override;
+    void OnReleaseSharedMemory() override;
     void ProcessMono(float in) override;
     void ProcessStereo(float inL, float inR) override;
     float GetBrightnessForLED(int led_id) const override;
@@ -21,7 +21,6 @@ static OctaveGenerator octave_scifi(sample_rate_temp / resample_factor); // resa
 static q::highshelf eq1_scifi(-11, 140_Hz, sample_rate_temp);
 static q::lowshelf eq2_scifi(5, 160_Hz, sample_rate_temp);
 
-ReverbSc DSY_SDRAM_BSS reverbStereo_scifi;
 
 static const int s_paramCount = 9;
 static const ParameterMetaData s_metaData[s_paramCount] = {
@@ -117,13 +116,26 @@ void SciFiModule::Init(float sample_rate) {
         buff_out[j] = 0.0;
     }
 
-    m_reverbStereo = &reverbStereo_scifi;
-    m_reverbStereo->Init(sample_rate);
+    // The reverb is created when the shared SDRAM is leased, see OnAcquireSharedMemory
+    m_reverbStereo = nullptr;
 
     m_overdriveLeft.Init();
     m_overdriveRight.Init();
 }
 
+bool SciFiModule::OnAcquireSharedMemory(MemoryArena &arena) {
+    m_reverbStereo = arena.New<ReverbSc>();
+
+    if (m_reverbStereo == nullptr) {
+        return false;
+    }
+
+    m_reverbStereo->Init(GetSampleRate());
+    return true;
+}
+
+void SciFiModule::OnReleaseSharedMemory() { m_reverbStereo = nullptr; }
+
 void SciFiModule::ProcessMono(float in) {
     BaseEffectModule::ProcessMono(in);
 
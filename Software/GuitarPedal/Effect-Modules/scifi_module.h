@@ -24,7 +24,13 @@ class SciFiModule : public BaseEffectModule {
     SciFiModule();
     ~SciFiModule();
 
+    // Shared SDRAM taken while the effect is active, only the reverb tail needs it
+    static constexpr size_t s_sharedMemorySize = MemoryArena::AlignedSize(sizeof(ReverbSc));
+
     void Init(float sample_rate) override;
+    bool UsesSharedMemory() const override { return true; }
+    bool OnAcquireSharedMemory(MemoryArena &arena) override;
+    void OnReleaseSharedMemory() override;
     void ProcessMono(float in) override;
     void ProcessStereo(float inL, float inR) override;
     float GetBrightnessForLED(int led_id) const override;
@@ -2,15 +2,11 @@
 #ifndef SPECTRAL_DELAY_MODULE_H
 #define SPECTRAL_DELAY_MODULE_H
 
-#include "base_effect_module.h"
+#include "../Util/spectral_delay_line.h"
 #include "daisysp.h"
+#include "spectral_effect_module.h"
 #include <stdint.h>
 
-// clang-format off
-#include "../Util/STFT/shy_fft.h"
-#include "../Util/STFT/fourier.h"
-#include "../Util/STFT/wave.h"
-// clang-format on
 #include <cmath>
 #include <complex>
 
@@ -24,24 +20,42 @@ using namespace soundmath;
 /** @file spectral_delay_module.h */
 
 // NOTES: During testing, DTCRAM overflowing was an issue. Removing Stereo capability helped (i.e. removing one of the stft's).
-//  The Hann and HalfHann lookup tables are stored in DTCRAM. HalfHann is not used, so this is commented out.
+//  The Hann lookup table is stored in DTCRAM and shared by all spectral effects (see SpectralEffectModule).
 
 using namespace daisysp;
 
 namespace bkshepherd {
 
-class SpectralDelayModule : public BaseEffectModule {
+class SpectralDelayModule : public SpectralEffectModule {
   public:
     SpectralDelayModule();
     ~SpectralDelayModule();
 
+    // Length of the frame ring, 4 seconds with 188 frames per second and the 2 frames the delay needs on top
+    static constexpr size_t s_maxDelayFrames = static_cast<size_t>(188 * 4.f) + 2;
+
+    typedef SpectralDelayLine<s_binCount> BinDelay;
+
+    // Shared SDRAM taken while the effect is active (the STFT buffers and the frame ring of the bin delays)
+    static constexpr size_t s_sharedMemorySize = StftMemorySize(1) + BinDelay::MemorySize(s_maxDelayFrames);
+
     void Init(float sample_rate) override;
     void ParameterChanged(int parameter_id) override;
+    bool UsesSharedMemory() const override { return true; }
+    bool OnAcquireSharedMemory(MemoryArena &arena) override;
+    void OnReleaseSharedMemory() override;
     void ProcessMono(float in) override;
     void ProcessStereo(float inL, float inR) override;
     float GetBrightnessForLED(int led_id) const override;
 
+  protected:
+    void ProcessSpectrum(size_t channel, const float *in, float *out) override;
+
   private:
+    // Every bin has its own delay time and feedback, the frames are in the shared SDRAM
+    BinDelay m_delay;
+    float m_tone;
+
     float m_cachedEffectMagnitudeValue;
 };
 } // namespace bkshepherd
@@ -0,0 +1,69 @@
+#include "spectral_effect_module.h"
+#include "../Util/memory_placement.h"
+
+using namespace bkshepherd;
+using namespace soundmath;
+
+// Analysis / synthesis window shared by all spectral effects, read for every sample of every frame. It can't go to SDRAM as its
+// constructor runs before the SDRAM is initialized
+static HOT_DTCM Wave<float> s_hann([](float phase) -> float {
+    return 0.5 * (1 - cos(2 * 3.1415926535897932384626433832795 * phase));
+});
+
+SpectralEffectModule::SpectralEffectModule(size_t channelCount)
+    : BaseEffectModule(), m_channelCount(channelCount < s_maxChannels ? channelCount : s_maxChannels), m_fft(nullptr) {
+    for (size_t channel = 0; channel < s_maxChannels; channel++) {
+        m_stft[channel] = nullptr;
+        m_channelProcessors[channel].module = this;
+        m_channelProcessors[channel].channel = channel;
+    }
+}
+
+SpectralEffectModule::~SpectralEffectModule() {
+    // No Code Needed
+}
+
+void SpectralEffectModule::Init(float sample_rate) {
+    BaseEffectModule::Init(sample_rate);
+
+    // The STFTs are created once their buffers are leased (see OnAcquireSharedMemory)
+    m_fft = SharedRealFFT<float, s_frameSize>();
+}
+
+bool SpectralEffectModule::OnAcquireSharedMemory(MemoryArena &arena) {
+    for (size_t channel = 0; channel < m_channelCount; channel++) {
+        // audio --> in --(fft)--> middle --(process)--> out --(ifft)--> in -->
+        float *in = arena.NewArray<float>(Stft::InSize(s_laps));
+        float *middle = arena.NewArray<float>(s_frameSize);
+        float *out = arena.NewArray<float>(s_frameSize);
+
+        if (in == nullptr || middle == nullptr || out == nullptr) {
+            return false;
+        }
+
+        m_stft[channel] = new Stft(&m_channelProcessors[channel], m_fft, &s_hann, s_laps, in, middle, out);
+    }
+
+    return true;
+}
+
+void SpectralEffectModule::OnReleaseSharedMemory() {
+    for (size_t channel = 0; channel < s_maxChannels; channel++) {
+        if (m_stft[channel] != nullptr) {
+            delete m_stft[channel];
+            m_stft[channel] = nullptr;
+        }
+    }
+}
+
+float SpectralEffectModule::ProcessStft(size_t channel, float in) {
+    Stft *stft = m_stft[channel];
+    stft->write(in);
+    return stft->read();
+}
+
+void SpectralEffectModule::AnalyzeStft(size_t channel, float in) { m_stft[channel]->write(in, false); }
+
+const float *SpectralEffectModule::GetSpectrum(size_t channel) const {
+    return m_stft[channel] != nullptr ? m_stft[channel]->spectrum() : nullptr;
+}
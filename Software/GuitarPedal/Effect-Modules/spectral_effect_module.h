@@ -0,0 +1,99 @@
+#pragma once
+#ifndef SPECTRAL_EFFECT_MODULE_H
+#define SPECTRAL_EFFECT_MODULE_H
+
+#include "base_effect_module.h"
+#include <stdint.h>
+
+// clang-format off
+#include "../Util/STFT/real_fft.h"
+#include "../Util/STFT/fourier.h"
+#include "../Util/STFT/wave.h"
+// clang-format on
+
+#ifdef __cplusplus
+
+/** @file spectral_effect_module.h */
+
+namespace bkshepherd {
+
+/** Base for effects that work on STFT frames.
+
+    Every channel has its own STFT (1024 point frames with 4 laps) with its buffers leased from the shared SDRAM, and all of
+    them share one FFT plan and analysis window. Effects implement ProcessSpectrum(), which is called once per frame for every
+    channel with the state of the effect instance, and run their channels with ProcessStft() from ProcessMono / ProcessStereo.
+*/
+class SpectralEffectModule : public BaseEffectModule {
+  public:
+    // STFT frame size and overlap, a new frame every 256 samples (187.5 frames per second)
+    static constexpr size_t s_frameSize = 1024;
+    static constexpr size_t s_laps = 4;
+    static constexpr size_t s_binCount = s_frameSize / 2;
+    static constexpr size_t s_maxChannels = 2;
+
+    // Samples from an input sample to its resynthesis, Stft::latency()
+    static constexpr size_t s_latency = s_frameSize - 1 + s_frameSize / s_laps;
+
+    typedef soundmath::Fourier<float, s_frameSize> Stft;
+
+    /** Shared SDRAM the STFTs of a number of channels take */
+    static constexpr size_t StftMemorySize(size_t channels) {
+        return channels * (MemoryArena::AlignedSize(sizeof(float) * Stft::InSize(s_laps)) +
+                           2 * MemoryArena::AlignedSize(sizeof(float) * s_frameSize));
+    }
+
+    /** \param channelCount Number of STFT channels, up to s_maxChannels */
+    SpectralEffectModule(size_t channelCount);
+    ~SpectralEffectModule();
+
+    void Init(float sample_rate) override;
+    bool UsesSharedMemory() const override { return true; }
+    bool OnAcquireSharedMemory(MemoryArena &arena) override;
+    void OnReleaseSharedMemory() override;
+
+  protected:
+    /** Processes one frame of a channel, called from inside ProcessStft() (in channel order when the channels are run in order
+        for every sample)
+        \param channel Channel of the frame
+        \param in Spectrum of the frame, the layout is described in STFT/real_fft.h
+        \param out Processed spectrum
+    */
+    virtual void ProcessSpectrum(size_t channel, const float *in, float *out) = 0;
+
+    /** Runs one sample through the STFT of a channel
+        \param channel Channel to run
+        \param in Input sample
+        \return Resynthesized sample, latency() of Stft behind the input
+    */
+    float ProcessStft(size_t channel, float in);
+
+    /** Runs one sample through the analysis of a channel only, for a channel that is just read with GetSpectrum(). Skips the
+        ProcessSpectrum() call, the inverse transform and the overlap-add of its frames
+        \param channel Channel to run
+        \param in Input sample
+    */
+    void AnalyzeStft(size_t channel, float in);
+
+    /** Latest spectrum of a channel, so a channel can read the analysis of another one in ProcessSpectrum() */
+    const float *GetSpectrum(size_t channel) const;
+
+    size_t GetChannelCount() const { return m_channelCount; }
+
+  private:
+    // Forwards the frames of one channel to ProcessSpectrum()
+    class ChannelProcessor : public soundmath::SpectralProcessor<float> {
+      public:
+        void process(const float *in, float *out) override { module->ProcessSpectrum(channel, in, out); }
+
+        SpectralEffectModule *module;
+        size_t channel;
+    };
+
+    size_t m_channelCount;
+    soundmath::RealFFT<float, s_frameSize> *m_fft;
+    Stft *m_stft[s_maxChannels];
+    ChannelProcessor m_channelProcessors[s_maxChannels];
+};
+} // namespace bkshepherd
+#endif
+#endif
@@ -0,0 +1,154 @@
+#include "spectral_fx_module.h"
+
+using namespace bkshepherd;
+
+static const char *s_carrierNames[2] = {"Saw", "Right In"};
+
+static const int s_paramCount = 6;
+static const ParameterMetaData s_metaData[s_paramCount] = {
+    {name : "Mix", valueType : ParameterValueType::Float, defaultValue : {.float_value = 1.0f}, knobMapping : 0, midiCCMapping : 14},
+    {name : "Gate", valueType : ParameterValueType::Float, defaultValue : {.float_value = 0.0f}, knobMapping : 1, midiCCMapping : 15},
+    {
+        name : "Vocoder",
+        valueType : ParameterValueType::Float,
+        defaultValue : {.float_value = 0.0f},
+        knobMapping : 2,
+        midiCCMapping : 16
+    },
+    {
+        name : "Pitch",
+        valueType : ParameterValueType::Float,
+        valueBinCount : 0,
+        defaultValue : {.float_value = 48.0f},
+        knobMapping : 3,
+        midiCCMapping : 17,
+        minValue : 36,
+        maxValue : 72
+    },
+    {
+        name : "Carrier",
+        valueType : ParameterValueType::Binned,
+        valueBinCount : 2,
+        valueBinNames : s_carrierNames,
+        defaultValue : {.uint_value = 0},
+        knobMapping : 4,
+        midiCCMapping : 18
+    },
+    {name : "Freeze", valueType : ParameterValueType::Bool, defaultValue : {.uint_value = 0}, knobMapping : -1, midiCCMapping : 19},
+};
+
+// Default Constructor
+SpectralFxModule::SpectralFxModule() : SpectralEffectModule(2) {
+    // Set the name of the effect
+    m_name = "SpctFX";
+
+    // Setup the meta data reference for this Effect
+    m_paramMetaData = s_metaData;
+
+    // Initialize Parameters for this Effect
+    this->InitParams(s_paramCount);
+}
+
+// Destructor
+SpectralFxModule::~SpectralFxModule() {
+    // No Code Needed
+}
+
+void SpectralFxModule::Init(float sample_rate) {
+    SpectralEffectModule::Init(sample_rate);
+
+    m_carrierOsc.Init(sample_rate);
+    m_carrierOsc.SetWaveform(Oscillator::WAVE_POLYBLEP_SAW);
+    m_carrierOsc.SetAmp(0.5f);
+
+    // Gate, freeze and vocoder all work on the frames of the input, one analysis and one synthesis for the three of them
+    m_chain.clear();
+    m_chain.add(&m_gate);
+    m_chain.add(&m_freeze);
+    m_chain.add(&m_vocoder);
+
+    for (int i = 0; i < s_paramCount; i++) {
+        ParameterChanged(i);
+    }
+}
+
+bool SpectralFxModule::OnAcquireSharedMemory(MemoryArena &arena) {
+    if (!SpectralEffectModule::OnAcquireSharedMemory(arena)) {
+        return false;
+    }
+
+    float *dry = arena.NewArray<float>(s_dryDelaySize);
+    if (dry == nullptr) {
+        return false;
+    }
+    m_dry.Init(dry, s_dryDelaySize);
+
+    // The carrier channel runs in step with the input, its latest frame is the one of the same hop
+    m_vocoder.SetCarrier(GetSpectrum(1));
+    return true;
+}
+
+void SpectralFxModule::OnReleaseSharedMemory() {
+    m_vocoder.SetCarrier(nullptr);
+    SpectralEffectModule::OnReleaseSharedMemory();
+}
+
+void SpectralFxModule::ParameterChanged(int parameter_id) {
+    if (parameter_id == 1) { // Gate
+        // Up to a magnitude of 4, about -36dB for a sine (256 at full scale)
+        const float gate = GetParameterAsFloat(1);
+        m_gate.SetThreshold(gate * gate * 4.0f);
+    } else if (parameter_id == 2) { // Vocoder
+        m_vocoder.SetAmount(GetParameterAsFloat(2));
+    } else if (parameter_id == 3) { // Pitch
+        m_carrierOsc.SetFreq(mtof(GetParameterAsFloat(3)));
+    } else if (parameter_id == 5) { // Freeze
+        m_freeze.SetFrozen(GetParameterAsBool(5));
+    }
+}
+
+void SpectralFxModule::AlternateFootswitchPressed() { SetParameterAsBool(5, !GetParameterAsBool(5)); }
+
+void SpectralFxModule::ProcessSpectrum(size_t channel, const float *in, float *out) {
+    // Only the input is resynthesized, the carrier channel is analysis only (see ProcessChannels)
+    m_chain.process(in, out);
+}
+
+void SpectralFxModule::ProcessChannels(float in, float carrier) {
+    const float mix = GetParameterAsFloat(0);
+
+    const float wet = ProcessStft(0, in);
+    AnalyzeStft(1, carrier);
+
+    // The resynthesis is s_latency samples late, the dry signal is delayed to match so the mix doesn't comb filter
+    const float dry = m_dry.Read(s_latency);
+    m_dry.Write(in);
+
+    m_audioLeft = wet * mix + dry * (1.0f - mix);
+    m_audioRight = m_audioLeft;
+}
+
+void SpectralFxModule::ProcessMono(float in) {
+    BaseEffectModule::ProcessMono(in);
+
+    // Without a right input the saw is the only carrier
+    ProcessChannels(m_audioLeft, m_carrierOsc.Process());
+}
+
+void SpectralFxModule::ProcessStereo(float inL, float inR) {
+    BaseEffectModule::ProcessStereo(inL, inR);
+
+    const float saw = m_carrierOsc.Process();
+    ProcessChannels(m_audioLeft, GetParameterAsBinnedValue(4) == 2 ? m_audioRight : saw);
+}
+
+float SpectralFxModule::GetBrightnessForLED(int led_id) const {
+    float value = BaseEffectModule::GetBrightnessForLED(led_id);
+
+    if (led_id == 1) {
+        // Enable the LED while frozen
+        return value * m_freeze.IsFrozen();
+    }
+
+    return value;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#ifndef SPECTRAL_FX_MODULE_H
+#define SPECTRAL_FX_MODULE_H
+
+#include "../Util/masked_delay_line.h"
+#include "../Util/spectral_processors.h"
+#include "daisysp.h"
+#include "spectral_effect_module.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+
+/** @file spectral_fx_module.h */
+
+using namespace daisysp;
+
+namespace bkshepherd {
+
+/** Spectral gate, freeze and vocoder on one analysis.
+
+    The input runs through a chain of a spectral gate, a freeze and a cross-synthesis vocoder, all on the frames of one STFT.
+    The vocoder's carrier is a second channel in step with the first: the right input when it is used, or an internal saw
+    otherwise. The alternate footswitch toggles the freeze.
+*/
+class SpectralFxModule : public SpectralEffectModule {
+  public:
+    SpectralFxModule();
+    ~SpectralFxModule();
+
+    // Dry signal delay, long enough to line the dry signal up with the resynthesis
+    static constexpr size_t s_dryDelaySize = NextPowerOfTwo(s_latency + 1);
+
+    // Shared SDRAM taken while the effect is active (the STFT buffers of the input and the carrier, and the dry delay)
+    static constexpr size_t s_sharedMemorySize = StftMemorySize(2) + MemoryArena::AlignedSize(sizeof(float) * s_dryDelaySize);
+
+    void Init(float sample_rate) override;
+    void ParameterChanged(int parameter_id) override;
+    bool OnAcquireSharedMemory(MemoryArena &arena) override;
+    void OnReleaseSharedMemory() override;
+    void ProcessMono(float in) override;
+    void ProcessStereo(float inL, float inR) override;
+    float GetBrightnessForLED(int led_id) const override;
+    bool AlternateFootswitchForTempo() const override { return false; }
+    void AlternateFootswitchPressed() override;
+
+  protected:
+    void ProcessSpectrum(size_t channel, const float *in, float *out) override;
+
+  private:
+    // Runs both channels for one sample, carrier is the input of the carrier channel
+    void ProcessChannels(float in, float carrier);
+
+    SpectralGate<s_binCount> m_gate;
+    SpectralFreeze<s_binCount> m_freeze;
+    SpectralVocoder<s_binCount> m_vocoder;
+    soundmath::SpectralChain<float, s_frameSize, 3> m_chain;
+
+    Oscillator m_carrierOsc;
+    MaskedDelayLine<float> m_dry;
+};
+} // namespace bkshepherd
+#endif
+#endif
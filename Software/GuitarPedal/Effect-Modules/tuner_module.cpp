@@ -1,6 +1,5 @@
 #include "tuner_module.h"
-
-#include "../Util/frequency_detector_q.h"
+#include "../Util/memory_placement.h"
 
 using namespace bkshepherd;
 
@@ -9,9 +8,25 @@ using namespace daisysp;
 
 const char k_notes[12][3] = {"C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"};
 
-static const int s_paramCount = 1;
+static const char *s_modeNames[2] = {"Mono", "Poly"};
+
+// History and FFT workspace of the poly mode. They stay out of the shared SDRAM arena, so switching to the tuner doesn't take
+// the arena from the looper or a delay and the tuner runs as soon as it is selected
+static WARM_SRAM float s_polyHistory[PolyphonicTuner::k_historySize];
+static WARM_SRAM float s_polyWorkspace[PolyphonicTuner::k_workspaceSize];
+
+static const int s_paramCount = 2;
 static const ParameterMetaData s_metaData[s_paramCount] = {
     {name : "Mute", valueType : ParameterValueType::Bool, defaultValue : {.uint_value = 1}, knobMapping : 0, midiCCMapping : -1},
+    {
+        name : "Mode",
+        valueType : ParameterValueType::Binned,
+        valueBinCount : 2,
+        valueBinNames : s_modeNames,
+        defaultValue : {.uint_value = 0},
+        knobMapping : 1,
+        midiCCMapping : -1
+    },
 };
 
 // Default Constructor
@@ -23,22 +38,21 @@ TunerModule::TunerModule() : BaseEffectModule() {
     this->InitParams(s_paramCount);
 
     m_name = "Tuner";
-
-    m_frequencyDetector = new FrequencyDetectorQ();
 }
 
 // Destructor
 TunerModule::~TunerModule() {
-    delete m_frequencyDetector;
-    m_frequencyDetector = nullptr;
+    // No Code Needed
 }
 
 void TunerModule::Init(float sample_rate) {
     BaseEffectModule::Init(sample_rate);
 
     m_muteOutput = GetParameterAsBool(0);
+    m_polyMode = GetParameterAsBinnedValue(1) == 2;
 
-    m_frequencyDetector->Init(sample_rate);
+    m_polyTuner.Init(sample_rate);
+    m_polyTuner.SetBuffers(s_polyHistory, s_polyWorkspace);
 }
 
 float Pitch(uint8_t note) { return 440.0f * pow(2.0f, (note - 'E') / 12.0f); }
@@ -52,25 +66,75 @@ uint8_t Octave(float frequency) { return Note(frequency) / 12.0f - 1.0f; }
 void TunerModule::ParameterChanged(int parameter_id) {
     if (parameter_id == 0) {
         m_muteOutput = GetParameterAsBool(0);
+    } else if (parameter_id == 1) {
+        m_polyMode = GetParameterAsBinnedValue(1) == 2;
     }
 }
 
-void TunerModule::ProcessMono(float in) {
-    m_currentFrequency = m_frequencyDetector->Process(in);
+void TunerModule::UpdateUI(float elapsedTime) {
+    // The poly mode analysis is too long for the audio callback, it runs here a few times per second
+    if (m_polyMode) {
+        m_polyTuner.Update();
+    }
+}
 
-    m_note = Note(m_currentFrequency);
-    m_octave = Octave(m_currentFrequency);
-    m_cents = Cents(m_currentFrequency, m_note);
+void TunerModule::UpdateFrequency(float frequency) {
+    // The detector holds its last detection between updates, nothing to recompute until it changes (and no log of 0)
+    if (frequency == m_currentFrequency) {
+        return;
+    }
+    m_currentFrequency = frequency;
 
-    if (!m_muteOutput) {
-        m_audioLeft = m_audioRight = in;
+    if (frequency > 0) {
+        m_note = Note(frequency);
+        m_octave = Octave(frequency);
+        m_cents = Cents(frequency, m_note);
     }
 }
 
+void TunerModule::ProcessMono(float in) {
+    // The single note pitch comes from the shared analysis
+    if (m_polyMode) {
+        m_polyTuner.Process(in);
+    } else {
+        UpdateFrequency(GetSignalAnalysis().frequency);
+    }
+
+    m_audioLeft = m_audioRight = m_muteOutput ? 0.0f : in;
+}
+
 void TunerModule::ProcessStereo(float inL, float inR) { ProcessMono(inL); }
 
+void TunerModule::ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) {
+    if (m_polyMode) {
+        for (size_t i = 0; i < size; i++) {
+            m_polyTuner.Process(in[i]);
+        }
+    } else {
+        // The display only needs the latest detection, so the note is worked out once per block
+        UpdateFrequency(GetSignalAnalysis().frequency);
+    }
+
+    for (size_t i = 0; i < size; i++) {
+        const float out = m_muteOutput ? 0.0f : in[i];
+        outL[i] = out;
+        outR[i] = out;
+    }
+
+    m_audioLeft = m_audioRight = size > 0 ? outL[size - 1] : 0.0f;
+}
+
+void TunerModule::ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) {
+    ProcessMonoBlock(inL, outL, outR, size);
+}
+
 void TunerModule::DrawUI(OneBitGraphicsDisplay &display, int currentIndex, int numItemsTotal, Rectangle boundsToDrawIn,
                          bool isEditing) {
+    if (m_polyMode) {
+        DrawPolyUI(display, boundsToDrawIn);
+        return;
+    }
+
     const bool displayTuning = m_currentFrequency > 0;
 
     if (displayTuning) {
@@ -167,4 +231,50 @@ void TunerModule::DrawUI(OneBitGraphicsDisplay &display, int currentIndex, int n
         sprintf(strbuffFreq, FLT_FMT(2), FLT_VAR(2, m_currentFrequency));
         display.WriteStringAligned(strbuffFreq, Font_7x10, boundsToDrawIn, Alignment::bottomCentered, true);
     }
-}
\ No newline at end of file
+}
+void TunerModule::DrawPolyUI(OneBitGraphicsDisplay &display, Rectangle boundsToDrawIn) {
+    // A column per string, low E on the left: the note name and a vertical meter below it, sharp up and flat down
+    const uint8_t blockCount = 7;
+    const uint8_t inTuneBlockIndex = (blockCount - 1) / 2;
+    const uint8_t numBlocksOutOfTune = (blockCount - 1) / 2;
+
+    // The analysis is good to a few cents, in tune is a little wider than for single notes
+    const float closeThreshold = 2.0f;
+    const float farLimit = 45.0f;
+
+    const int columnWidth = boundsToDrawIn.GetWidth() / PolyphonicTuner::k_stringCount;
+    const int blockSize = 5;
+    const int top = boundsToDrawIn.GetY() + 14;
+
+    for (size_t string = 0; string < PolyphonicTuner::k_stringCount; string++) {
+        const int x = boundsToDrawIn.GetX() + string * columnWidth;
+
+        Rectangle nameBounds(x, boundsToDrawIn.GetY(), columnWidth, 10);
+        display.WriteStringAligned(k_notes[m_polyTuner.GetStringNote(string) % 12], Font_7x10, nameBounds, Alignment::centered,
+                                   true);
+
+        const bool detected = m_polyTuner.IsStringDetected(string);
+        const float cents = m_polyTuner.GetStringCents(string);
+
+        // Same mapping as the single note meter, at least one block out of tune unless within the close threshold
+        float percentage = std::clamp(std::abs(cents) / farLimit, 0.0f, 1.0f);
+        uint8_t blocksOutOfTune = std::max(static_cast<uint8_t>(numBlocksOutOfTune * percentage), static_cast<uint8_t>(1));
+        if (std::abs(cents) < closeThreshold) {
+            blocksOutOfTune = 0;
+        }
+
+        for (int block = 0; block < blockCount; block++) {
+            // Block 0 is the top (sharpest) one
+            const int offset = inTuneBlockIndex - block;
+            bool active = false;
+            if (detected) {
+                active = offset == 0 || (cents > 0 && offset > 0 && offset <= blocksOutOfTune) ||
+                         (cents < 0 && offset < 0 && -offset <= blocksOutOfTune);
+            }
+
+            const int width = block == inTuneBlockIndex ? columnWidth - 4 : blockSize;
+            Rectangle r(x + (columnWidth - width) / 2, top + block * (blockSize + 1), width, blockSize);
+            display.DrawRect(r, true, active);
+        }
+    }
+}
@@ -4,7 +4,7 @@
 
 #include <stdint.h>
 
-#include "../Util/frequency_detector_interface.h"
+#include "../Util/polyphonic_tuner.h"
 #include "base_effect_module.h"
 #include "daisysp.h"
 #ifdef __cplusplus
@@ -15,6 +15,11 @@ using namespace daisysp;
 
 namespace bkshepherd {
 
+/** Tuner for single notes, or for all six strings at once from a strum in the poly mode.
+
+    Single notes use the pitch of the shared signal analysis. The poly mode only decimates the input in the audio callback, its
+    analysis runs from UpdateUI() in the main loop.
+*/
 class TunerModule : public BaseEffectModule {
   public:
     TunerModule();
@@ -23,11 +28,21 @@ class TunerModule : public BaseEffectModule {
     void Init(float sample_rate) override;
     void ProcessMono(float in) override;
     void ProcessStereo(float inL, float inR) override;
+    void ProcessMonoBlock(const float *in, float *outL, float *outR, size_t size) override;
+    void ProcessStereoBlock(const float *inL, const float *inR, float *outL, float *outR, size_t size) override;
     void ParameterChanged(int parameter_id) override;
+    bool NeedsPitchAnalysis() const override { return !m_polyMode; }
+    void UpdateUI(float elapsedTime) override;
     void DrawUI(OneBitGraphicsDisplay &display, int currentIndex, int numItemsTotal, Rectangle boundsToDrawIn,
                 bool isEditing) override;
 
   private:
+    /** Updates the note, octave and cents for a new detected frequency, they only change when the detector does */
+    void UpdateFrequency(float frequency);
+
+    /** Draws the deviation of every string in the poly mode */
+    void DrawPolyUI(OneBitGraphicsDisplay &display, Rectangle boundsToDrawIn);
+
     float m_currentFrequency = 0;
 
     uint8_t m_note = 0;
@@ -35,8 +50,9 @@ class TunerModule : public BaseEffectModule {
     float m_cents = 0;
 
     bool m_muteOutput;
+    bool m_polyMode = false;
 
-    FrequencyDetectorInterface *m_frequencyDetector = nullptr;
+    PolyphonicTuner m_polyTuner;
 };
 } // namespace bkshepherd
 #endif
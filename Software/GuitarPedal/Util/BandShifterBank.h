@@ -0,0 +1,257 @@
+/*
+https://github.com/schult/terrarium-poly-octave
+
+MIT License
+
+Copyright (c) 2024 Steven Schulteis
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numbers>
+
+#include "FastSqrt.h"
+
+//=============================================================================
+// A bank of BandShifters (see BandShifter.h for the filter and the octave
+// phase scaling) stored as struct of arrays: every coefficient and state
+// variable is an array indexed by band, complex values are split into real
+// and imaginary arrays.
+//
+// update() runs the bank in three loops over the bands (filters, up1 and
+// down1, down2) without branches. The phase transitions that flip the signs
+// of the octaves down are detected from sign bits and kept as sign masks,
+// which are xor'ed into the results.
+//
+// Bands is the capacity, set_band_count() sets how many of them run (the
+// first ones), so the CPU cost follows the bands in use.
+template <std::size_t Bands> class BandShifterBank {
+  public:
+    // Coefficients of the bands and how many of them run. Designing them takes
+    // double precision cos / sin / exp per band, so a design can be made on
+    // its own (away from the audio callback) and handed to load() later.
+    struct Design {
+        float d0[Bands];
+        float d1_re[Bands], d1_im[Bands];
+        float d2_re[Bands], d2_im[Bands];
+        float c1_re[Bands], c1_im[Bands];
+        float c2_re[Bands], c2_im[Bands];
+        std::size_t count;
+
+        // Same design as the BandShifter constructor
+        void set_band(std::size_t band, float center, float sample_rate, float bw) {
+            constexpr auto pi = std::numbers::pi_v<double>;
+            constexpr auto j = std::complex<double>(0, 1);
+
+            const auto w0 = pi * bw / sample_rate;
+            const auto cos_w0 = std::cos(w0);
+            const auto sin_w0 = std::sin(w0);
+            const auto sqrt_2 = std::sqrt(2.0);
+            const auto a0 = (1 + sqrt_2 * sin_w0 / 2);
+            const auto g = (1 - cos_w0) / (2 * a0);
+
+            const auto w1 = 2 * pi * center / sample_rate;
+            const auto e1 = std::exp(j * w1);
+            const auto e2 = std::exp(j * w1 * 2.0);
+
+            const auto d1 = e1 * 2.0 * g;
+            const auto d2 = e2 * g;
+            const auto c1 = e1 * (-2 * cos_w0) / a0;
+            const auto c2 = e2 * (1 - sqrt_2 * sin_w0 / 2) / a0;
+
+            d0[band] = g;
+            d1_re[band] = d1.real();
+            d1_im[band] = d1.imag();
+            d2_re[band] = d2.real();
+            d2_im[band] = d2.imag();
+            c1_re[band] = c1.real();
+            c1_im[band] = c1.imag();
+            c2_re[band] = c2.real();
+            c2_im[band] = c2.imag();
+        }
+
+        // Runs the first count bands, up to Bands
+        void set_band_count(std::size_t bands) { count = bands < Bands ? bands : Bands; }
+    };
+
+    BandShifterBank() {
+        for (std::size_t i = 0; i < Bands; ++i) {
+            _d.d0[i] = 0;
+            _d.d1_re[i] = _d.d1_im[i] = 0;
+            _d.d2_re[i] = _d.d2_im[i] = 0;
+            _d.c1_re[i] = _d.c1_im[i] = 0;
+            _d.c2_re[i] = _d.c2_im[i] = 0;
+        }
+        _d.count = Bands;
+        reset();
+    }
+
+    void set_band_count(std::size_t count) { _d.set_band_count(count); }
+
+    std::size_t band_count() const { return _d.count; }
+
+    void set_band(std::size_t band, float center, float sample_rate, float bw) { _d.set_band(band, center, sample_rate, bw); }
+
+    // Switches to a design made elsewhere and clears the states, a copy of the
+    // coefficients rather than a redesign
+    void load(const Design &design) {
+        _d = design;
+        reset();
+    }
+
+    // Clears the filter states and the octave signs
+    void reset() {
+        for (std::size_t i = 0; i < Bands; ++i) {
+            _s1_re[i] = _s1_im[i] = 0;
+            _s2_re[i] = _s2_im[i] = 0;
+            _y_re[i] = _y_im[i] = 0;
+            _down1_re[i] = _down1_im[i] = 0;
+            _down1_sign[i] = 0;
+            _down2_sign[i] = 0;
+        }
+        _up1 = _down1 = _down2 = 0;
+    }
+
+    void update(float sample) {
+        update_filters(sample);
+        update_up1_down1();
+        update_down2();
+    }
+
+    // Sums over all bands
+    float up1() const { return _up1; }
+
+    float down1() const { return _down1; }
+
+    float down2() const { return _down2; }
+
+  private:
+    static constexpr uint32_t sign_mask = 0x80000000u;
+
+    static uint32_t bits(float value) {
+        uint32_t result;
+        std::memcpy(&result, &value, sizeof(result));
+        return result;
+    }
+
+    static float from_bits(uint32_t value) {
+        float result;
+        std::memcpy(&result, &value, sizeof(result));
+        return result;
+    }
+
+    void update_filters(float sample) {
+        const std::size_t count = _d.count;
+        for (std::size_t i = 0; i < count; ++i) {
+            const float prev_y_im = _y_im[i];
+
+            const float y_re = _s2_re[i] + _d.d0[i] * sample;
+            const float y_im = _s2_im[i];
+            const float s2_re = _s1_re[i] + _d.d1_re[i] * sample - (_d.c1_re[i] * y_re - _d.c1_im[i] * y_im);
+            const float s2_im = _s1_im[i] + _d.d1_im[i] * sample - (_d.c1_re[i] * y_im + _d.c1_im[i] * y_re);
+            const float s1_re = _d.d2_re[i] * sample - (_d.c2_re[i] * y_re - _d.c2_im[i] * y_im);
+            const float s1_im = _d.d2_im[i] * sample - (_d.c2_re[i] * y_im + _d.c2_im[i] * y_re);
+
+            // Flip down1 when y crosses the negative real axis: real part negative and the imaginary sign changed
+            _down1_sign[i] ^= bits(y_re) & (bits(y_im) ^ bits(prev_y_im)) & sign_mask;
+
+            _y_re[i] = y_re;
+            _y_im[i] = y_im;
+            _s1_re[i] = s1_re;
+            _s1_im[i] = s1_im;
+            _s2_re[i] = s2_re;
+            _s2_im[i] = s2_im;
+        }
+    }
+
+    void update_up1_down1() {
+        float up1 = 0;
+        float down1 = 0;
+
+        const std::size_t count = _d.count;
+        for (std::size_t i = 0; i < count; ++i) {
+            const float a = _y_re[i];
+            const float b = _y_im[i];
+            const float inv_mag = fastInvSqrt(a * a + b * b);
+
+            // out = in * (in / |in|)
+            up1 += (a * a - b * b) * inv_mag;
+
+            // out = in * (in / |in|)^(-1/2), the square root of the phase taken on the side of b
+            const float x = 0.5f * a * inv_mag;
+            const float c = fastSqrt(0.5f + x);
+            const float d = from_bits(bits(fastSqrt(0.5f - x)) ^ (bits(b) & sign_mask));
+
+            const uint32_t sign = _down1_sign[i];
+            const float down1_re = from_bits(bits(a * c + b * d) ^ sign);
+            const float down1_im = from_bits(bits(b * c - a * d) ^ sign);
+
+            // Flip down2 when down1 crosses the negative real axis
+            _down2_sign[i] ^= bits(down1_re) & (bits(down1_im) ^ bits(_down1_im[i])) & sign_mask;
+
+            _down1_re[i] = down1_re;
+            _down1_im[i] = down1_im;
+            down1 += down1_re;
+        }
+
+        _up1 = up1;
+        _down1 = down1;
+    }
+
+    void update_down2() {
+        float down2 = 0;
+
+        const std::size_t count = _d.count;
+        for (std::size_t i = 0; i < count; ++i) {
+            const float a = _down1_re[i];
+            const float b = _down1_im[i];
+
+            const float x = 0.5f * a * fastInvSqrt(a * a + b * b);
+            const float c = fastSqrt(0.5f + x);
+            const float d = from_bits(bits(fastSqrt(0.5f - x)) ^ (bits(b) & sign_mask));
+
+            down2 += from_bits(bits(a * c + b * d) ^ _down2_sign[i]);
+        }
+
+        _down2 = down2;
+    }
+
+    // Coefficients
+    Design _d;
+
+    // Filter states and outputs
+    float _s1_re[Bands], _s1_im[Bands];
+    float _s2_re[Bands], _s2_im[Bands];
+    float _y_re[Bands], _y_im[Bands];
+    float _down1_re[Bands], _down1_im[Bands];
+
+    // Signs of the octaves down, 0 or the sign bit
+    uint32_t _down1_sign[Bands];
+    uint32_t _down2_sign[Bands];
+
+    float _up1 = 0;
+    float _down1 = 0;
+    float _down2 = 0;
+};
@@ -26,6 +26,8 @@ SOFTWARE.
 #pragma once
 
 #include <array>
+#include <cmath>
+#include <cstddef>
 #include <span>
 
 #include <q/utility/ring_buffer.hpp>
@@ -191,3 +193,182 @@ class Interpolator {
     cycfi::q::ring_buffer<float> buffer1{bsize1};
     cycfi::q::ring_buffer<float> buffer2{bsize2};
 };
+
+//=============================================================================
+// Decimation and interpolation for any factor up to max_resample_factor,
+// with the lowpass designed at run time for the engine's sample rate
+// instead of the fixed 48kHz designs above.
+//
+// Both use one Kaiser windowed sinc of factor * taps_per_phase taps, cut off
+// at half the low rate. Only the band up to passband matters (the octave
+// generator covers 60Hz to 1.7kHz), so the transition runs up to the low
+// rate minus passband, where the first alias folds back onto the passband,
+// and the Kaiser window is chosen for the most stopband attenuation that
+// transition allows with the taps. With taps_per_phase = 10 that is about
+// 85dB at every rate, for 32kHz (factor 4), 48kHz (6) and 96kHz (12) alike.
+//
+// Cost: taps_per_phase multiply-adds per input sample for the decimator and
+// per output sample for the interpolator, about what the fixed designs take.
+
+constexpr std::size_t max_resample_factor = 12;
+
+// Rate the octave generator runs at, the low rate of the resamplers
+constexpr float octave_sample_rate = 8000;
+
+// Factor that brings sample_rate down to about octave_sample_rate: 4 at
+// 32kHz, 6 at 48kHz, 12 at 96kHz
+inline std::size_t resample_factor_for(float sample_rate) {
+    const auto factor = static_cast<std::size_t>(std::lround(sample_rate / octave_sample_rate));
+    return factor < 1 ? 1 : (factor > max_resample_factor ? max_resample_factor : factor);
+}
+
+//=============================================================================
+struct MultirateDesign {
+    static constexpr std::size_t taps_per_phase = 10;
+    static constexpr std::size_t max_taps = max_resample_factor * taps_per_phase;
+
+    // Fills taps with factor * taps_per_phase coefficients of the lowpass,
+    // unity gain at DC
+    static void lowpass(float *taps, std::size_t factor, float sample_rate, float passband) {
+        constexpr double pi = 3.14159265358979323846;
+        const std::size_t size = factor * taps_per_phase;
+
+        // Cutoff at half the low rate, transition from passband up to the
+        // first alias of it
+        const double low_rate = sample_rate / factor;
+        const double cutoff = 0.5 / factor;
+        const double transition = 2 * pi * (low_rate - 2 * passband) / sample_rate;
+
+        // Kaiser's estimates: attenuation for the length, window for the attenuation
+        double attenuation = 8 + 2.285 * (size - 1) * (transition > 0 ? transition : 0);
+        attenuation = attenuation < 21 ? 21 : attenuation;
+        const double beta = attenuation > 50 ? 0.1102 * (attenuation - 8.7)
+                                             : 0.5842 * std::pow(attenuation - 21, 0.4) + 0.07886 * (attenuation - 21);
+
+        const double center = (size - 1) / 2.0;
+        double sum = 0;
+        for (std::size_t k = 0; k < size; ++k) {
+            const double t = k - center;
+            const double sinc = t == 0 ? 1.0 : std::sin(2 * pi * cutoff * t) / (2 * pi * cutoff * t);
+            const double r = t / center;
+            const double window = bessel_i0(beta * std::sqrt(1 - r * r)) / bessel_i0(beta);
+            const double tap = sinc * window;
+            taps[k] = static_cast<float>(tap);
+            sum += tap;
+        }
+        for (std::size_t k = 0; k < size; ++k) {
+            taps[k] = static_cast<float>(taps[k] / sum);
+        }
+    }
+
+  private:
+    // Modified Bessel function of the first kind, order 0
+    static double bessel_i0(double x) {
+        double sum = 1;
+        double term = 1;
+        for (int k = 1; k < 50; ++k) {
+            term *= (x / (2 * k)) * (x / (2 * k));
+            sum += term;
+            if (term < sum * 1e-12) {
+                break;
+            }
+        }
+        return sum;
+    }
+};
+
+//=============================================================================
+class PolyphaseDecimator {
+  public:
+    // passband = highest frequency that has to come through clean
+    void init(std::size_t factor, float sample_rate, float passband = 1800) {
+        _factor = factor < 1 ? 1 : (factor > max_resample_factor ? max_resample_factor : factor);
+        _size = _factor * MultirateDesign::taps_per_phase;
+        MultirateDesign::lowpass(_taps, _factor, sample_rate, passband);
+
+        for (auto &h : _history) {
+            h = 0;
+        }
+        _pos = 0;
+    }
+
+    std::size_t factor() const { return _factor; }
+
+    // Takes factor() samples and returns one at the low rate
+    float operator()(const float *s) {
+        // The history is kept twice in a row, newest first, so the taps
+        // always read one contiguous run
+        for (std::size_t i = 0; i < _factor; ++i) {
+            _pos = _pos == 0 ? _size - 1 : _pos - 1;
+            _history[_pos] = s[i];
+            _history[_pos + _size] = s[i];
+        }
+
+        const float *history = _history + _pos;
+        float out = 0;
+        for (std::size_t k = 0; k < _size; ++k) {
+            out += _taps[k] * history[k];
+        }
+        return out;
+    }
+
+  private:
+    std::size_t _factor = 1;
+    std::size_t _size = MultirateDesign::taps_per_phase;
+    std::size_t _pos = 0;
+    float _taps[MultirateDesign::max_taps] = {};
+    float _history[2 * MultirateDesign::max_taps] = {};
+};
+
+//=============================================================================
+class PolyphaseInterpolator {
+  public:
+    // passband = highest frequency that has to come through clean
+    void init(std::size_t factor, float sample_rate, float passband = 1800) {
+        constexpr auto taps_per_phase = MultirateDesign::taps_per_phase;
+
+        _factor = factor < 1 ? 1 : (factor > max_resample_factor ? max_resample_factor : factor);
+
+        // Output p of every low rate sample uses taps p, p + factor, ...,
+        // stored per phase and scaled by the factor for unity gain
+        float taps[MultirateDesign::max_taps];
+        MultirateDesign::lowpass(taps, _factor, sample_rate, passband);
+        for (std::size_t p = 0; p < _factor; ++p) {
+            for (std::size_t j = 0; j < taps_per_phase; ++j) {
+                _phases[p * taps_per_phase + j] = taps[j * _factor + p] * _factor;
+            }
+        }
+
+        for (auto &h : _history) {
+            h = 0;
+        }
+        _pos = 0;
+    }
+
+    std::size_t factor() const { return _factor; }
+
+    // Takes one low rate sample and writes factor() samples to out
+    void operator()(float s, float *out) {
+        constexpr auto taps_per_phase = MultirateDesign::taps_per_phase;
+
+        _pos = _pos == 0 ? taps_per_phase - 1 : _pos - 1;
+        _history[_pos] = s;
+        _history[_pos + taps_per_phase] = s;
+
+        const float *history = _history + _pos;
+        for (std::size_t p = 0; p < _factor; ++p) {
+            const float *phase = _phases + p * taps_per_phase;
+            float sum = 0;
+            for (std::size_t j = 0; j < taps_per_phase; ++j) {
+                sum += phase[j] * history[j];
+            }
+            out[p] = sum;
+        }
+    }
+
+  private:
+    std::size_t _factor = 1;
+    std::size_t _pos = 0;
+    float _phases[MultirateDesign::max_taps] = {};
+    float _history[2 * MultirateDesign::taps_per_phase] = {};
+};
@@ -25,55 +25,93 @@ SOFTWARE.
 */
 #pragma once
 
-#include "BandShifter.h"
+#include "BandShifterBank.h"
 
-#include <gcem.hpp>
+#include <cmath>
+#include <cstddef>
 
 //=============================================================================
-class OctaveGenerator {
+// Bank of band shifters covering the guitar range, with the octaves summed
+// over all bands.
+//
+// MaxBands is the capacity (and the DTCM / RAM the bank takes), init() sets
+// how many bands run and how they are spaced: band n is centered at
+// 480 * 2^(spacing * n) - 420 Hz, from 60Hz up. The default spacing spreads
+// any band count over the range of the original 80 bands (60Hz to about
+// 1.7kHz), fewer bands track less cleanly but cost proportionally less CPU
+// (see ci/octave_benchmark.cpp).
+template <std::size_t MaxBands> class BasicOctaveGenerator {
   public:
-    OctaveGenerator(float sample_rate) {
-        for (int i = 0; i < 80; ++i) {
-            const auto center = centerFreq(i);
-            const auto bw = bandwidth(i);
-            _shifters.emplace_back(center, sample_rate, bw);
-        }
-    }
+    static constexpr int max_band_count = MaxBands;
 
-    void update(float sample) {
-        _up1 = 0;
-        _down1 = 0;
-        _down2 = 0;
+    // Spacing of the original design, 80 bands
+    static constexpr float reference_spacing = 0.027f;
+    static constexpr int reference_band_count = 80;
 
-        for (auto &shifter : _shifters) {
-            shifter.update(sample);
-            _up1 += shifter.up1();
-            _down1 += shifter.down1();
-            _down2 += shifter.down2();
-        }
+    static constexpr float default_spacing(int bands) { return reference_spacing * reference_band_count / bands; }
+
+    using Design = typename BandShifterBank<MaxBands>::Design;
+
+    // Silent until init() is called
+    BasicOctaveGenerator() = default;
+
+    BasicOctaveGenerator(float sample_rate) { init(sample_rate); }
+
+    // Designs the bands for sample_rate (the rate update() is called at) and clears their states
+    // bands = number of bands to run, up to MaxBands
+    // spacing = octaves between neighbouring bands on the 480 * 2^x scale, 0 for default_spacing(bands)
+    void init(float sample_rate, int bands = MaxBands, float spacing = 0) {
+        setBands(_bank, sample_rate, bands, spacing);
+        _bank.reset();
+    }
+
+    // Same design as init() into design, leaving the running bands alone. For
+    // redesigning away from the audio callback, load() then switches to it.
+    static void design(Design &design, float sample_rate, int bands = MaxBands, float spacing = 0) {
+        setBands(design, sample_rate, bands, spacing);
     }
 
-    float up1() const { return _up1; }
+    // Runs with a design made by design() and clears the band states
+    void load(const Design &design) { _bank.load(design); }
 
-    float down1() const { return _down1; }
+    int band_count() const { return static_cast<int>(_bank.band_count()); }
 
-    float down2() const { return _down2; }
+    void update(float sample) { _bank.update(sample); }
+
+    float up1() const { return _bank.up1(); }
+
+    float down1() const { return _bank.down1(); }
+
+    float down2() const { return _bank.down2(); }
 
   private:
-    static constexpr float centerFreq(const int n) { return 480 * gcem::pow(2.0f, (0.027f * n)) - 420; }
+    // Designs the bands into the bank or a Design
+    template <typename Target> static void setBands(Target &target, float sample_rate, int bands, float spacing) {
+        bands = bands < 1 ? 1 : (bands > max_band_count ? max_band_count : bands);
+        spacing = spacing > 0 ? spacing : default_spacing(bands);
+
+        for (int i = 0; i < bands; ++i) {
+            const auto center = centerFreq(i, spacing);
+            const auto bw = bandwidth(i, spacing);
+            target.set_band(i, center, sample_rate, bw);
+        }
+        target.set_band_count(bands);
+    }
+
+    static float centerFreq(const int n, const float spacing) { return 480 * std::pow(2.0f, (spacing * n)) - 420; }
 
-    static constexpr float bandwidth(const int n) {
-        const float f0 = centerFreq(n - 1);
-        const float f1 = centerFreq(n);
-        const float f2 = centerFreq(n + 1);
+    static float bandwidth(const int n, const float spacing) {
+        const float f0 = centerFreq(n - 1, spacing);
+        const float f1 = centerFreq(n, spacing);
+        const float f2 = centerFreq(n + 1, spacing);
         const float a = (f2 - f1);
         const float b = (f1 - f0);
         return 2.0f * (a * b) / (a + b);
     }
 
-    std::vector<BandShifter> _shifters;
-
-    float _up1 = 0;
-    float _down1 = 0;
-    float _down2 = 0;
+    // All bands as one struct of arrays bank, the filters and octave shifts run as loops over the bands
+    BandShifterBank<MaxBands> _bank;
 };
+
+// The original 80 band generator
+using OctaveGenerator = BasicOctaveGenerator<80>;
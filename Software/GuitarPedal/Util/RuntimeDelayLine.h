@@ -12,25 +12,29 @@ https://opensource.org/licenses/MIT.
 #pragma once
 #ifndef DSY_RUNTIME_DELAY_H
 #define DSY_RUNTIME_DELAY_H
+#include "masked_delay_line.h"
 #include <algorithm>
 #include <cstdint>
 
 namespace daisysp_modified {
 
+/** Delay line with a runtime buffer.
+
+    The buffer is used as a power of two ring (see bkshepherd::MaskedDelayLine) so it has to hold
+    bkshepherd::NextPowerOfTwo(size) samples, delays are still limited to size - 1.
+*/
 template <typename T> class DelayLine {
   public:
-    DelayLine() : buffer_(nullptr), size_(0), write_ptr_(0), delay_(1), frac_(0.f) {}
+    DelayLine() : size_(0), delay_(1), frac_(0.f) {}
 
     void Init(T *buffer, size_t size) {
-        buffer_ = buffer;
+        line_.Init(buffer, bkshepherd::NextPowerOfTwo(size));
         size_ = size;
         Reset();
     }
 
     void Reset() {
-        for (size_t i = 0; i < size_; ++i)
-            buffer_[i] = T(0);
-        write_ptr_ = 0;
+        line_.Reset();
         delay_ = 1;
         frac_ = 0.f;
     }
@@ -47,21 +51,13 @@ template <typename T> class DelayLine {
         delay_ = (safe_delay < size_) ? safe_delay : size_ - 1;
     }
 
-    void Write(const T sample) {
-        buffer_[write_ptr_] = sample;
-        write_ptr_ = (write_ptr_ - 1 + size_) % size_;
-    }
+    void Write(const T sample) { line_.Write(sample); }
 
-    T Read() const {
-        T a = buffer_[(write_ptr_ + delay_) % size_];
-        T b = buffer_[(write_ptr_ + delay_ + 1) % size_];
-        return a + (b - a) * frac_;
-    }
+    T Read() { return line_.ReadPositionInterpolated(line_.GetWritePosition() - delay_, frac_); }
 
   private:
-    T *buffer_;
+    bkshepherd::MaskedDelayLine<T> line_;
     size_t size_;
-    size_t write_ptr_;
     size_t delay_;
     float frac_;
 };
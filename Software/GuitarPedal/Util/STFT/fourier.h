@@ -1,117 +1,185 @@
 // fourier.h
 #ifndef FOURIER
 
+#include <string.h>
+
+#include "real_fft.h"
 #include "wave.h"
 
 namespace soundmath {
-template <typename T, size_t N> class Fourier {
+// Receives the spectrum of every frame, spectral effects derive from it so their state lives with the effect instance
+template <typename T> class SpectralProcessor {
   public:
-    void (*processor)(const T *in, T *out);
+    virtual ~SpectralProcessor() {}
 
-    // in, middle, out need to be arrays of size (N * laps * 2)
-    Fourier(void (*processor)(const T *, T *), ShyFFT<T, N, RotationPhasor> *fft, Wave<T> *window, size_t laps, T *in, T *middle,
-            T *out)
-        : processor(processor), in(in), middle(middle), out(out), fft(fft), window(window), laps(laps), stride(N / laps) {
-        writepoints = new int[laps * 2];
-        readpoints = new int[laps * 2];
+    // in is the spectrum of the frame (layout in real_fft.h), out receives the processed one, they never alias
+    virtual void process(const T *in, T *out) = 0;
+};
 
-        memset(writepoints, 0, sizeof(int) * laps * 2);
-        memset(readpoints, 0, sizeof(int) * laps * 2);
+// Runs several processors on one analysis, each stage works on the output of the one before it
+template <typename T, size_t N, size_t MaxStages> class SpectralChain : public SpectralProcessor<T> {
+  public:
+    // appends a stage, false if the chain is full
+    bool add(SpectralProcessor<T> *stage) {
+        if (count == MaxStages)
+            return false;
+        stages[count++] = stage;
+        return true;
+    }
 
-        for (int i = 0; i < 2 * (int)laps; i++) // initialize half of writepoints
-            writepoints[i] = -i * (int)stride;
+    void clear() { count = 0; }
 
-        reading = new bool[laps * 2];
-        writing = new bool[laps * 2];
+    void process(const T *in, T *out) override {
+        if (count == 0) {
+            memcpy(out, in, sizeof(T) * N);
+            return;
+        }
 
-        memset(reading, false, sizeof(bool) * laps * 2);
-        memset(writing, true, sizeof(bool) * laps * 2);
+        stages[0]->process(in, out);
+        for (size_t i = 1; i < count; i++) {
+            memcpy(scratch, out, sizeof(T) * N);
+            stages[i]->process(scratch, out);
+        }
     }
 
-    ~Fourier() {
-        delete[] writepoints;
-        delete[] readpoints;
-        delete[] reading;
-        delete[] writing;
-    }
+  private:
+    SpectralProcessor<T> *stages[MaxStages];
+    size_t count = 0;
+    T scratch[N];
+};
 
-    // writes a single sample (with windowing) into the in array
-    void write(T x) {
-        for (size_t i = 0; i < laps * 2; i++) {
-            if (writing[i]) {
-                if (writepoints[i] >= 0) {
-                    T amp = (*window)((T)writepoints[i] / N);
-                    in[writepoints[i] + N * i] = amp * x;
-                }
-                writepoints[i]++;
+// Short time Fourier transform with overlap-add resynthesis, with the work of each frame spread over the following hop.
+//
+// write() keeps the last N input samples in a ring. Every stride = N / laps samples a frame is taken from the ring and its
+// work is done in SliceCount steps at fixed points of the next hop:
+//   0: window the frame and forward transform it into middle (runs on the sample that completes the frame)
+//   1: processor, middle to out
+//   2: inverse transform out back into the frame
+//   3: window and overlap-add the frame into the output accumulator
+// so an audio block sees at most one of them as long as the block is shorter than stride / SliceCount samples, rather than all
+// the transforms of a hop landing in the same sample. The price is one hop of extra latency (see latency()).
+template <typename T, size_t N> class Fourier {
+  public:
+    SpectralProcessor<T> *processor;
 
-                if (writepoints[i] == N) {
-                    writing[i] = false;
-                    reading[i] = true;
-                    readpoints[i] = 0;
+    static const size_t SliceCount = 4;
 
-                    forward(i);  // FTs ith in to ith middle buffer
-                    process(i);  // user-defined; ought to move info from ith middle to out buffer
-                    backward(i); // IFTs ith out to ith in buffer
+    // Samples the in array needs for an overlap of laps frames: the input ring, the frame and the output accumulator
+    static constexpr size_t InSize(size_t laps) { return 3 * N + N / laps; }
 
-                    current = i;
-                }
-            }
-        }
+    // in needs InSize(laps) samples, middle and out N samples each. Several instances (the channels of a stereo effect) can
+    // share one fft and window
+    Fourier(SpectralProcessor<T> *processor, RealFFT<T, N> *fft, Wave<T> *window, size_t laps, T *in, T *middle, T *out)
+        : processor(processor), ring(in), frame(in + N), accum(in + 2 * N), middle(middle), out(out), fft(fft), window(window),
+          laps(laps), stride(N / laps), accumSize(N + N / laps), scale((T)(1.0 / (N * laps / 2.0))) {
+        memset(in, 0, sizeof(T) * InSize(laps));
+        memset(middle, 0, sizeof(T) * N);
+        memset(out, 0, sizeof(T) * N);
     }
 
-    inline void forward(const size_t i) {
-        fft->Direct((in + i * N), (middle + i * N)); // analysis
-                                                     // arm_rfft_fast_f32(fft, in + i * N, middle + i * N, 0);
-    }
+    // writes a single sample into the input ring, and runs the frame work due at this point of the hop. Without synthesize
+    // only the forward transform runs, for an instance that is only read through spectrum(); its processor isn't called and
+    // read() stays silent
+    void write(T x, bool synthesize = true) {
+        ring[ringpoint] = x;
+        if (++ringpoint == N)
+            ringpoint = 0;
+
+        if (++hoppoint == stride) {
+            // a frame is complete, the work of the previous one has all run by now
+            hoppoint = 0;
+            slice = 0;
+        }
 
-    inline void backward(const size_t i) {
-        fft->Inverse((out + i * N), (in + i * N)); // synthesis
-                                                   // arm_rfft_fast_f32(fft, out + i * N, in + i * N, 1);
+        while (slice < SliceCount && hoppoint == (slice * stride) / SliceCount) {
+            if (slice == 0 || synthesize)
+                step(slice);
+            slice++;
+        }
     }
 
-    // executes user-defined callback
-    inline void process(const size_t i) { processor((middle + i * N), (out + i * N)); }
-
     // read a single reconstructed sample
     T read() {
-        T accum = 0;
+        T x = accum[readpoint];
+        accum[readpoint] = 0;
+        if (++readpoint == accumSize)
+            readpoint = 0;
+        return x;
+    }
 
-        for (size_t i = 0; i < laps * 2; i++) {
-            if (reading[i]) {
-                T amp = (*window)((T)readpoints[i] / N);
-                accum += amp * in[readpoints[i] + N * i];
+    // samples from writing an input sample until it is read back (with an identity processor)
+    size_t latency() const { return N - 1 + stride; }
 
-                readpoints[i]++;
+    // spectrum of the latest frame, from its forward transform until the next one
+    const T *spectrum() const { return middle; }
 
-                if (readpoints[i] == N) {
-                    writing[i] = true;
-                    reading[i] = false;
-                    writepoints[i] = 0;
-                }
-            }
+  private:
+    void step(const size_t i) {
+        switch (i) {
+        case 0:
+            analyze(); // windows the newest N samples into the frame
+            forward(); // FTs the frame to middle
+            break;
+        case 1:
+            process(); // user-defined; ought to move info from middle to out
+            break;
+        case 2:
+            backward(); // IFTs out to the frame
+            break;
+        default:
+            synthesize(); // overlap-adds the frame, it is read from the start of the next hop on
+            break;
         }
+    }
 
-        accum /= N * laps / 2.0;
-        return accum;
+    inline void analyze() {
+        // ringpoint is the oldest sample
+        for (size_t k = 0; k < N; k++) {
+            size_t j = ringpoint + k;
+            j -= j >= N ? N : 0;
+            frame[k] = (*window)((T)k / N) * ring[j];
+        }
     }
 
-  private:
-    T *in, *middle, *out;
+    inline void forward() {
+        fft->Direct(frame, middle); // analysis
+    }
+
+    // executes user-defined callback
+    inline void process() { processor->process(middle, out); }
+
+    inline void backward() {
+        fft->Inverse(out, frame); // synthesis
+    }
+
+    inline void synthesize() {
+        // the next read is hoppoint samples into this hop, the frame starts with the next hop
+        size_t j = readpoint + stride - hoppoint;
+        j -= j >= accumSize ? accumSize : 0;
+        for (size_t k = 0; k < N; k++) {
+            accum[j] += (*window)((T)k / N) * frame[k] * scale;
+            if (++j == accumSize)
+                j = 0;
+        }
+    }
+
+    T *ring, *frame, *accum, *middle, *out;
 
   public:
-    ShyFFT<T, N, RotationPhasor> *fft;
+    RealFFT<T, N> *fft;
     Wave<T> *window;
 
     size_t laps;
     size_t stride;
 
-    int *writepoints;
-    int *readpoints;
-    bool *reading;
-    bool *writing;
+  private:
+    size_t accumSize;
+    T scale;
 
-    int current = 0;
+    size_t ringpoint = 0; // next write into the ring
+    size_t hoppoint = 0;  // samples written since the last frame
+    size_t readpoint = 0; // next read from the accumulator
+    size_t slice = SliceCount;
 };
 
 template <typename T, size_t N> class Analyzer {
@@ -119,7 +187,7 @@ template <typename T, size_t N> class Analyzer {
     int (*processor)(const T *in);
 
     // in, middle, out need to be arrays of size (N * laps * 2)
-    Analyzer(int (*processor)(const T *), ShyFFT<T, N, RotationPhasor> *fft, size_t laps, T *in, T *middle)
+    Analyzer(int (*processor)(const T *), RealFFT<T, N> *fft, size_t laps, T *in, T *middle)
         : processor(processor), in(in), middle(middle), fft(fft), laps(laps), stride(N / laps) {
         writepoints = new int[laps];
 
@@ -165,7 +233,6 @@ template <typename T, size_t N> class Analyzer {
 
     inline void forward(const size_t i) {
         fft->Direct((in + i * N), (middle + i * N)); // analysis
-                                                     // arm_rfft_fast_f32(fft, in + i * N, middle + i * N, 0);
     }
 
     // executes user-defined callback
@@ -175,7 +242,7 @@ template <typename T, size_t N> class Analyzer {
     T *in, *middle;
 
   public:
-    ShyFFT<T, N, RotationPhasor> *fft;
+    RealFFT<T, N> *fft;
 
     size_t laps;
     size_t stride;
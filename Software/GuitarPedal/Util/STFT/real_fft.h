@@ -0,0 +1,232 @@
+// real_fft.h // real FFT with the implementation chosen at compile time
+#ifndef REAL_FFT
+
+#include <cmath>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "shy_fft.h"
+
+// Backends, select one with -DFFT_BACKEND=... (make FFT_BACKEND=CMSIS)
+#define FFT_BACKEND_SHY 0         // ShyFFT with RotationPhasor, no tables
+#define FFT_BACKEND_CMSIS 1       // arm_rfft_fast_f32 from CMSIS-DSP, float only, target only
+#define FFT_BACKEND_SPLIT_RADIX 2 // portable split radix, runs anywhere (host models)
+
+#ifndef FFT_BACKEND
+#define FFT_BACKEND FFT_BACKEND_SHY
+#endif
+
+#if FFT_BACKEND == FFT_BACKEND_CMSIS
+#include "arm_math.h"
+#endif
+
+// Every backend has the interface, spectrum layout and scaling of ShyFFT, so processors don't depend on the backend:
+//   Init() before use
+//   Direct(input, output): output[k] is the real part of bin k for k = 0..N/2, output[N/2 + k] minus its imaginary part
+//     for k = 1..N/2-1
+//   Inverse(input, output): takes that layout back, the result is N times the signal (not normalized)
+//   both use input as their workspace and leave it undefined
+//
+// Host timings (x86-64 Xeon, g++ -O2, ci/fft_benchmark.cpp), microseconds for one Direct and one Inverse:
+//
+//   |    N | ShyFFT | split radix |
+//   |------|--------|-------------|
+//   |  256 |    2.3 |         3.0 |
+//   |  512 |    5.7 |         6.3 |
+//   | 1024 |   13.9 |        13.0 |
+//   | 2048 |   30.8 |        27.4 |
+//   | 4096 |   71.2 |        61.3 |
+//
+// These don't carry over to the M7, the target column (ShyFFT against CMSIS) still has to be taken on the pedal. ShyFFT stays
+// the default until then. To use different backends for different sizes, specialize RealFFTBackend for the size.
+
+namespace soundmath {
+
+// Split radix FFT of N/2 complex points over the even / odd samples, and the split into the real spectrum
+template <typename T, size_t N> class SplitRadixFFT {
+  public:
+    static_assert(N >= 4 && (N & (N - 1)) == 0, "size has to be a power of two");
+
+    void Init() {
+        // e^(-2 pi i k / N), up to 3/4 turn for the 3k twiddles of the complex transform
+        for (size_t k = 0; k < Twiddles; k++) {
+            const double phase = 2.0 * 3.141592653589793 * k / N;
+            cos_[k] = (T)std::cos(phase);
+            sin_[k] = (T)-std::sin(phase);
+        }
+    }
+
+    void Direct(T *input, T *output) {
+        // the samples as N/2 complex points, even samples real, odd ones imaginary
+        transform(input, 1, output, M, 2);
+
+        // output holds Z, input becomes the spectrum: X[k] = E[k] + W^k O[k] with E, O the transforms of the even / odd samples
+        input[0] = output[0] + output[1];
+        input[M] = output[0] - output[1];
+        for (size_t k = 1; k < M; k++) {
+            const T zr = output[2 * k], zi = output[2 * k + 1];
+            const T cr = output[2 * (M - k)], ci = -output[2 * (M - k) + 1];
+            const T er = (zr + cr) * T(0.5), ei = (zi + ci) * T(0.5);
+            const T or_ = (zi - ci) * T(0.5), oi = (cr - zr) * T(0.5);
+            const T wr = cos_[k], wi = sin_[k];
+            input[k] = er + wr * or_ - wi * oi;
+            input[M + k] = -(ei + wr * oi + wi * or_);
+        }
+
+        for (size_t i = 0; i < N; i++) {
+            output[i] = input[i];
+        }
+    }
+
+    void Inverse(T *input, T *output) {
+        // Z[k] = E[k] + i O[k] with E = X[k] + conj(X[M - k]) and O = (X[k] - conj(X[M - k])) / W^k, twice the forward terms,
+        // conjugated so the forward transform runs the inverse
+        output[0] = input[0] + input[M];
+        output[1] = -(input[0] - input[M]);
+        for (size_t k = 1; k < M; k++) {
+            const T xr = input[k], xi = -input[M + k];
+            const T cr = input[M - k], ci = input[N - k];
+            const T er = xr + cr, ei = xi + ci;
+            const T dr = xr - cr, di = xi - ci;
+            const T wr = cos_[k], wi = -sin_[k];
+            const T or_ = dr * wr - di * wi, oi = dr * wi + di * wr;
+            output[2 * k] = er - oi;
+            output[2 * k + 1] = -(ei + or_);
+        }
+
+        for (size_t i = 0; i < N; i++) {
+            input[i] = output[i];
+        }
+        transform(input, 1, output, M, 2);
+        for (size_t k = 0; k < M; k++) {
+            output[2 * k + 1] = -output[2 * k + 1];
+        }
+    }
+
+  private:
+    static const size_t M = N / 2;
+    static const size_t Twiddles = 3 * N / 4;
+
+    // n point transform of the complex points in[0], in[stride], ... into out, step is the twiddle index step of this size
+    void transform(const T *in, size_t stride, T *out, size_t n, size_t step) {
+        if (n == 1) {
+            out[0] = in[0];
+            out[1] = in[1];
+            return;
+        }
+        if (n == 2) {
+            const T *b = in + 2 * stride;
+            out[0] = in[0] + b[0];
+            out[1] = in[1] + b[1];
+            out[2] = in[0] - b[0];
+            out[3] = in[1] - b[1];
+            return;
+        }
+
+        const size_t q = n / 4;
+        transform(in, 2 * stride, out, n / 2, 2 * step);
+        transform(in + 2 * stride, 4 * stride, out + n, q, 4 * step);
+        transform(in + 6 * stride, 4 * stride, out + 3 * n / 2, q, 4 * step);
+
+        for (size_t k = 0; k < q; k++) {
+            T *u0 = out + 2 * k;
+            T *u1 = u0 + n / 2;
+            T *z0 = u0 + n;
+            T *z1 = u0 + 3 * n / 2;
+
+            const T w1r = cos_[k * step], w1i = sin_[k * step];
+            const T w3r = cos_[3 * k * step], w3i = sin_[3 * k * step];
+            const T ar = z0[0] * w1r - z0[1] * w1i, ai = z0[0] * w1i + z0[1] * w1r;
+            const T br = z1[0] * w3r - z1[1] * w3i, bi = z1[0] * w3i + z1[1] * w3r;
+
+            const T sr = ar + br, si = ai + bi;
+            const T dr = ar - br, di = ai - bi;
+            const T ur = u0[0], ui = u0[1];
+            const T vr = u1[0], vi = u1[1];
+
+            u0[0] = ur + sr;
+            u0[1] = ui + si;
+            z0[0] = ur - sr;
+            z0[1] = ui - si;
+            u1[0] = vr + di;
+            u1[1] = vi - dr;
+            z1[0] = vr - di;
+            z1[1] = vi + dr;
+        }
+    }
+
+    T cos_[Twiddles];
+    T sin_[Twiddles];
+};
+
+#if FFT_BACKEND == FFT_BACKEND_CMSIS
+// arm_rfft_fast_f32, its packed layout (bin 0 and N/2 real parts first, then interleaved bins) converted to the common one
+template <typename T, size_t N> class CmsisFFT {
+  public:
+    static_assert(sizeof(T) == sizeof(float32_t), "the CMSIS real FFT is float only");
+
+    void Init() { arm_rfft_fast_init_f32(&instance_, N); }
+
+    void Direct(T *input, T *output) {
+        arm_rfft_fast_f32(&instance_, input, output, 0);
+
+        for (size_t i = 0; i < N; i++) {
+            input[i] = output[i];
+        }
+        output[0] = input[0];
+        output[M] = input[1];
+        for (size_t k = 1; k < M; k++) {
+            output[k] = input[2 * k];
+            output[M + k] = -input[2 * k + 1];
+        }
+    }
+
+    void Inverse(T *input, T *output) {
+        output[0] = input[0];
+        output[1] = input[M];
+        for (size_t k = 1; k < M; k++) {
+            output[2 * k] = input[k];
+            output[2 * k + 1] = -input[M + k];
+        }
+
+        // CMSIS scales the inverse by 1 / N
+        arm_rfft_fast_f32(&instance_, output, input, 1);
+        for (size_t i = 0; i < N; i++) {
+            output[i] = input[i] * T(N);
+        }
+    }
+
+  private:
+    static const size_t M = N / 2;
+
+    arm_rfft_fast_instance_f32 instance_;
+};
+#endif
+
+template <typename T, size_t N> struct RealFFTBackend {
+#if FFT_BACKEND == FFT_BACKEND_CMSIS
+    typedef CmsisFFT<T, N> type;
+#elif FFT_BACKEND == FFT_BACKEND_SPLIT_RADIX
+    typedef SplitRadixFFT<T, N> type;
+#else
+    typedef ShyFFT<T, N, RotationPhasor> type;
+#endif
+};
+
+template <typename T, size_t N> using RealFFT = typename RealFFTBackend<T, N>::type;
+
+// One plan per type and size for the whole firmware, so the tables of a backend exist once however many effects and channels
+// transform at that size. Initialized on the first call, make that from Init() rather than the audio callback
+template <typename T, size_t N> RealFFT<T, N> *SharedRealFFT() {
+    static RealFFT<T, N> fft;
+    static bool initialized = false;
+    if (!initialized) {
+        fft.Init();
+        initialized = true;
+    }
+    return &fft;
+}
+} // namespace soundmath
+
+#define REAL_FFT
+#endif
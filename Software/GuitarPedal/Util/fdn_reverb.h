@@ -0,0 +1,219 @@
+#pragma once
+#ifndef FDN_REVERB_H
+#define FDN_REVERB_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace bkshepherd {
+
+/** Lightweight 8 line feedback delay network reverb.
+
+    Each line is a power of two ring buffer (indexes are masked, no divides) followed by a one-pole lowpass for damping and a
+    gain that sets the decay time. The line outputs are mixed with an 8x8 Hadamard matrix, done as a fast Walsh-Hadamard
+    transform (24 adds and 8 multiplies), and fed back into the lines together with the input.
+
+    The shortest line is longer than MaxBlockSize, so a whole block can be read from every line before anything is written
+    back. Process() works on blocks of up to MaxBlockSize samples and splits longer requests.
+
+    Budget at 48kHz:
+    - Memory: LineCount * LineBufferSize floats for the delay memory (128KB, provided by the caller, typically in SDRAM) plus
+      under 2KB of state and scratch for one block.
+    - CPU: per sample 8 delay reads and writes, 8 one-pole filters, 8 feedback gains, the 24 add transform and the stereo
+      output sums, roughly 80 floating point operations and no divides, table lookups or interpolation. DaisySP's ReverbSc,
+      also 8 lines, runs a modulated delay with cubic interpolation and a random generator per line and reserves close to
+      400KB of delay memory.
+*/
+class FdnReverb {
+  public:
+    static constexpr int LineCount = 8;
+
+    /** Capacity of each delay line in samples, a power of two so indexes can be masked. The longest line is scaled from
+        48kHz, at higher sample rates the lines are clamped to the capacity */
+    static constexpr size_t LineBufferSize = 4096;
+
+    /** Largest number of samples processed in one go, must stay below the shortest line delay */
+    static constexpr size_t MaxBlockSize = 48;
+
+    /** Number of floats that have to be provided to Init() */
+    static constexpr size_t BufferSize = LineCount * LineBufferSize;
+
+    FdnReverb() {}
+    ~FdnReverb() {}
+
+    /** Initializes the reverb
+        \param sample_rate Audio sample rate in Hz
+        \param buffer Delay memory, BufferSize floats
+    */
+    void Init(float sample_rate, float *buffer) {
+        m_sampleRate = sample_rate;
+        m_buffer = buffer;
+        m_writeIndex = 0;
+        m_size = 1.0f;
+        m_decayTime = 2.0f;
+        m_damping = 0.0f;
+
+        Clear();
+        UpdateDelays();
+        SetDampingFrequency(8000.0f);
+    }
+
+    /** Clears the delay memory and the filter states */
+    void Clear() {
+        for (size_t i = 0; i < BufferSize; i++) {
+            m_buffer[i] = 0.0f;
+        }
+
+        for (int line = 0; line < LineCount; line++) {
+            m_damped[line] = 0.0f;
+        }
+    }
+
+    /** Sets the decay time
+        \param seconds Time for the reverb tail to fall by 60dB
+    */
+    void SetDecayTime(float seconds) {
+        m_decayTime = seconds > 0.05f ? seconds : 0.05f;
+        UpdateGains();
+    }
+
+    /** Sets the room size by scaling all line delays
+        \param size 0..1, 0 is a small room (a quarter of the full line lengths), 1 is the full line lengths
+    */
+    void SetSize(float size) {
+        size = size < 0.0f ? 0.0f : (size > 1.0f ? 1.0f : size);
+        m_size = 0.25f + 0.75f * size;
+        UpdateDelays();
+    }
+
+    /** Sets the cutoff of the damping lowpass in the feedback path
+        \param hz Cutoff frequency in Hz
+    */
+    void SetDampingFrequency(float hz) {
+        const float maxHz = m_sampleRate * 0.49f;
+        hz = hz < 20.0f ? 20.0f : (hz > maxHz ? maxHz : hz);
+        m_damping = expf(-2.0f * static_cast<float>(M_PI) * hz / m_sampleRate);
+    }
+
+    /** Processes a block of audio
+        \param inL Left input
+        \param inR Right input
+        \param outL Left wet output
+        \param outR Right wet output
+        \param size Number of samples
+    */
+    void Process(const float *inL, const float *inR, float *outL, float *outR, size_t size) {
+        while (size > 0) {
+            const size_t count = size < MaxBlockSize ? size : MaxBlockSize;
+            ProcessChunk(inL, inR, outL, outR, count);
+            inL += count;
+            inR += count;
+            outL += count;
+            outR += count;
+            size -= count;
+        }
+    }
+
+  private:
+    static constexpr size_t LineMask = LineBufferSize - 1;
+
+    // Line lengths in samples at 48kHz, mutually prime and spread over 30..60ms so the echoes don't line up
+    static constexpr int s_baseDelays[LineCount] = {1433, 1601, 1867, 2053, 2251, 2399, 2617, 2797};
+
+    void ProcessChunk(const float *inL, const float *inR, float *outL, float *outR, size_t count) {
+        // Read the block from every line first, the lines are all longer than a block so none of these samples is written
+        // by this block
+        for (int line = 0; line < LineCount; line++) {
+            const float *lineBuffer = m_buffer + line * LineBufferSize;
+            float *lineOut = m_lineOut[line];
+            size_t readIndex = m_writeIndex - m_delays[line];
+
+            for (size_t i = 0; i < count; i++) {
+                lineOut[i] = lineBuffer[(readIndex + i) & LineMask];
+            }
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            float x[LineCount];
+
+            // Stereo output taken before the damping, alternating signs keep the two channels decorrelated
+            outL[i] = (m_lineOut[0][i] - m_lineOut[2][i] + m_lineOut[4][i] - m_lineOut[6][i]) * s_outputGain;
+            outR[i] = (m_lineOut[1][i] - m_lineOut[3][i] + m_lineOut[5][i] - m_lineOut[7][i]) * s_outputGain;
+
+            // Damping and decay
+            for (int line = 0; line < LineCount; line++) {
+                m_damped[line] = m_lineOut[line][i] + m_damping * (m_damped[line] - m_lineOut[line][i]);
+                x[line] = m_damped[line] * m_gains[line];
+            }
+
+            // Fast Walsh-Hadamard transform, normalized so the matrix is orthogonal and the loop gain stays below 1
+            for (int span = 1; span < LineCount; span <<= 1) {
+                for (int j = 0; j < LineCount; j += span << 1) {
+                    for (int k = j; k < j + span; k++) {
+                        const float a = x[k];
+                        const float b = x[k + span];
+                        x[k] = a + b;
+                        x[k + span] = a - b;
+                    }
+                }
+            }
+
+            // Left input feeds the even lines and right input the odd ones, with the same signs as the output taps
+            const float left = inL[i] * s_inputGain;
+            const float right = inR[i] * s_inputGain;
+            const size_t writeIndex = (m_writeIndex + i) & LineMask;
+            for (int line = 0; line < LineCount; line += 2) {
+                const float sign = (line & 2) ? -1.0f : 1.0f;
+                m_buffer[line * LineBufferSize + writeIndex] = x[line] * s_hadamardScale + sign * left;
+                m_buffer[(line + 1) * LineBufferSize + writeIndex] = x[line + 1] * s_hadamardScale + sign * right;
+            }
+        }
+
+        m_writeIndex = (m_writeIndex + count) & LineMask;
+    }
+
+    void UpdateDelays() {
+        const float scale = m_size * m_sampleRate / 48000.0f;
+
+        for (int line = 0; line < LineCount; line++) {
+            size_t delay = static_cast<size_t>(s_baseDelays[line] * scale);
+            if (delay <= MaxBlockSize) {
+                delay = MaxBlockSize + 1;
+            } else if (delay > LineBufferSize - 1) {
+                delay = LineBufferSize - 1;
+            }
+            m_delays[line] = delay;
+        }
+
+        UpdateGains();
+    }
+
+    void UpdateGains() {
+        // Each pass through a line has to lose delay / (decay time * sample rate) of the 60dB
+        for (int line = 0; line < LineCount; line++) {
+            m_gains[line] = powf(10.0f, -3.0f * m_delays[line] / (m_decayTime * m_sampleRate));
+        }
+    }
+
+    static constexpr float s_hadamardScale = 0.35355339f; // 1 / sqrt(LineCount)
+    static constexpr float s_inputGain = 0.5f;
+    static constexpr float s_outputGain = 0.5f;
+
+    float m_sampleRate = 48000.0f;
+    float *m_buffer = nullptr;
+    size_t m_writeIndex = 0;
+
+    float m_size = 1.0f;
+    float m_decayTime = 2.0f;
+    float m_damping = 0.0f;
+
+    size_t m_delays[LineCount] = {};
+    float m_gains[LineCount] = {};
+    float m_damped[LineCount] = {};
+    float m_lineOut[LineCount][MaxBlockSize] = {};
+};
+
+} // namespace bkshepherd
+
+#endif
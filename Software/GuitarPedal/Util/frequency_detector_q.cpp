@@ -4,11 +4,10 @@
 #include <q/pitch/pitch_detector.hpp>
 #include <q/support/pitch_names.hpp>
 
-#include "daisy.h"
-
 using namespace cycfi::q;
 
-FrequencyDetectorQ::FrequencyDetectorQ() {}
+FrequencyDetectorQ::FrequencyDetectorQ()
+    : m_cachedFrequency(0.0f), m_bufferIndex(0), m_detectionSampleCount(0), m_detectionSampleRate(k_detectionSampleRate) {}
 
 FrequencyDetectorQ::~FrequencyDetectorQ() {
     delete m_pitchDetector;
@@ -23,15 +22,32 @@ void FrequencyDetectorQ::Init(float sampleRate) {
     frequency lowest_frequency = cycfi::q::pitch_names::C[1];
     frequency highest_frequency = cycfi::q::pitch_names::C[5];
 
-    m_pitchDetector = new pitch_detector{lowest_frequency, highest_frequency, sampleRate, lin_to_db(0)};
+    // Decimate to about 12kHz (a factor of 4 at 48kHz)
+    const size_t factor = static_cast<size_t>(sampleRate / k_detectionSampleRate + 0.5f);
+    m_decimationFactor = factor < 1 ? 1 : (factor > max_resample_factor ? max_resample_factor : factor);
+    m_decimator.init(m_decimationFactor, sampleRate, k_detectionPassband);
+    m_detectionSampleRate = sampleRate / m_decimationFactor;
+    m_bufferIndex = 0;
+    m_detectionSampleCount = 0;
+    m_cachedFrequency = 0.0f;
+
+    m_pitchDetector = new pitch_detector{lowest_frequency, highest_frequency, m_detectionSampleRate, lin_to_db(0)};
 
     cycfi::q::signal_conditioner::config preprocessor_config;
-    m_preProcessor = new signal_conditioner{preprocessor_config, lowest_frequency, highest_frequency, sampleRate};
+    m_preProcessor = new signal_conditioner{preprocessor_config, lowest_frequency, highest_frequency, m_detectionSampleRate};
 }
 
 float FrequencyDetectorQ::Process(float in) {
+    // Collect a detector sample worth of input
+    m_decimationBuffer[m_bufferIndex++] = in;
+    if (m_bufferIndex < m_decimationFactor) {
+        return m_cachedFrequency;
+    }
+    m_bufferIndex = 0;
+    m_detectionSampleCount++;
+
     // Pre-process the signal for pitch detection
-    float preProcessedSignal = m_preProcessor->operator()(in);
+    float preProcessedSignal = m_preProcessor->operator()(m_decimator(m_decimationBuffer));
 
     // Send the processed sample through the pitch detector
     const bool ready = m_pitchDetector->operator()(preProcessedSignal);
@@ -40,10 +56,10 @@ float FrequencyDetectorQ::Process(float in) {
     if (ready) {
         const float freq = m_pitchDetector->get_frequency();
 
-        // Run a smoothing filter on the detected frequency
-        const float currentTimeInSeconds = static_cast<float>(daisy::System::GetNow()) / 1000.f;
+        // Run a smoothing filter on the detected frequency, timed by the samples the detector has seen
+        const double currentTimeInSeconds = static_cast<double>(m_detectionSampleCount) / m_detectionSampleRate;
         m_cachedFrequency = m_smoothingFilter(freq, currentTimeInSeconds);
     }
 
     return m_cachedFrequency;
-}
\ No newline at end of file
+}
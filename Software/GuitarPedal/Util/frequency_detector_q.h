@@ -1,9 +1,11 @@
 #pragma once
 #ifndef FREQUENCY_DETECTOR_Q_H
 #define FREQUENCY_DETECTOR_Q_H
+#include <cstddef>
 #include <cstdint>
 
 #include "1efilter.hpp"
+#include "Multirate.h"
 #include "frequency_detector_interface.h"
 
 namespace cycfi {
@@ -13,6 +15,8 @@ class signal_conditioner;
 } // namespace q
 } // namespace cycfi
 
+// Pitch detection with the q signal conditioner and bitstream autocorrelation detector, run on the input decimated to about
+// 12kHz. The detection range (C1 to C5) is far below that, so the detector and conditioner only see every 4th sample at 48kHz.
 class FrequencyDetectorQ : public FrequencyDetectorInterface {
   public:
     FrequencyDetectorQ();
@@ -21,8 +25,23 @@ class FrequencyDetectorQ : public FrequencyDetectorInterface {
     float Process(float in) override;
 
   private:
+    // Rate the detector runs at
+    static constexpr float k_detectionSampleRate = 12000.0f;
+
+    // Highest frequency kept by the decimation filter, harmonics up to here help the detector lock
+    static constexpr float k_detectionPassband = 2500.0f;
+
     float m_cachedFrequency;
-    int m_bufferIndex;
+
+    // Decimation to the detection rate, m_decimationFactor input samples per detector sample
+    PolyphaseDecimator m_decimator;
+    size_t m_decimationFactor = 1;
+    float m_decimationBuffer[max_resample_factor];
+    size_t m_bufferIndex;
+
+    // Time of the detector in samples at the detection rate, the smoothing filter is driven by it
+    uint32_t m_detectionSampleCount;
+    float m_detectionSampleRate;
 
     cycfi::q::pitch_detector *m_pitchDetector = nullptr;
     cycfi::q::signal_conditioner *m_preProcessor = nullptr;
@@ -32,6 +51,6 @@ class FrequencyDetectorQ : public FrequencyDetectorInterface {
     // cutoff freq
     // beta: 0.0f disables it entirely, but used for scaling cutoff frequency
     // derivative cutoff freq: used when beta is > 0
-    one_euro_filter<float, float> m_smoothingFilter{48000, 0.5f, 0.05f, 1.0f};
+    one_euro_filter<float, double> m_smoothingFilter{48000, 0.5f, 0.05f, 1.0f};
 };
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,484 @@
+#pragma once
+#ifndef LOOPER_CORE_H
+#define LOOPER_CORE_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmath>
+
+#include "masked_delay_line.h"
+
+namespace bkshepherd {
+
+/** Multimode audio looper, DaisySP's Looper with the samples kept through a storage policy.
+
+    The modes, the recording states, the fade-in window and the read position (including variable speed and reverse) work
+    the same as daisysp::Looper. The only difference is the buffer: with Int16Storage a loop takes half the memory of float,
+    so the same SDRAM holds twice the loop time, with Packed24Storage three quarters. Once the fade after a recording is
+    written, playback doesn't write, so a stored loop plays back the same on every pass. Normal and one-time dubs on whole
+    samples add the input to the stored sample (Storage::Add()), so only the new layer is quantized and the loop underneath
+    is kept bit for bit. With NativeStorage<float> that is the same sum daisysp::Looper writes. Replace writes the new input
+    and Fripp the faded loop, both are quantized once per pass like any recording, and dubs between samples (half speed,
+    other increments) write the interpolated loop plus the input like daisysp::Looper, requantized.
+
+    Modes:
+    - Normal: the input is added to the loop while recording
+    - One-time dub: recording starts at the beginning of the loop and stops after one pass
+    - Replace: the input replaces the loop while recording
+    - Fripp: the loop fades by about 3dB per pass while recording (Frippertronics)
+
+    Process() with a block plays a loop that is only being played back through a windowed sinc interpolator instead of
+    the linear one of the sample version. Above unity speed its kernel is stretched by the speed, which moves the cutoff
+    down to the new Nyquist so fast playback doesn't alias, below unity it suppresses the images that linear interpolation
+    leaves. The speed glides from the one of the previous block to the one set now across the block. The kernel is chosen
+    once per block: the unity one up to unity speed, else one stretched for the fastest speed of the block, rounded up to
+    an eighth, whose table is only rebuilt when that changes.
+
+    \tparam Storage NativeStorage<float>, Int16Storage or Packed24Storage. Loops are summed with the input while dubbing, so
+    the headroom of the integer formats is what layers can build up to before they clip.
+*/
+template <typename Storage = NativeStorage<float>> class LooperCore {
+  public:
+    typedef typename Storage::Stored Stored;
+
+    enum class Mode {
+        NORMAL,
+        ONETIME_DUB,
+        REPLACE,
+        FRIPP,
+    };
+
+    LooperCore() {}
+    ~LooperCore() {}
+
+    /** Initializes the looper and clears the buffer
+        \param mem Memory for the loop, in the stored format
+        \param size Size of the buffer in samples, the longest loop
+    */
+    void Init(Stored *mem, size_t size) {
+        buffer_size_ = size;
+        buff_ = mem;
+
+        InitBuff();
+        state_ = State::EMPTY;
+        mode_ = Mode::NORMAL;
+        half_speed_ = false;
+        reverse_ = false;
+        rec_queue_ = false;
+        win_idx_ = 0;
+        increment_size_ = 1.0f;
+        velocity_ = 1.0f;
+        pos_ = 0.0f;
+        recsize_ = 0;
+        near_beginning_ = false;
+
+        // Blackman windowed sinc, one side of it
+        for (size_t i = 0; i < kSincTableSize; i++) {
+            const float x = static_cast<float>(i) / kSincResolution;
+            const float window = 0.42f + 0.5f * cosf(kPi * x / kSincZeroCrossings) + 0.08f * cosf(2.0f * kPi * x / kSincZeroCrossings);
+            sinc_table_[i] = (i == 0 ? 1.0f : sinf(kPi * x) / (kPi * x)) * window;
+        }
+        sinc_table_[kSincTableSize - 1] = 0.0f;
+
+        // The same kernel per fraction of a sample, for the taps around the read position up to unity speed
+        BuildPhases(polyphase_, kSincResolution, kSincZeroCrossings, 1.0f);
+        stretch_ = 0.0f;
+        stretch_taps_ = kSincTaps;
+    }
+
+    /** Handles reading/writing to the buffer depending on the mode */
+    float Process(const float input) {
+        split_pos_valid_ = false;
+
+        float sig = 0.f;
+        float inc;
+        bool hitloop = false;
+
+        switch (state_) {
+        case State::EMPTY:
+            sig = 0.0f;
+            break;
+        case State::REC_FIRST:
+            sig = 0.f;
+            Write(pos_, input * WindowVal(win_idx_ * kWindowFactor));
+            if (win_idx_ < kWindowSamps - 1) {
+                win_idx_ += 1;
+            }
+            recsize_ = pos_;
+            pos_++;
+            if (pos_ > buffer_size_ - 1) {
+                state_ = State::PLAYING;
+                recsize_ = pos_ - 1;
+                pos_ = 0;
+            }
+            break;
+        case State::PLAYING:
+            sig = Read(pos_);
+
+            // Seamless looping: the first samples after recording stopped are still recorded, with the input faded out
+            if (win_idx_ < kWindowSamps - 1) {
+                Dub(pos_, sig, input * (1.f - WindowVal(win_idx_ * kWindowFactor)));
+                win_idx_ += 1;
+            }
+
+            inc = half_speed_ ? 0.5f : increment_size_;
+            velocity_ = reverse_ ? -inc : inc;
+            pos_ += velocity_;
+            if (pos_ > recsize_ - 1) {
+                pos_ = 0;
+                hitloop = true;
+            } else if (pos_ < 0) {
+                pos_ = recsize_ - 1;
+                hitloop = true;
+            }
+            if (hitloop && rec_queue_) {
+                rec_queue_ = false;
+                state_ = State::REC_DUB;
+                win_idx_ = 0;
+            }
+            break;
+        case State::REC_DUB:
+            sig = Read(pos_);
+            switch (mode_) {
+            case Mode::REPLACE:
+                Write(pos_, input * WindowVal(win_idx_ * kWindowFactor));
+                break;
+            case Mode::FRIPP:
+                Write(pos_, (input * WindowVal(win_idx_ * kWindowFactor)) + (sig * kFrippLoss));
+                break;
+            case Mode::ONETIME_DUB:
+            case Mode::NORMAL:
+            default:
+                Dub(pos_, sig, input * WindowVal(win_idx_ * kWindowFactor));
+                break;
+            }
+            if (win_idx_ < kWindowSamps - 1) {
+                win_idx_ += 1;
+            }
+
+            inc = half_speed_ ? 0.5f : increment_size_;
+            velocity_ = reverse_ ? -inc : inc;
+            pos_ += velocity_;
+            if (pos_ > recsize_ - 1) {
+                pos_ = 0;
+                hitloop = true;
+            } else if (pos_ < 0) {
+                pos_ = recsize_ - 1;
+                hitloop = true;
+            }
+            if (hitloop && mode_ == Mode::ONETIME_DUB) {
+                state_ = State::PLAYING;
+                win_idx_ = 0;
+            }
+            break;
+        default:
+            break;
+        }
+        near_beginning_ = state_ != State::EMPTY && !Recording() && pos_ < 4800;
+
+        return sig;
+    }
+
+    /** Processes a block, in and out can be the same buffer. The read position moves like in the sample version (including
+        where it wraps), only the interpolation and the speed glide differ */
+    void Process(const float *in, float *out, size_t size) {
+        // Recording, the fade after it and a queued dub change the state on the way, those go sample by sample
+        if (state_ != State::PLAYING || win_idx_ < kWindowSamps - 1 || rec_queue_ || recsize_ < kMinSincLoop || size == 0) {
+            for (size_t i = 0; i < size; i++) {
+                out[i] = Process(in[i]);
+            }
+            return;
+        }
+
+        // pos_ can't step by a fraction accurately far into a long loop (a float has 24 bits), the block reader keeps the
+        // sample and the fraction apart while it plays
+        if (!split_pos_valid_) {
+            read_index_ = static_cast<int32_t>(pos_);
+            read_frac_ = pos_ - read_index_;
+            split_pos_valid_ = true;
+        }
+
+        const float target = reverse_ ? -(half_speed_ ? 0.5f : increment_size_) : (half_speed_ ? 0.5f : increment_size_);
+        const float step = (target - velocity_) / size;
+        const int32_t last = static_cast<int32_t>(recsize_) - 1;
+
+        // Landed on unity speed between two samples, move to the nearest one so playback goes back to copying samples
+        if (step == 0.0f && (velocity_ == 1.0f || velocity_ == -1.0f) && read_frac_ != 0.0f) {
+            read_index_ += read_frac_ >= 0.5f ? 1 : 0;
+            read_index_ = read_index_ > last ? 0 : read_index_;
+            read_frac_ = 0.0f;
+        }
+
+        if (step == 0.0f && (velocity_ == 1.0f || velocity_ == -1.0f) && read_frac_ == 0.0f) {
+            // Unity speed on a sample, the kernel is 1 on it and 0 on the others
+            const int32_t direction = velocity_ > 0.0f ? 1 : -1;
+            for (size_t i = 0; i < size; i++) {
+                out[i] = Storage::Decode(buff_[read_index_]);
+                read_index_ += direction;
+                read_index_ = read_index_ > last ? 0 : (read_index_ < 0 ? last : read_index_);
+            }
+        } else {
+            // One kernel for the whole block, stretched for the fastest speed in it
+            const float fastest = fmaxf(fabsf(velocity_), fabsf(target));
+            const float *phases = polyphase_;
+            int32_t taps = kSincTaps;
+            int32_t resolution = kSincResolution;
+            if (fastest > 1.0f) {
+                UpdateStretch(fastest);
+                phases = stretch_phases_;
+                taps = stretch_taps_;
+                resolution = kStretchResolution;
+            }
+
+            // Kept in locals, out could alias the members as far as the compiler knows
+            float velocity = velocity_;
+            int32_t index = read_index_;
+            float frac = read_frac_;
+            for (size_t i = 0; i < size; i++) {
+                out[i] = ReadKernel(phases, taps, resolution, index, frac);
+                velocity += step;
+                frac += velocity;
+                if (frac >= 1.0f || frac < 0.0f) {
+                    // floorf without the library call, the cast rounds towards zero
+                    int32_t whole = static_cast<int32_t>(frac);
+                    whole -= frac < static_cast<float>(whole) ? 1 : 0;
+                    index += whole;
+                    frac -= static_cast<float>(whole);
+                }
+                if (index > last || (index == last && frac > 0.0f)) {
+                    index = 0;
+                    frac = 0.0f;
+                } else if (index < 0) {
+                    index = last;
+                    frac = 0.0f;
+                }
+            }
+            read_index_ = index;
+            read_frac_ = frac;
+            velocity_ = target;
+        }
+
+        pos_ = read_index_ + read_frac_;
+        near_beginning_ = pos_ < 4800;
+    }
+
+    /** Effectively erases the buffer */
+    inline void Clear() { state_ = State::EMPTY; }
+
+    /** Engages/disengages the recording, depending on the mode */
+    inline void TrigRecord() {
+        switch (state_) {
+        case State::EMPTY:
+            pos_ = 0;
+            recsize_ = 0;
+            state_ = State::REC_FIRST;
+            half_speed_ = false;
+            reverse_ = false;
+            break;
+        case State::REC_FIRST:
+        case State::REC_DUB:
+            state_ = State::PLAYING;
+            break;
+        case State::PLAYING:
+            if (mode_ == Mode::ONETIME_DUB) {
+                rec_queue_ = true;
+            } else {
+                state_ = State::REC_DUB;
+            }
+            break;
+        default:
+            state_ = State::EMPTY;
+            break;
+        }
+        if (!rec_queue_) {
+            win_idx_ = 0;
+        }
+    }
+
+    inline bool Recording() const { return state_ == State::REC_DUB || state_ == State::REC_FIRST; }
+    inline bool RecordingQueued() const { return rec_queue_; }
+
+    inline void IncrementMode() {
+        int m = static_cast<int>(mode_);
+        m = m + 1;
+        if (m > kNumModes - 1) {
+            m = 0;
+        }
+        mode_ = static_cast<Mode>(m);
+    }
+    inline void SetMode(Mode mode) { mode_ = mode; }
+    inline Mode GetMode() const { return mode_; }
+
+    inline void ToggleReverse() { reverse_ = !reverse_; }
+    inline void SetReverse(bool state) { reverse_ = state; }
+    inline bool GetReverse() const { return reverse_; }
+
+    inline void ToggleHalfSpeed() { half_speed_ = !half_speed_; }
+    inline void SetHalfSpeed(bool state) { half_speed_ = state; }
+    inline bool GetHalfSpeed() const { return half_speed_; }
+
+    /** Samples the read position moves per sample, unless half speed is on */
+    inline void SetIncrementSize(float increment) { increment_size_ = increment; }
+
+    inline bool IsNearBeginning() const { return near_beginning_; }
+    inline float GetPos() const { return pos_; }
+    inline size_t GetRecSize() const { return recsize_; }
+
+  private:
+    static constexpr float kFrippLoss = 0.7071f;
+    static constexpr int32_t kWindowSamps = 1200;
+    static constexpr float kWindowFactor = (1.f / kWindowSamps);
+    static constexpr int kNumModes = 4;
+
+    // Windowed sinc reader, the kernel spans kSincZeroCrossings samples on each side at unity speed
+    static constexpr float kPi = 3.14159265358979f;
+    static constexpr int32_t kSincZeroCrossings = 4;
+    static constexpr int32_t kSincResolution = 64;
+    static constexpr size_t kSincTableSize = kSincZeroCrossings * kSincResolution + 2;
+    static constexpr int32_t kSincTaps = 2 * kSincZeroCrossings;
+
+    // Stretched kernels, up to 3 times speed (the widest one has 24 taps), with fewer phases as they are smoother
+    static constexpr float kMaxStretch = 3.0f;
+    static constexpr int32_t kMaxStretchTaps = 2 * static_cast<int32_t>(kSincZeroCrossings * kMaxStretch);
+    static constexpr int32_t kStretchResolution = 32;
+
+    // Shorter loops than the widest kernel go through the linear reader
+    static constexpr size_t kMinSincLoop = 64;
+
+    enum class State {
+        EMPTY,
+        REC_FIRST,
+        PLAYING,
+        REC_DUB,
+    };
+
+    static inline float WindowVal(float in) { return sinf(1.5707963267948966f * in); }
+
+    void InitBuff() {
+        storage_.Reset();
+        for (size_t i = 0; i < buffer_size_; i++) {
+            buff_[i] = Stored();
+        }
+    }
+
+    inline float Read(float pos) const {
+        const uint32_t i_idx = static_cast<uint32_t>(pos);
+        const float frac = pos - i_idx;
+        const uint32_t next = i_idx + 1 < buffer_size_ ? i_idx + 1 : 0;
+        const float a = Storage::Decode(buff_[i_idx]);
+        const float b = Storage::Decode(buff_[next]);
+        return a + (b - a) * frac;
+    }
+
+    /** Reads between loop samples with a kernel of taps taps per phase, resolution + 1 phases from frac 0 to 1. Taps past
+        the ends of the loop wrap around to the other end */
+    inline float ReadKernel(const float *phases, int32_t taps, int32_t resolution, int32_t index, float frac) const {
+        const int32_t first = index - taps / 2 + 1;
+        const int32_t length = static_cast<int32_t>(recsize_);
+
+        const Stored *samples = buff_ + first;
+        Stored wrapped[kMaxStretchTaps];
+        if (first < 0 || first + taps > length) {
+            for (int32_t tap = 0; tap < taps; tap++) {
+                const int32_t j = first + tap;
+                wrapped[tap] = buff_[j < 0 ? j + length : (j >= length ? j - length : j)];
+            }
+            samples = wrapped;
+        }
+
+        // The weights of the taps are interpolated between the two nearest phases, each phase sums to 1
+        const float position = frac * resolution;
+        const int32_t phase = static_cast<int32_t>(position);
+        const float phaseFrac = position - phase;
+        const float *a = phases + phase * taps;
+        const float *b = a + taps;
+
+        // Two sums (taps is even) so the additions don't all wait on each other
+        float even = 0.0f;
+        float odd = 0.0f;
+        for (int32_t tap = 0; tap < taps; tap += 2) {
+            even += (a[tap] + phaseFrac * (b[tap] - a[tap])) * Storage::Decode(samples[tap]);
+            odd += (a[tap + 1] + phaseFrac * (b[tap + 1] - a[tap + 1])) * Storage::Decode(samples[tap + 1]);
+        }
+        return even + odd;
+    }
+
+    /** Fills resolution + 1 phases of 2 * half taps of the kernel stretched by stretch, normalized so the level doesn't
+        ripple with the fraction */
+    void BuildPhases(float *phases, int32_t resolution, int32_t half, float stretch) const {
+        const float tableStep = kSincResolution / stretch;
+        for (int32_t phase = 0; phase <= resolution; phase++) {
+            float *weights = phases + phase * 2 * half;
+            const float frac = static_cast<float>(phase) / resolution;
+
+            float sum = 0.0f;
+            for (int32_t tap = 0; tap < 2 * half; tap++) {
+                weights[tap] = Kernel((frac - (tap - half + 1)) * tableStep);
+                sum += weights[tap];
+            }
+            for (int32_t tap = 0; tap < 2 * half; tap++) {
+                weights[tap] /= sum;
+            }
+        }
+    }
+
+    /** Stretches the kernel for speed (above unity) rounded up to an eighth, so a glide only rebuilds it every so often */
+    void UpdateStretch(float speed) {
+        float stretch = ceilf(speed * 8.0f) * 0.125f;
+        stretch = stretch > kMaxStretch ? kMaxStretch : stretch;
+        if (stretch != stretch_) {
+            stretch_ = stretch;
+            const int32_t half = static_cast<int32_t>(ceilf(kSincZeroCrossings * stretch));
+            stretch_taps_ = 2 * half;
+            BuildPhases(stretch_phases_, kStretchResolution, half, stretch);
+        }
+    }
+
+    /** Kernel at a distance in table entries */
+    inline float Kernel(float x) const {
+        const float a = fabsf(x);
+        const size_t index = static_cast<size_t>(a);
+        if (index >= kSincTableSize - 1) {
+            return 0.0f;
+        }
+        return sinc_table_[index] + (a - index) * (sinc_table_[index + 1] - sinc_table_[index]);
+    }
+
+    inline void Write(float pos, float val) { buff_[static_cast<size_t>(pos)] = storage_.Encode(val); }
+
+    /** Writes sig + add at pos, sig being the loop read at pos. On a whole sample sig is the stored sample, which is kept as
+        it is and only add is quantized */
+    inline void Dub(float pos, float sig, float add) {
+        const size_t index = static_cast<size_t>(pos);
+        if (pos == static_cast<float>(index)) {
+            buff_[index] = storage_.Add(buff_[index], add);
+        } else {
+            Write(pos, add + sig);
+        }
+    }
+
+    Storage storage_;
+    Stored *buff_ = nullptr;
+    size_t buffer_size_ = 0;
+    float pos_ = 0.0f;
+    float increment_size_ = 1.0f;
+    float velocity_ = 1.0f; // signed increment of the last sample
+    int32_t read_index_ = 0; // position of the block reader, split in the sample and the fraction
+    float read_frac_ = 0.0f;
+    bool split_pos_valid_ = false;
+    size_t recsize_ = 0;
+    int32_t win_idx_ = 0;
+    State state_ = State::EMPTY;
+    Mode mode_ = Mode::NORMAL;
+    bool half_speed_ = false;
+    bool reverse_ = false;
+    bool rec_queue_ = false;
+    bool near_beginning_ = false;
+    float sinc_table_[kSincTableSize];
+    float polyphase_[(kSincResolution + 1) * kSincTaps];
+    float stretch_ = 0.0f; // of the stretched kernel, 0 until one is built
+    int32_t stretch_taps_ = kSincTaps;
+    float stretch_phases_[(kStretchResolution + 1) * kMaxStretchTaps];
+};
+} // namespace bkshepherd
+#endif
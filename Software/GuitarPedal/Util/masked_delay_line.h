@@ -0,0 +1,315 @@
+#pragma once
+#ifndef MASKED_DELAY_LINE_H
+#define MASKED_DELAY_LINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace bkshepherd {
+
+/** Smallest power of two that is >= value */
+constexpr size_t NextPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+/** Largest power of two that is <= value (0 for 0) */
+constexpr size_t PreviousPowerOfTwo(size_t value) {
+    if (value == 0) {
+        return 0;
+    }
+    size_t result = 1;
+    while ((result << 1) != 0 && (result << 1) <= value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+/** Storage policies for MaskedDelayLine, they convert between the sample type and what is kept in the buffer */
+
+/** Keeps the samples as they are */
+template <typename T> struct NativeStorage {
+    typedef T Stored;
+
+    void Reset() {}
+    inline Stored Encode(const T sample) { return sample; }
+    static inline T Decode(const Stored stored) { return stored; }
+
+    /** Stored value with sample added, see Int16Storage::Add() */
+    inline Stored Add(const Stored stored, const T sample) { return stored + sample; }
+};
+
+/** 16 bit samples, half the memory and bus traffic of float.
+
+    Samples are scaled so that +-(1 << HeadroomBits) is full scale, the default leaves 6dB for feedback build up above 0dBFS
+    before clipping. Triangular dither of one LSB is added before rounding so the quantization error stays noise instead of
+    distortion on decaying repeats (the noise floor is around -90dB relative to 0dBFS with one bit of headroom).
+*/
+template <int HeadroomBits = 1> struct Int16Storage {
+    typedef int16_t Stored;
+
+    static constexpr float FullScale = static_cast<float>(1 << HeadroomBits);
+
+    void Reset() { seed_ = 1; }
+
+    inline Stored Encode(const float sample) { return Quantize(sample * (32767.0f / FullScale)); }
+
+    static inline float Decode(const Stored stored) { return static_cast<float>(stored) * (FullScale / 32767.0f); }
+
+    /** Stored value with sample added. Only sample is dithered and rounded, the stored value is kept as it is, so adding to a
+        sample (a looper overdub) doesn't requantize what is already there. Adding silence leaves it unchanged */
+    inline Stored Add(const Stored stored, const float sample) {
+        return sample == 0.0f ? stored : Quantize(static_cast<float>(stored) + sample * (32767.0f / FullScale));
+    }
+
+    uint32_t seed_ = 1;
+
+  private:
+    inline Stored Quantize(float scaled) {
+        // Two 16 bit uniform values from one LCG step, their difference is triangular over +-1 LSB
+        seed_ = seed_ * 1664525u + 1013904223u;
+        const float dither = (static_cast<float>(seed_ & 0xFFFF) - static_cast<float>(seed_ >> 16)) * (1.0f / 65536.0f);
+
+        scaled += dither;
+        scaled = scaled < -32768.0f ? -32768.0f : (scaled > 32767.0f ? 32767.0f : scaled);
+        return static_cast<Stored>(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+    }
+};
+
+/** 24 bit sample packed in 3 bytes */
+struct Packed24 {
+    uint8_t bytes[3];
+};
+
+/** Packed 24 bit samples, three quarters of the memory of float. The quantization is far below the analog noise floor so no
+    dither is added. Uses the same headroom as Int16Storage */
+template <int HeadroomBits = 1> struct Packed24Storage {
+    typedef Packed24 Stored;
+
+    static constexpr float FullScale = static_cast<float>(1 << HeadroomBits);
+
+    void Reset() {}
+
+    inline Stored Encode(const float sample) { return Quantize(sample * (8388607.0f / FullScale)); }
+
+    static inline float Decode(const Stored stored) { return static_cast<float>(Value(stored)) * (FullScale / 8388607.0f); }
+
+    /** Stored value with sample added, see Int16Storage::Add() */
+    inline Stored Add(const Stored stored, const float sample) {
+        return sample == 0.0f ? stored : Quantize(static_cast<float>(Value(stored)) + sample * (8388607.0f / FullScale));
+    }
+
+  private:
+    static inline Stored Quantize(float scaled) {
+        scaled = scaled < -8388608.0f ? -8388608.0f : (scaled > 8388607.0f ? 8388607.0f : scaled);
+        const int32_t value = static_cast<int32_t>(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+
+        Stored stored;
+        stored.bytes[0] = static_cast<uint8_t>(value);
+        stored.bytes[1] = static_cast<uint8_t>(value >> 8);
+        stored.bytes[2] = static_cast<uint8_t>(value >> 16);
+        return stored;
+    }
+
+    static inline int32_t Value(const Stored stored) {
+        // Assemble in the top 24 bits so the arithmetic shift sign extends
+        return static_cast<int32_t>((static_cast<uint32_t>(stored.bytes[0]) << 8) | (static_cast<uint32_t>(stored.bytes[1]) << 16) |
+                                    (static_cast<uint32_t>(stored.bytes[2]) << 24)) >>
+               8;
+    }
+};
+
+/** Interpolation policies for MaskedDelayLine.
+
+    Each policy reads between the sample at position (the newer one) and the sample before it (the older one), frac is the
+    fraction of the way towards the older sample. Samples are read through the line's ReadPosition() which wraps the
+    position and decodes the storage.
+*/
+
+/** Linear interpolation between the two neighbouring samples */
+struct LinearInterpolation {
+    void Reset() {}
+
+    template <typename Line> auto Read(const Line &line, size_t position, float frac) {
+        const auto a = line.ReadPosition(position);
+        const auto b = line.ReadPosition(position - 1);
+        return a + (b - a) * frac;
+    }
+};
+
+/** 4 point Hermite interpolation, also reads one sample newer and one sample older than the linear neighbours so delays
+    should be at least 2 samples */
+struct CubicInterpolation {
+    void Reset() {}
+
+    template <typename Line> auto Read(const Line &line, size_t position, float frac) {
+        return Interpolate(line.ReadPosition(position + 1), line.ReadPosition(position), line.ReadPosition(position - 1),
+                           line.ReadPosition(position - 2), frac);
+    }
+
+    template <typename T> static T Interpolate(const T xm1, const T x0, const T x1, const T x2, const float f) {
+        const float c = (x1 - xm1) * 0.5f;
+        const float v = x0 - x1;
+        const float w = c + v;
+        const float a = w + v + (x2 - x0) * 0.5f;
+        const float b_neg = w + a;
+        return (((a * f) - b_neg) * f + c) * f + x0;
+    }
+};
+
+/** First order allpass interpolation. Flat magnitude response which suits delays inside feedback loops, but it keeps the
+    previous output so a line using it should only have a single read head that moves slowly */
+struct AllpassInterpolation {
+    void Reset() { last_ = 0.0f; }
+
+    template <typename Line> auto Read(const Line &line, size_t position, float frac) {
+        const auto a = line.ReadPosition(position);
+        const auto b = line.ReadPosition(position - 1);
+        const float coefficient = (1.0f - frac) / (1.0f + frac);
+        last_ = b + (a - last_) * coefficient;
+        return last_;
+    }
+
+    float last_ = 0.0f;
+};
+
+/** Delay line over a power of two buffer so every index is a mask instead of a modulo.
+
+    Delays are in samples, Read(1) returns the most recently written sample. Reading before writing (the usual feedback
+    delay) with a delay of d returns the input from d samples ago.
+
+    Block processing: ReadInterpolated() with an array of delays followed by Write() with a block gives the same result as
+    reading and writing one sample at a time, as long as every delay is at least the block size, one more with cubic
+    interpolation (so no sample that is still to be written is read).
+
+    \tparam T sample type
+    \tparam Interpolation one of the interpolation policies above
+    \tparam Storage one of the storage policies above, Int16Storage or Packed24Storage to save memory
+*/
+template <typename T, typename Interpolation = LinearInterpolation, typename Storage = NativeStorage<T>> class MaskedDelayLine {
+  public:
+    typedef T Sample;
+    typedef typename Storage::Stored Stored;
+
+    MaskedDelayLine() : buffer_(nullptr), mask_(0), write_pos_(0) {}
+
+    /** Initializes the delay line and clears it
+        \param buffer Memory for the line, in the stored format
+        \param capacity Size of the buffer in samples, a power of two. Anything else is rounded down to one.
+    */
+    void Init(Stored *buffer, size_t capacity) {
+        buffer_ = buffer;
+        mask_ = PreviousPowerOfTwo(capacity) - 1;
+        Reset();
+    }
+
+    /** Clears the buffer and the interpolation state */
+    void Reset() {
+        storage_.Reset();
+        for (size_t i = 0; i < GetCapacity(); i++) {
+            buffer_[i] = Stored();
+        }
+        write_pos_ = 0;
+        interpolation_.Reset();
+    }
+
+    size_t GetCapacity() const { return mask_ + 1; }
+
+    /** Largest delay that can be read, for interpolated reads the largest integer part */
+    size_t GetMaxDelay() const { return mask_; }
+
+    /** Writes a sample and advances the write position */
+    inline void Write(const T sample) {
+        buffer_[write_pos_] = storage_.Encode(sample);
+        write_pos_ = (write_pos_ + 1) & mask_;
+    }
+
+    /** Writes a block of samples */
+    void Write(const T *samples, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            buffer_[(write_pos_ + i) & mask_] = storage_.Encode(samples[i]);
+        }
+        write_pos_ = (write_pos_ + size) & mask_;
+    }
+
+    /** Reads the sample written delay samples ago */
+    inline T Read(size_t delay) const { return Storage::Decode(buffer_[(write_pos_ - delay) & mask_]); }
+
+    /** Reads with a fractional delay using the interpolation policy */
+    inline T ReadInterpolated(float delay) {
+        size_t integral;
+        float fractional;
+        SplitDelay(delay, integral, fractional);
+        return interpolation_.Read(*this, write_pos_ - integral, fractional);
+    }
+
+    /** Reads a block with one fractional delay per sample, call it before writing the same block
+        \param delays Delay for each sample of the block, at least size samples (size + 1 for cubic)
+        \param out Output for each sample of the block
+        \param size Number of samples in the block
+    */
+    void ReadInterpolated(const float *delays, T *out, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            size_t integral;
+            float fractional;
+            SplitDelay(delays[i], integral, fractional);
+            out[i] = interpolation_.Read(*this, write_pos_ + i - integral, fractional);
+        }
+    }
+
+    /** Position the next sample is written to, for read heads that don't follow the write position (reverse, octave) */
+    inline size_t GetWritePosition() const { return write_pos_; }
+
+    /** Reads at an absolute buffer position, wraps around the buffer */
+    inline T ReadPosition(size_t position) const { return Storage::Decode(buffer_[position & mask_]); }
+
+    /** Reads between an absolute buffer position and the one before it using the interpolation policy */
+    inline T ReadPositionInterpolated(size_t position, float frac) { return interpolation_.Read(*this, position, frac); }
+
+    /** Wraps a position into the buffer */
+    inline size_t Wrap(size_t position) const { return position & mask_; }
+
+  private:
+    inline void SplitDelay(float delay, size_t &integral, float &fractional) const {
+        if (delay < 0.0f) {
+            delay = 0.0f;
+        }
+        integral = static_cast<size_t>(delay);
+        fractional = delay - static_cast<float>(integral);
+        if (integral > mask_) {
+            integral = mask_;
+            fractional = 0.0f;
+        }
+    }
+
+    Stored *buffer_;
+    size_t mask_;
+    size_t write_pos_;
+    Interpolation interpolation_;
+    Storage storage_;
+};
+
+/** MaskedDelayLine that holds its own buffer, declare it COLD_SDRAM (see memory_placement.h) for long delays
+    \tparam T sample type
+    \tparam capacity buffer size in samples, must be a power of two (see NextPowerOfTwo)
+    \tparam Interpolation one of the interpolation policies
+    \tparam Storage one of the storage policies
+*/
+template <typename T, size_t capacity, typename Interpolation = LinearInterpolation, typename Storage = NativeStorage<T>>
+class StaticMaskedDelayLine : public MaskedDelayLine<T, Interpolation, Storage> {
+    static_assert(capacity != 0 && (capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+  public:
+    /** Initializes the delay line and clears it */
+    void Init() { MaskedDelayLine<T, Interpolation, Storage>::Init(memory_, capacity); }
+
+  private:
+    typename Storage::Stored memory_[capacity];
+};
+
+} // namespace bkshepherd
+
+#endif
@@ -0,0 +1,137 @@
+#pragma once
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace bkshepherd {
+
+/** A simple bump allocator over a fixed block of memory (typically a COLD_SDRAM array, see memory_placement.h).
+ *
+ * Allocations can't be freed individually, instead the arena is reset back to a marker (or fully) which releases everything
+ * allocated after it. The arena keeps track of its high water mark and of any allocation that didn't fit so that the owner
+ * can report it instead of silently running out of memory.
+ */
+class MemoryArena {
+  public:
+    static constexpr size_t DefaultAlignment = 8;
+
+    /** Size an allocation takes from the arena including the padding up to the next allocation, for sizing arenas at compile
+        time. Only exact for alignments up to the given one.
+        \param size Size of the allocation in bytes.
+        \param alignment Alignment the allocations are made with.
+        \return Size in bytes
+    */
+    static constexpr size_t AlignedSize(size_t size, size_t alignment = DefaultAlignment) {
+        return (size + alignment - 1) & ~(alignment - 1);
+    }
+
+    MemoryArena() : m_buffer(nullptr), m_size(0), m_used(0), m_highWaterMark(0), m_failedCount(0), m_largestFailedSize(0) {}
+
+    /** Initializes the arena to allocate from the given memory, this also resets the arena.
+        \param buffer Memory to allocate from.
+        \param size Size of the memory in bytes.
+    */
+    void Init(void *buffer, size_t size) {
+        m_buffer = static_cast<uint8_t *>(buffer);
+        m_size = size;
+        m_used = 0;
+        m_highWaterMark = 0;
+        ClearFailures();
+    }
+
+    /** Allocates memory from the arena.
+        \param size Number of bytes to allocate.
+        \param alignment Alignment of the returned memory, must be a power of 2.
+        \return Pointer to the memory or nullptr if it doesn't fit. Failures are recorded, see GetFailedCount().
+    */
+    void *Allocate(size_t size, size_t alignment = DefaultAlignment) {
+        const size_t start = (m_used + alignment - 1) & ~(alignment - 1);
+
+        if (m_buffer == nullptr || start > m_size || size > m_size - start) {
+            m_failedCount++;
+            if (size > m_largestFailedSize) {
+                m_largestFailedSize = size;
+            }
+            return nullptr;
+        }
+
+        m_used = start + size;
+        if (m_used > m_highWaterMark) {
+            m_highWaterMark = m_used;
+        }
+
+        return m_buffer + start;
+    }
+
+    /** Allocates and default constructs an object in the arena. The arena never calls destructors, so this is meant for types
+        that don't need one (delay lines, filters, plain buffers).
+        \return Pointer to the object or nullptr if it doesn't fit.
+    */
+    template <typename T> T *New() {
+        void *memory = Allocate(sizeof(T), alignof(T) > DefaultAlignment ? alignof(T) : DefaultAlignment);
+        return memory != nullptr ? new (memory) T : nullptr;
+    }
+
+    /** Allocates and default constructs an array of objects in the arena, see New().
+        \param count Number of objects.
+        \return Pointer to the first object or nullptr if they don't fit.
+    */
+    template <typename T> T *NewArray(size_t count) {
+        void *memory = Allocate(sizeof(T) * count, alignof(T) > DefaultAlignment ? alignof(T) : DefaultAlignment);
+        if (memory == nullptr) {
+            return nullptr;
+        }
+
+        T *objects = static_cast<T *>(memory);
+        for (size_t i = 0; i < count; i++) {
+            new (objects + i) T;
+        }
+        return objects;
+    }
+
+    /** Gets a marker for the current state of the arena, everything allocated after this can be released with ResetToMarker.
+        \return The marker
+    */
+    size_t GetMarker() const { return m_used; }
+
+    /** Releases everything allocated after the marker was taken. Objects living in that memory must be destroyed before this
+        \param marker A marker from GetMarker()
+    */
+    void ResetToMarker(size_t marker) {
+        if (marker < m_used) {
+            m_used = marker;
+        }
+    }
+
+    /** Releases everything allocated from the arena. Objects living in the arena must be destroyed before this */
+    void Reset() { m_used = 0; }
+
+    /** Clears the recorded allocation failures */
+    void ClearFailures() {
+        m_failedCount = 0;
+        m_largestFailedSize = 0;
+    }
+
+    size_t GetSize() const { return m_size; }
+    size_t GetUsed() const { return m_used; }
+    size_t GetFree() const { return m_size - m_used; }
+    size_t GetHighWaterMark() const { return m_highWaterMark; }
+    uint32_t GetFailedCount() const { return m_failedCount; }
+    size_t GetLargestFailedSize() const { return m_largestFailedSize; }
+    bool HasFailed() const { return m_failedCount > 0; }
+
+  private:
+    uint8_t *m_buffer;
+    size_t m_size;
+    size_t m_used;
+    size_t m_highWaterMark;
+    uint32_t m_failedCount;
+    size_t m_largestFailedSize;
+};
+
+} // namespace bkshepherd
+
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+#ifndef MEMORY_PLACEMENT_H
+#define MEMORY_PLACEMENT_H
+
+/** @file memory_placement.h
+
+    Placement attributes for statically allocated DSP data, so where a table or buffer lives is decided by how often the audio
+    path touches it instead of by where the linker happens to put it.
+
+    Memory of the Daisy Seed (STM32H750) as the firmware uses it (APP_TYPE = BOOT_SRAM):
+
+    | Attribute   | Region                  | Size   | Access from the M7 core         | Use for                                    |
+    |-------------|-------------------------|--------|---------------------------------|--------------------------------------------|
+    | HOT_DTCM    | DTCM                    | 128KB  | zero wait state, not cached     | tables and state read every sample         |
+    | WARM_SRAM   | D2 SRAM (SRAM1-3)       | 288KB  | AHB, a few cycles, cached       | tables too big for DTCM but still hot      |
+    | COLD_SDRAM  | external SDRAM over FMC | 64MB   | tens of cycles per miss, cached | delay memory, tables used on param changes |
+
+    - Plain globals (.data / .bss) also end up in DTCM together with the stack, so HOT_DTCM is mostly about stating the intent
+      and keeping the hot data out of the way when something large has to move. Heap allocations (the effect modules are
+      created with new) are not covered by any of this.
+    - ITCM (64KB) and AXI SRAM (512KB) are left to the linker script, with BOOT_SRAM the program runs from AXI SRAM.
+    - All three sections are NOLOAD, they are neither loaded from the image nor zeroed at startup. Only use them for arrays
+      that are filled in at run time, or for objects with a constructor in DTCM / D2 SRAM. SDRAM isn't running yet when the global
+      constructors run (that is why the spectral delay's hann table "fails to load" from SDRAM), so COLD_SDRAM objects must not
+      have a constructor that writes to them.
+    - D2 SRAM is also where libDaisy keeps its DMA buffers (DMA_BUFFER_MEM_SECTION).
+
+    `ci/memory_report.sh` (run by `make memory-report` and the CI build) sums the sections of the linked firmware per region
+    and fails when the DTCM working set leaves less than the stack reserve free.
+*/
+
+#ifndef HOT_DTCM
+#define HOT_DTCM __attribute__((section(".dtcmram_bss")))
+#endif
+
+#ifndef WARM_SRAM
+#define WARM_SRAM __attribute__((section(".sram1_bss")))
+#endif
+
+#ifndef COLD_SDRAM
+#define COLD_SDRAM __attribute__((section(".sdram_bss")))
+#endif
+
+#endif
@@ -0,0 +1,266 @@
+#pragma once
+#ifndef MULTI_TAP_DELAY_H
+#define MULTI_TAP_DELAY_H
+
+#include "masked_delay_line.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace bkshepherd {
+
+/** Multi-tap delay where every tap reads the same line behind one shared write head.
+
+    The tap settings (delay and its glide, pitch, level, pan and feedback send) are kept as arrays indexed by tap and the taps
+    are processed one at a time over a whole block: the delay glide for the block is computed in one loop, the span of the line
+    the tap reads is copied into a local window in one sequential run (the line is usually in SDRAM, see StagedDelayLine), and
+    the interpolated reads are accumulated into the stereo outputs and the feedback sum. The line is written once at the end of
+    the block, so tap delays are kept above MaxBlockSize.
+
+    Only the line belongs in SDRAM, declare the delay itself HOT_DTCM (see memory_placement.h) as its scratch is read per sample.
+
+    Pitch shifted taps read with two heads whose delays ramp across PitchWindow, crossfaded with triangles (a rotating head
+    shifter), so they don't need memory of their own. Unshifted taps read with a single head and silent taps only glide.
+
+    Budget per tap and sample: the glide (2 flops) and a linear interpolation (3 flops plus the staged reads), double that and
+    the crossfade for a pitch shifted tap, plus 3 multiply-adds into the outputs and feedback.
+
+    \tparam MaxTaps number of taps
+*/
+template <size_t MaxTaps> class MultiTapDelay {
+  public:
+    /** Largest number of samples processed in one go, Process() splits longer requests */
+    static constexpr size_t MaxBlockSize = 48;
+
+    /** Shortest tap delay, the reads of a block must all be older than the samples the block writes */
+    static constexpr float MinDelay = static_cast<float>(MaxBlockSize + 1);
+
+    /** Length of the ramp the pitch shift heads sweep, in samples (about 43ms at 48kHz) */
+    static constexpr size_t PitchWindow = 2048;
+
+    /** Size of the window a head's reads are staged in, a block at twice speed plus the glide. Heads moving further than
+        this in one block (fast glides, a pitch head wrapping around) read the line directly for that block */
+    static constexpr size_t StageSize = 4 * MaxBlockSize + 64;
+
+    MultiTapDelay() : smoothing_(.0002f) {}
+
+    /** Initializes the delay and clears the line, all taps start silent
+        \param buffer Memory for the line
+        \param capacity Size of the buffer in samples, a power of two (anything else is rounded down to one)
+    */
+    void Init(float *buffer, size_t capacity) {
+        line_.Init(buffer, capacity);
+
+        for (size_t tap = 0; tap < MaxTaps; tap++) {
+            delay_[tap] = MinDelay;
+            delayTarget_[tap] = MinDelay;
+            pitchPhase_[tap] = 0.0f;
+            pitchStep_[tap] = 0.0f;
+            level_[tap] = 0.0f;
+            pan_[tap] = 0.0f;
+            gainLeft_[tap] = 0.0f;
+            gainRight_[tap] = 0.0f;
+            feedback_[tap] = 0.0f;
+        }
+    }
+
+    /** Longest delay a tap can be set to in samples, leaves room for the pitch shift window */
+    float GetMaxDelay() const { return static_cast<float>(line_.GetMaxDelay() - PitchWindow - 2); }
+
+    /** Sets the one pole coefficient the tap delays glide to their targets with, per sample */
+    void SetSmoothing(float coefficient) { smoothing_ = coefficient; }
+
+    /** Sets the delay a tap glides to
+        \param tap Tap index
+        \param samples Delay in samples, clamped to MinDelay..GetMaxDelay()
+    */
+    void SetTapDelay(size_t tap, float samples) { delayTarget_[tap] = ClampDelay(samples); }
+
+    /** Jumps a tap to its target delay without gliding */
+    void SnapTapDelay(size_t tap) { delay_[tap] = delayTarget_[tap]; }
+
+    /** Sets the transposition of a tap
+        \param tap Tap index
+        \param semitones Transposition, 0 reads the line with a single head
+    */
+    void SetTapPitch(size_t tap, float semitones) {
+        // The pitch ratio of a head is 1 minus the rate its delay changes at
+        const float ratio = powf(2.0f, semitones / 12.0f);
+        pitchStep_[tap] = semitones == 0.0f ? 0.0f : (1.0f - ratio) / static_cast<float>(PitchWindow);
+    }
+
+    /** Sets the output level of a tap, 0 silences it */
+    void SetTapLevel(size_t tap, float level) {
+        level_[tap] = level;
+        UpdateGains(tap);
+    }
+
+    /** Sets the stereo position of a tap
+        \param tap Tap index
+        \param pan -1 is left, 0 center and 1 right, constant power
+    */
+    void SetTapPan(size_t tap, float pan) {
+        pan_[tap] = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan);
+        UpdateGains(tap);
+    }
+
+    /** Sets how much of a tap is fed back into the line, the sum over all taps should stay below 1 */
+    void SetTapFeedback(size_t tap, float amount) { feedback_[tap] = amount; }
+
+    /** Processes a block of audio
+        \param in Input written to the line together with the feedback
+        \param outL Left output, the taps only (no dry signal)
+        \param outR Right output, the taps only
+        \param size Number of samples
+    */
+    void Process(const float *in, float *outL, float *outR, size_t size) {
+        while (size > 0) {
+            const size_t count = size < MaxBlockSize ? size : MaxBlockSize;
+            ProcessChunk(in, outL, outR, count);
+            in += count;
+            outL += count;
+            outR += count;
+            size -= count;
+        }
+    }
+
+  private:
+    void ProcessChunk(const float *in, float *outL, float *outR, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            outL[i] = 0.0f;
+            outR[i] = 0.0f;
+            feedbackSum_[i] = 0.0f;
+        }
+
+        for (size_t tap = 0; tap < MaxTaps; tap++) {
+            // Delay glide over the block
+            float delay = delay_[tap];
+            const float target = delayTarget_[tap];
+            for (size_t i = 0; i < count; i++) {
+                delay += smoothing_ * (target - delay);
+                delays_[i] = delay;
+            }
+            delay_[tap] = delay;
+
+            const float gainLeft = gainLeft_[tap];
+            const float gainRight = gainRight_[tap];
+            const float feedback = feedback_[tap];
+            if (gainLeft == 0.0f && gainRight == 0.0f && feedback == 0.0f) {
+                continue;
+            }
+
+            if (pitchStep_[tap] == 0.0f) {
+                ReadHead(delays_, tapOut_, count);
+            } else {
+                // Two heads half a window apart, each fades out at the end of its ramp where it jumps back
+                const float step = pitchStep_[tap];
+                float phase = pitchPhase_[tap];
+                for (size_t i = 0; i < count; i++) {
+                    phase += step;
+                    phase -= floorf(phase);
+                    float phaseB = phase + 0.5f;
+                    phaseB -= phaseB >= 1.0f ? 1.0f : 0.0f;
+
+                    headDelaysA_[i] = delays_[i] + phase * static_cast<float>(PitchWindow);
+                    headDelaysB_[i] = delays_[i] + phaseB * static_cast<float>(PitchWindow);
+                    fades_[i] = 1.0f - fabsf(2.0f * phase - 1.0f);
+                }
+                pitchPhase_[tap] = phase;
+
+                ReadHead(headDelaysA_, tapOut_, count);
+                ReadHead(headDelaysB_, headOut_, count);
+                for (size_t i = 0; i < count; i++) {
+                    tapOut_[i] = headOut_[i] + (tapOut_[i] - headOut_[i]) * fades_[i];
+                }
+            }
+
+            for (size_t i = 0; i < count; i++) {
+                outL[i] += tapOut_[i] * gainLeft;
+                outR[i] += tapOut_[i] * gainRight;
+                feedbackSum_[i] += tapOut_[i] * feedback;
+            }
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            feedbackSum_[i] += in[i];
+        }
+        line_.Write(feedbackSum_, count);
+    }
+
+    // Interpolated reads of one head for the block, delays are relative to each sample of the block
+    void ReadHead(const float *delays, float *out, size_t count) {
+        // Read offsets from the write position at the start of the block, the head covers lowest - 1 (the older
+        // interpolation neighbour) to highest
+        int32_t lowest = INT32_MAX;
+        int32_t highest = INT32_MIN;
+        for (size_t i = 0; i < count; i++) {
+            const int32_t integral = static_cast<int32_t>(delays[i]);
+            offsets_[i] = static_cast<int32_t>(i) - integral;
+            fracs_[i] = delays[i] - static_cast<float>(integral);
+            lowest = offsets_[i] < lowest ? offsets_[i] : lowest;
+            highest = offsets_[i] > highest ? offsets_[i] : highest;
+        }
+
+        const size_t write = line_.GetWritePosition();
+        const int32_t first = lowest - 1;
+        const size_t span = static_cast<size_t>(highest - first) + 1;
+
+        if (span <= StageSize) {
+            // One sequential run out of the line
+            for (size_t j = 0; j < span; j++) {
+                stage_[j] = line_.ReadPosition(write + first + j);
+            }
+            for (size_t i = 0; i < count; i++) {
+                const float *sample = stage_ + (offsets_[i] - first);
+                out[i] = sample[0] + (sample[-1] - sample[0]) * fracs_[i];
+            }
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                const float a = line_.ReadPosition(write + offsets_[i]);
+                const float b = line_.ReadPosition(write + offsets_[i] - 1);
+                out[i] = a + (b - a) * fracs_[i];
+            }
+        }
+    }
+
+    float ClampDelay(float samples) const {
+        const float longest = GetMaxDelay();
+        return samples < MinDelay ? MinDelay : (samples > longest ? longest : samples);
+    }
+
+    void UpdateGains(size_t tap) {
+        const float angle = (pan_[tap] + 1.0f) * static_cast<float>(M_PI) * 0.25f;
+        gainLeft_[tap] = level_[tap] * cosf(angle);
+        gainRight_[tap] = level_[tap] * sinf(angle);
+    }
+
+    MaskedDelayLine<float> line_;
+    float smoothing_;
+
+    // Per tap settings and state
+    float delay_[MaxTaps];
+    float delayTarget_[MaxTaps];
+    float pitchPhase_[MaxTaps];
+    float pitchStep_[MaxTaps];
+    float level_[MaxTaps];
+    float pan_[MaxTaps];
+    float gainLeft_[MaxTaps];
+    float gainRight_[MaxTaps];
+    float feedback_[MaxTaps];
+
+    // Scratch for one block
+    float delays_[MaxBlockSize];
+    float headDelaysA_[MaxBlockSize];
+    float headDelaysB_[MaxBlockSize];
+    float fades_[MaxBlockSize];
+    int32_t offsets_[MaxBlockSize];
+    float fracs_[MaxBlockSize];
+    float tapOut_[MaxBlockSize];
+    float headOut_[MaxBlockSize];
+    float feedbackSum_[MaxBlockSize];
+    float stage_[StageSize];
+};
+
+} // namespace bkshepherd
+
+#endif
@@ -8,12 +8,9 @@
 #include <stdint.h>
 
 #include <cmath>
-#ifdef USE_ARM_DSP
-#include "arm_math.h"
-#endif
+
 #include "RuntimeDelayLine.h"
 #include "Utility/dsp.h"
-#include "phasor.h"
 
 using namespace daisysp;
 
@@ -48,6 +45,12 @@ where:
 solving for t = 12.0
 f = (12 - 1) * 48000 / delaySize;
 
+The two crossfade ramps are kept here as 0-1 phases and the crossfade gains
+(half a sine over a ramp) come from a table, so a sample costs no sinf. The
+random modulation of the "fun" parameter is only drawn where a ramp wraps, or
+when transposing by less than a quarter tone, after a random count of samples.
+Process() with a block runs the same steps as the sample version in one loop.
+
 \todo - move hash_xs32 and myrand to dsp.h and give appropriate names
 */
 class PitchShifter {
@@ -59,7 +62,8 @@ class PitchShifter {
      *  \param sr the expected samplerate in Hz of the audio engines
      *  \param bufferA the buffer to use for the first delay line
      *  \param bufferB the buffer to use for the second delay line
-     *  \param buffer_size the size of the delay line buffers
+     *  \param buffer_size the maximum delay size, the buffers have to hold
+     * bkshepherd::NextPowerOfTwo(buffer_size) samples
      *  \param quantize_semitones locks transpositions to integer values (defaults
      * to false)
      */
@@ -67,14 +71,25 @@ class PitchShifter {
         force_recalc_ = false;
         sr_ = sr;
         mod_freq_ = 5.0f;
+        transpose_ = 0.0f;
 
         d_[0].Init(bufferA, buffer_size);
         d_[1].Init(bufferB, buffer_size);
 
+        // Half a sine, with a guard entry for a ramp that rounds up to 1
+        for (size_t i = 0; i <= kGainTableSize; i++) {
+            gain_table_[i] = sinf(PI_F * i / kGainTableSize);
+        }
+        gain_table_[kGainTableSize + 1] = 0.0f;
+
         for (uint8_t i = 0; i < 2; i++) {
-            gain_[i] = 0.0f;
-            phs_[i].Init(sr, 50, i == 0 ? 0 : PI_F);
+            ramp_[i] = i == 0 ? 0.0f : 0.5f;
+            mod_amt_[i] = 0.0f;
+            slewed_mod_[i] = 0.0f;
+            mod_coeff_[i] = 0.0002f;
         }
+        ramp_inc_ = 50.0f / sr;
+        retrig_countdown_ = kMaxRetrigSamples;
 
         buffer_size_ = buffer_size;
         del_size_ = buffer_size;
@@ -85,57 +100,49 @@ class PitchShifter {
 
     /** process pitch shifter
      */
-    float Process(float in) {
-        float val, fade1, fade2;
-        // First Process delay mod/crossfade
-        fade1 = phs_[0].Process();
-        fade2 = phs_[1].Process();
-        bool recalc_a_fun = ((transpose_ >= 0.f) && (prev_phs_a_ > fade1)) || ((transpose_ < 0.f) && prev_phs_a_ < fade1);
-        bool recalc_b_fun = ((transpose_ >= 0.f) && (prev_phs_b_ > fade2)) || ((transpose_ < 0.f) && prev_phs_b_ < fade2);
+    inline float Process(float in) {
+        // Ramps from 1 down to 0 (the delay of the tap shrinks) when shifting up, the other way shifting down. A tap is
+        // silent where its ramp wraps, so that's where its modulation changes
+        for (uint8_t i = 0; i < 2; i++) {
+            float ramp = ramp_[i] - ramp_inc_;
+            if (ramp < 0.0f || ramp >= 1.0f) {
+                ramp -= floorf(ramp);
+                RecalcFun(i);
+            }
+            ramp_[i] = ramp;
+        }
+
         // Randomly trigger mod recalc when tranpose is 0 so that the "fun"
         // parameter still does something when not transposing
-        bool rand_retrig = (transpose_ >= -0.25f && transpose_ < 0.25f);
-        if (rand_retrig && fun_ > 0.f)
-            if (myrand() % 65536 < 4)
-                recalc_a_fun = recalc_b_fun = true;
-        if (recalc_a_fun) {
-            mod_a_amt_ = fun_ * ((float)(myrand() % 255) / 255.0f) * (del_size_ * 0.5f);
-            mod_coeff_[0] = 0.0002f + (((float)(myrand() % 255) / 255.0f) * 0.001f);
-        }
-        if (recalc_b_fun) {
-            mod_b_amt_ = fun_ * ((float)(myrand() % 255) / 255.0f) * (del_size_ * 0.5f);
-            mod_coeff_[1] = 0.0002f + (((float)(myrand() % 255) / 255.0f) * 0.001f);
+        if (fun_ > 0.f && transpose_ >= -0.25f && transpose_ < 0.25f && --retrig_countdown_ == 0) {
+            retrig_countdown_ = 1 + myrand() % kMaxRetrigSamples;
+            RecalcFun(0);
+            RecalcFun(1);
         }
-        slewed_mod_[0] += mod_coeff_[0] * (mod_a_amt_ - slewed_mod_[0]);
-        slewed_mod_[1] += mod_coeff_[1] * (mod_b_amt_ - slewed_mod_[1]);
-        prev_phs_a_ = fade1;
-        prev_phs_b_ = fade2;
-        fade1 = 1.0f - fade1;
-        fade2 = 1.0f - fade2;
-        mod_[0] = fade1 * (del_size_ - 1);
-        mod_[1] = fade2 * (del_size_ - 1);
-#ifdef USE_ARM_DSP
-        gain_[0] = arm_sin_f32(fade1 * (float)M_PI);
-        gain_[1] = arm_sin_f32(fade2 * (float)M_PI);
-#else
-        gain_[0] = sinf(fade1 * PI_F);
-        gain_[1] = sinf(fade2 * PI_F);
-#endif
 
         // Handle Delay Writing
         d_[0].Write(in);
         d_[1].Write(in);
-        // Modulate Delay Lines
-        // d_[0].SetDelay(mod_[0] + mod_a_amt_);
-        // d_[1].SetDelay(mod_[1] + mod_b_amt_);
-        d_[0].SetDelay(mod_[0] + slewed_mod_[0]);
-        d_[1].SetDelay(mod_[1] + slewed_mod_[1]);
-        val = 0.0f;
-        val += (d_[0].Read() * gain_[0]);
-        val += (d_[1].Read() * gain_[1]);
+
+        float val = 0.0f;
+        for (uint8_t i = 0; i < 2; i++) {
+            slewed_mod_[i] += mod_coeff_[i] * (mod_amt_[i] - slewed_mod_[i]);
+
+            // Modulate Delay Lines
+            d_[i].SetDelay(ramp_[i] * (del_size_ - 1) + slewed_mod_[i]);
+            val += d_[i].Read() * Gain(ramp_[i]);
+        }
         return val;
     }
 
+    /** process a block, in and out can be the same buffer
+     */
+    void Process(const float *in, float *out, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            out[i] = Process(in[i]);
+        }
+    }
+
     /** sets transposition in semitones
      */
     void SetTransposition(const float &transpose) {
@@ -144,8 +151,7 @@ class PitchShifter {
             transpose_ = quantize_semitones_ ? (int32_t)transpose : transpose;
             ratio = pow(2.f, transpose_ / 12.f);
             mod_freq_ = ((ratio - 1.0f) * sr_) / del_size_;
-            phs_[0].SetFreq(mod_freq_);
-            phs_[1].SetFreq(mod_freq_);
+            ramp_inc_ = mod_freq_ / sr_;
             if (force_recalc_) {
                 force_recalc_ = false;
             }
@@ -167,16 +173,44 @@ class PitchShifter {
 
   private:
     typedef daisysp_modified::DelayLine<float> ShiftDelay;
+
+    static constexpr size_t kGainTableSize = 256;
+
+    /** The random retrigger comes every 16384 samples on average, like one
+     * chance in 16384 per sample
+     */
+    static constexpr uint32_t kMaxRetrigSamples = 32768;
+
+    /** crossfade gain of a tap, sin(ramp * pi) from the table
+     */
+    inline float Gain(float ramp) const {
+        const float position = ramp * kGainTableSize;
+        const size_t index = static_cast<size_t>(position);
+        const float frac = position - index;
+        return gain_table_[index] + frac * (gain_table_[index + 1] - gain_table_[index]);
+    }
+
+    inline void RecalcFun(uint8_t i) {
+        if (fun_ > 0.f) {
+            mod_amt_[i] = fun_ * ((float)(myrand() % 255) / 255.0f) * (del_size_ * 0.5f);
+            mod_coeff_[i] = 0.0002f + (((float)(myrand() % 255) / 255.0f) * 0.001f);
+        } else {
+            mod_amt_[i] = 0.0f;
+        }
+    }
+
     ShiftDelay d_[2];
-    float pitch_shift_, mod_freq_;
+    float mod_freq_;
     uint32_t del_size_;
     /** lfo stuff */
     bool force_recalc_;
     float sr_;
-    daisysp_modified::Phasor phs_[2];
-    float gain_[2], mod_[2], transpose_;
-    float fun_, mod_a_amt_, mod_b_amt_, prev_phs_a_, prev_phs_b_;
+    float ramp_[2], ramp_inc_;
+    float gain_table_[kGainTableSize + 2];
+    float transpose_;
+    float fun_, mod_amt_[2];
     float slewed_mod_[2], mod_coeff_[2];
+    uint32_t retrig_countdown_;
     uint32_t buffer_size_ = 0;
 
     /** Config stuff */
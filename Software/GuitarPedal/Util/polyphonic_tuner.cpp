@@ -0,0 +1,264 @@
+#include "polyphonic_tuner.h"
+
+#include <cmath>
+
+// Open strings in standard tuning, E2 A2 D3 G3 B3 E4
+static const uint8_t k_stringNotes[PolyphonicTuner::k_stringCount] = {40, 45, 50, 55, 59, 64};
+
+// Half the range a string is looked for in, in cents
+static const float k_searchRange = 100.0f;
+
+// Harmonics further than this from the reference harmonic of a string don't belong to it, in cents
+static const float k_agreement = 10.0f;
+
+// Magnitude a harmonic needs (the amplitude of a sine, about -54dB) and how far below the loudest string a string may be
+static const float k_levelFloor = 0.002f;
+static const float k_relativeLevel = 0.1f;
+
+// Time a string stays detected after it was last heard
+static const float k_holdTime = 2.0f;
+
+static float CentsBetween(float frequency, float reference) { return 1200.0f * log2f(frequency / reference); }
+
+static float StringPitch(size_t string) { return 440.0f * powf(2.0f, (k_stringNotes[string] - 69) / 12.0f); }
+
+PolyphonicTuner::PolyphonicTuner()
+    : m_bufferIndex(0), m_analysisSampleRate(k_analysisSampleRate), m_history(nullptr), m_workspace(nullptr), m_written(0),
+      m_analyzedAt(0), m_fft(nullptr), m_holdFrames(0) {
+    for (size_t string = 0; string < k_stringCount; string++) {
+        m_cents[string] = 0.0f;
+        m_framesSinceDetected[string] = UINT32_MAX;
+        for (size_t harmonic = 0; harmonic < k_harmonicCount; harmonic++) {
+            m_sharedHarmonic[string][harmonic] = false;
+        }
+    }
+}
+
+void PolyphonicTuner::Init(float sampleRate) {
+    // Decimate to about 6kHz (a factor of 8 at 48kHz)
+    const size_t factor = static_cast<size_t>(sampleRate / k_analysisSampleRate + 0.5f);
+    m_decimationFactor = factor < 1 ? 1 : (factor > max_resample_factor ? max_resample_factor : factor);
+    m_decimator.init(m_decimationFactor, sampleRate, k_analysisPassband);
+    m_analysisSampleRate = sampleRate / m_decimationFactor;
+    m_bufferIndex = 0;
+
+    m_holdFrames = static_cast<uint32_t>(k_holdTime * m_analysisSampleRate / k_hopSize);
+
+    for (size_t string = 0; string < k_stringCount; string++) {
+        for (size_t harmonic = 0; harmonic < k_harmonicCount; harmonic++) {
+            const float frequency = StringPitch(string) * (harmonic + 1);
+            m_sharedHarmonic[string][harmonic] = false;
+            for (size_t other = 0; other < k_stringCount; other++) {
+                for (size_t otherHarmonic = 0; other != string && otherHarmonic < k_harmonicCount; otherHarmonic++) {
+                    const float otherFrequency = StringPitch(other) * (otherHarmonic + 1);
+                    if (fabsf(CentsBetween(frequency, otherFrequency)) < k_searchRange) {
+                        m_sharedHarmonic[string][harmonic] = true;
+                    }
+                }
+            }
+        }
+    }
+
+    // The plan is shared with every other user of the size, set it up here rather than in the main loop
+    m_fft = soundmath::SharedRealFFT<float, k_frameSize>();
+}
+
+void PolyphonicTuner::SetBuffers(float *history, float *workspace) {
+    m_history = history;
+    m_workspace = workspace;
+
+    if (m_history != nullptr) {
+        for (size_t i = 0; i < k_historySize; i++) {
+            m_history[i] = 0.0f;
+        }
+    }
+
+    m_written = 0;
+    m_analyzedAt = 0;
+    for (size_t string = 0; string < k_stringCount; string++) {
+        m_framesSinceDetected[string] = UINT32_MAX;
+    }
+}
+
+void PolyphonicTuner::Process(float in) {
+    if (m_history == nullptr) {
+        return;
+    }
+
+    // Collect an analysis sample worth of input
+    m_decimationBuffer[m_bufferIndex++] = in;
+    if (m_bufferIndex < m_decimationFactor) {
+        return;
+    }
+    m_bufferIndex = 0;
+
+    const uint32_t written = m_written;
+    m_history[written % k_historySize] = m_decimator(m_decimationBuffer);
+    m_written = written + 1;
+}
+
+bool PolyphonicTuner::Update() {
+    if (m_history == nullptr || m_workspace == nullptr || m_fft == nullptr) {
+        return false;
+    }
+
+    const uint32_t written = m_written;
+    if (written - m_analyzedAt < k_hopSize) {
+        return false;
+    }
+    m_analyzedAt = written;
+
+    // Window the latest frame into the workspace, oldest sample first. The audio callback adds a few samples per block while
+    // this runs, they replace the oldest ones where the window is close to 0
+    const float step = 2.0f * 3.14159265f / k_frameSize;
+    for (size_t i = 0; i < k_frameSize; i++) {
+        const float window = 0.5f - 0.5f * cosf(step * i);
+        m_workspace[i] = m_history[(written + i) % k_historySize] * window;
+    }
+
+    AnalyzeFrame();
+    return true;
+}
+
+void PolyphonicTuner::AnalyzeFrame() {
+    // Spectrum into the second half of the workspace, magnitudes back into the first (the FFT leaves it undefined)
+    float *spectrum = m_workspace + k_frameSize;
+    m_fft->Direct(m_workspace, spectrum);
+
+    const size_t bins = k_frameSize / 2;
+    float *magnitudes = m_workspace;
+    magnitudes[0] = 0.0f;
+    for (size_t bin = 1; bin < bins; bin++) {
+        const float real = spectrum[bin];
+        const float imag = spectrum[bins + bin];
+        magnitudes[bin] = sqrtf(real * real + imag * imag);
+    }
+
+    // A Hann windowed sine of amplitude a peaks at a * N / 4
+    const float floor = k_levelFloor * k_frameSize / 4.0f;
+
+    // Fundamental estimates and magnitudes of the harmonics of every string
+    const float range = powf(2.0f, k_searchRange / 1200.0f);
+    float estimates[k_stringCount][k_harmonicCount] = {};
+    float peaks[k_stringCount][k_harmonicCount] = {};
+    for (size_t string = 0; string < k_stringCount; string++) {
+        for (size_t harmonic = 0; harmonic < k_harmonicCount; harmonic++) {
+            const float center = StringPitch(string) * (harmonic + 1);
+            float frequency;
+            if (FindPeak(magnitudes, center / range, center * range, frequency, peaks[string][harmonic])) {
+                estimates[string][harmonic] = frequency / (harmonic + 1);
+            }
+        }
+    }
+
+    // First the strings heard on harmonics of their own, then the others on the shared harmonics that none of the strings of
+    // the first pass explain
+    float frequencies[k_stringCount] = {};
+    float levels[k_stringCount] = {};
+    float loudest = 0.0f;
+    for (int pass = 0; pass < 2; pass++) {
+        const bool shared = pass == 1;
+        for (size_t string = 0; string < k_stringCount; string++) {
+            if (levels[string] > 0.0f) {
+                continue;
+            }
+
+            bool usable[k_harmonicCount];
+            for (size_t harmonic = 0; harmonic < k_harmonicCount; harmonic++) {
+                usable[harmonic] = m_sharedHarmonic[string][harmonic] == shared && peaks[string][harmonic] >= floor &&
+                                   !(shared && IsExplained(estimates[string][harmonic] * (harmonic + 1), frequencies));
+            }
+
+            const size_t reference = ReferenceHarmonic(peaks[string], usable);
+            if (reference == k_harmonicCount) {
+                continue;
+            }
+
+            // Average the harmonics that agree with the reference, weighted by their magnitude
+            float weightedSum = 0.0f;
+            for (size_t harmonic = 0; harmonic < k_harmonicCount; harmonic++) {
+                const float estimate = estimates[string][harmonic];
+                if (usable[harmonic] && fabsf(CentsBetween(estimate, estimates[string][reference])) < k_agreement) {
+                    weightedSum += estimate * peaks[string][harmonic];
+                    levels[string] += peaks[string][harmonic];
+                }
+            }
+
+            frequencies[string] = weightedSum / levels[string];
+            loudest = levels[string] > loudest ? levels[string] : loudest;
+        }
+    }
+
+    for (size_t string = 0; string < k_stringCount; string++) {
+        if (levels[string] > 0.0f && levels[string] >= loudest * k_relativeLevel) {
+            m_cents[string] = CentsBetween(frequencies[string], StringPitch(string));
+            m_framesSinceDetected[string] = 0;
+        } else if (m_framesSinceDetected[string] != UINT32_MAX) {
+            m_framesSinceDetected[string]++;
+        }
+    }
+}
+
+size_t PolyphonicTuner::ReferenceHarmonic(const float *peaks, const bool *usable) const {
+    // Harmonic h has to be h times as loud as the lower ones to be taken over them, lower harmonics are less likely to belong
+    // to a louder note with a partial nearby
+    size_t reference = k_harmonicCount;
+    float best = 0.0f;
+    for (size_t harmonic = 0; harmonic < k_harmonicCount; harmonic++) {
+        const float weight = peaks[harmonic] / (harmonic + 1);
+        if (usable[harmonic] && weight > best) {
+            best = weight;
+            reference = harmonic;
+        }
+    }
+    return reference;
+}
+
+bool PolyphonicTuner::IsExplained(float frequency, const float *frequencies) const {
+    for (size_t string = 0; string < k_stringCount; string++) {
+        for (size_t harmonic = 0; frequencies[string] > 0.0f && harmonic < k_harmonicCount; harmonic++) {
+            if (fabsf(CentsBetween(frequency, frequencies[string] * (harmonic + 1))) < k_agreement) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool PolyphonicTuner::FindPeak(const float *magnitudes, float lowFrequency, float highFrequency, float &frequency,
+                               float &magnitude) const {
+    const float binWidth = m_analysisSampleRate / k_frameSize;
+    const size_t low = static_cast<size_t>(lowFrequency / binWidth) + 1;
+    const size_t high = static_cast<size_t>(highFrequency / binWidth);
+    if (high + 1 >= k_frameSize / 2 || low >= high) {
+        return false;
+    }
+
+    size_t peak = low;
+    for (size_t bin = low + 1; bin <= high; bin++) {
+        if (magnitudes[bin] > magnitudes[peak]) {
+            peak = bin;
+        }
+    }
+
+    // A peak at the edge of the range is the slope of one outside of it
+    if (magnitudes[peak - 1] >= magnitudes[peak] || magnitudes[peak + 1] >= magnitudes[peak]) {
+        return false;
+    }
+
+    // A parabola through the log magnitudes, close to exact for the Hann window's main lobe
+    const float left = logf(magnitudes[peak - 1] + 1e-9f);
+    const float center = logf(magnitudes[peak] + 1e-9f);
+    const float right = logf(magnitudes[peak + 1] + 1e-9f);
+    const float offset = 0.5f * (left - right) / (left - 2.0f * center + right);
+
+    frequency = (peak + offset) * binWidth;
+    magnitude = magnitudes[peak];
+    return true;
+}
+
+uint8_t PolyphonicTuner::GetStringNote(size_t string) const { return k_stringNotes[string]; }
+
+bool PolyphonicTuner::IsStringDetected(size_t string) const { return m_framesSinceDetected[string] <= m_holdFrames; }
+
+float PolyphonicTuner::GetStringCents(size_t string) const { return m_cents[string]; }
@@ -0,0 +1,95 @@
+#pragma once
+#ifndef POLYPHONIC_TUNER_H
+#define POLYPHONIC_TUNER_H
+#include <cstddef>
+#include <cstdint>
+
+#include "Multirate.h"
+#include "STFT/real_fft.h"
+
+// Tunes the six strings of a guitar in standard tuning from one strum of the open strings.
+//
+// The audio side only decimates the input to about 6kHz into a history ring, which costs a few multiply-adds per sample. The
+// analysis runs from the main loop (Update()) at a low hop rate: every 1024 decimated samples (about 6 times a second) the
+// latest 4096 samples are windowed and transformed with the shared real FFT. Every string then looks for the peaks of its
+// first harmonics within a semitone of its pitch, interpolates them and averages the ones that agree into the string's
+// frequency. With 1.5Hz bins and the harmonics the estimates are within a few cents.
+//
+// Harmonics of the low strings also land on higher strings (the 3rd harmonic of the low E is the B, the 4th the high E). Those
+// shared harmonics are only used for a string when none of its own are heard, and only if they aren't harmonics of a string
+// that was heard. Strings that aren't played can still show a partial of another one that is far out of tune, so it's meant
+// for strumming all six.
+class PolyphonicTuner {
+  public:
+    static constexpr size_t k_stringCount = 6;
+    static constexpr size_t k_frameSize = 4096;
+
+    // Buffers SetBuffers() takes, in floats
+    static constexpr size_t k_historySize = k_frameSize;
+    static constexpr size_t k_workspaceSize = 2 * k_frameSize;
+
+    PolyphonicTuner();
+    void Init(float sampleRate);
+
+    // Sets the buffers (k_historySize and k_workspaceSize floats), nullptr for both stops the tuner
+    void SetBuffers(float *history, float *workspace);
+
+    // Called from the audio callback
+    void Process(float in);
+
+    // Called from the main loop, analyzes the latest frame if a new hop is in. Returns true if the strings were updated
+    bool Update();
+
+    // Midi note of an open string, 0 is the low E
+    uint8_t GetStringNote(size_t string) const;
+
+    // Whether the string was heard in the last 2 seconds and its deviation from the note in cents at the last detection
+    bool IsStringDetected(size_t string) const;
+    float GetStringCents(size_t string) const;
+
+  private:
+    // Rate the analysis runs at
+    static constexpr float k_analysisSampleRate = 6000.0f;
+
+    // Highest frequency kept by the decimation filter, the 4th harmonic of the high E a semitone sharp
+    static constexpr float k_analysisPassband = 1400.0f;
+
+    static constexpr size_t k_hopSize = k_frameSize / 4;
+    static constexpr size_t k_harmonicCount = 4;
+
+    // Analyzes the frame in the workspace
+    void AnalyzeFrame();
+
+    // Harmonic of a string the estimate is based on, out of the usable ones. k_harmonicCount if none is usable
+    size_t ReferenceHarmonic(const float *peaks, const bool *usable) const;
+
+    // Whether a frequency is a harmonic of one of the strings detected so far (those with a frequency other than 0)
+    bool IsExplained(float frequency, const float *frequencies) const;
+
+    // Finds the peak of one harmonic of a string, false if there's none inside the range
+    bool FindPeak(const float *magnitudes, float lowFrequency, float highFrequency, float &frequency, float &magnitude) const;
+
+    // Decimation to the analysis rate, m_decimationFactor input samples per analysis sample
+    PolyphaseDecimator m_decimator;
+    size_t m_decimationFactor = 1;
+    float m_decimationBuffer[max_resample_factor];
+    size_t m_bufferIndex;
+    float m_analysisSampleRate;
+
+    // Decimated input written by the audio callback, m_written counts the samples and is the only state shared with Update()
+    float *m_history;
+    float *m_workspace;
+    volatile uint32_t m_written;
+    uint32_t m_analyzedAt;
+
+    soundmath::RealFFT<float, k_frameSize> *m_fft;
+
+    // Harmonics that fall within the search range of a harmonic of another string
+    bool m_sharedHarmonic[k_stringCount][k_harmonicCount];
+
+    // Results per string, the frames since each string was last detected
+    float m_cents[k_stringCount];
+    uint32_t m_framesSinceDetected[k_stringCount];
+    uint32_t m_holdFrames;
+};
+#endif
@@ -0,0 +1,162 @@
+#pragma once
+#ifndef PSOLA_SHIFTER_H
+#define PSOLA_SHIFTER_H
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmath>
+
+#include "masked_delay_line.h"
+
+namespace bkshepherd {
+
+/** Pitch synchronous overlap-add (PSOLA) pitch shifter.
+
+    The input is cut into grains two periods long, starting on marks one period apart, and the grains are added back one
+    period divided by the pitch ratio apart. The waveform of each period is kept, only its repetition rate changes, so there
+    is none of the beating of the delay line shifter and the latency is at most one period (12ms for a low E, 1.5ms for a
+    high E at the 12th fret) instead of the length of its delay sweep.
+
+    The period comes from a pitch detector (SetFrequency()). Without one, or for chords, it shifts at the last period it was
+    given, which is rough for anything but single notes.
+
+    Every grain reads the input at a fixed delay, the delay of the latest analysis mark when it starts, so it reads its two
+    periods as they are written and no absolute positions are needed. The window is a Hann table shared by the grains.
+*/
+class PsolaShifter {
+  public:
+    /** Grains that can sound at once, 4 overlap for an octave up */
+    static constexpr size_t MaxGrains = 6;
+
+    PsolaShifter() {}
+    ~PsolaShifter() {}
+
+    /** Initializes the shifter and clears the input
+        \param sample_rate Engine sample rate in Hz
+        \param buffer Memory for the input, capacity samples
+        \param capacity Size of the buffer, a power of two. Periods up to a quarter of it are followed.
+    */
+    void Init(float sample_rate, float *buffer, size_t capacity) {
+        sample_rate_ = sample_rate;
+        line_.Init(buffer, capacity);
+        max_period_ = static_cast<float>(line_.GetCapacity() / 4);
+        min_period_ = sample_rate / k_maxFrequency;
+
+        for (size_t i = 0; i <= k_windowSize; i++) {
+            window_[i] = 0.5f - 0.5f * cosf(2.0f * static_cast<float>(M_PI) * i / k_windowSize);
+        }
+
+        for (size_t i = 0; i < MaxGrains; i++) {
+            grains_[i].active = false;
+        }
+
+        frequency_ = 0.0f;
+        SetPeriod(sample_rate / k_defaultFrequency);
+        mark_delay_ = 1.0f;
+        countdown_ = 0.0f;
+    }
+
+    /** Sets the pitch change in semitones, the ratio is only recomputed when it changes */
+    void SetTransposition(float semitones) {
+        if (semitones != transposition_) {
+            transposition_ = semitones;
+            ratio_ = powf(2.0f, semitones / 12.0f);
+
+            // Grains further apart than a period leave gaps, made up for on the level (within a dB or two on harmonic tones).
+            // Closer together they overlap out of phase and keep about the level of the input
+            gain_ = ratio_ < 1.0f ? 1.0f / sqrtf(ratio_) : 1.0f;
+        }
+    }
+
+    /** Sets the pitch of the input in Hz, 0 (no pitch detected) keeps the last one */
+    void SetFrequency(float frequency) {
+        if (frequency > 0.0f && frequency != frequency_) {
+            frequency_ = frequency;
+            SetPeriod(sample_rate_ / frequency);
+        }
+    }
+
+    float Process(float in) {
+        line_.Write(in);
+
+        // Move to the latest analysis mark, at least a sample back so the interpolated read stays on written input
+        mark_delay_ += 1.0f;
+        while (mark_delay_ >= period_ + 1.0f) {
+            mark_delay_ -= period_;
+        }
+
+        // Start a grain on the current mark every period / ratio
+        countdown_ -= 1.0f;
+        if (countdown_ <= 0.0f) {
+            StartGrain();
+            countdown_ += period_ / ratio_;
+        }
+
+        float out = 0.0f;
+        for (size_t i = 0; i < MaxGrains; i++) {
+            Grain &grain = grains_[i];
+            if (!grain.active) {
+                continue;
+            }
+
+            const float position = grain.phase * grain.window_step;
+            const size_t index = static_cast<size_t>(position);
+            const float frac = position - index;
+            const float window = window_[index] + frac * (window_[index + 1] - window_[index]);
+            out += line_.ReadInterpolated(grain.delay) * window;
+
+            grain.phase += 1.0f;
+            grain.active = grain.phase < grain.length;
+        }
+
+        return out * gain_;
+    }
+
+  private:
+    static constexpr size_t k_windowSize = 256;
+    static constexpr float k_defaultFrequency = 200.0f;
+    static constexpr float k_maxFrequency = 1500.0f;
+
+    struct Grain {
+        bool active;
+        float delay;       // of the input read by the grain, constant while it plays
+        float phase;       // samples played
+        float length;      // two periods
+        float window_step; // table entries per sample
+    };
+
+    void SetPeriod(float period) {
+        period_ = period < min_period_ ? min_period_ : (period > max_period_ ? max_period_ : period);
+    }
+
+    void StartGrain() {
+        for (size_t i = 0; i < MaxGrains; i++) {
+            Grain &grain = grains_[i];
+            if (!grain.active) {
+                grain.active = true;
+                grain.delay = mark_delay_;
+                grain.phase = 0.0f;
+                grain.length = 2.0f * period_;
+                grain.window_step = k_windowSize / grain.length;
+                return;
+            }
+        }
+    }
+
+    MaskedDelayLine<float> line_;
+    Grain grains_[MaxGrains];
+    float window_[k_windowSize + 1];
+
+    float sample_rate_ = 48000.0f;
+    float frequency_ = 0.0f;
+    float period_ = 240.0f;
+    float min_period_ = 32.0f;
+    float max_period_ = 240.0f;
+    float mark_delay_ = 1.0f;   // of the latest analysis mark, between one sample and one period plus one
+    float countdown_ = 0.0f;    // to the next grain
+    float ratio_ = 1.0f;
+    float gain_ = 1.0f;
+    float transposition_ = 0.0f;
+};
+} // namespace bkshepherd
+#endif
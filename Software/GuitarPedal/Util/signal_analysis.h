@@ -0,0 +1,26 @@
+#pragma once
+#ifndef SIGNAL_ANALYSIS_H
+#define SIGNAL_ANALYSIS_H
+
+#include <stdint.h>
+
+namespace bkshepherd {
+
+/** Features of the input published once per audio block, before the active effect processes the block (see SignalAnalyzer).
+ *
+ * Effects read it with BaseEffectModule::GetSignalAnalysis() instead of running their own envelope followers or detectors on
+ * the input. All values describe the input of the block being processed, the envelopes are those at its end.
+ */
+struct SignalAnalysis {
+    float rms;           // RMS of the block
+    float peak;          // Largest magnitude in the block
+    float envelope;      // Peak envelope, fast attack and 50ms release
+    float rmsEnvelope;   // RMS smoothed over about 100ms
+    bool onset;          // A note or strum started in this block
+    uint32_t onsetCount; // Onsets since startup, for readers that don't look at every block
+    float frequency;     // Detected pitch in Hz, 0 if nothing was detected or pitch detection isn't running
+    uint32_t blockCount; // Blocks analyzed since startup
+};
+
+} // namespace bkshepherd
+#endif
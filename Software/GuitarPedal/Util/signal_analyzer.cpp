@@ -0,0 +1,94 @@
+#include "signal_analyzer.h"
+
+#include <math.h>
+
+using namespace bkshepherd;
+
+// Release of the peak envelope and time the RMS envelope is smoothed over
+static const float k_envelopeReleaseTime = 0.05f;
+static const float k_rmsSmoothingTime = 0.1f;
+
+// Rise of the block RMS over the RMS envelope that counts as an onset (9dB) and the level it has to reach (-50dBFS)
+static const float k_onsetRatio = 2.82f;
+static const float k_onsetFloor = 0.00316f;
+
+// Shortest time between onsets, so the strings of one strum are one onset
+static const float k_onsetHoldTime = 0.06f;
+
+SignalAnalyzer::SignalAnalyzer()
+    : m_sampleRate(48000.0f), m_envelopeRelease(0.0f), m_rmsSmoothing(0.0f), m_samplesTilNextOnset(0), m_onsetHoldSamples(0),
+      m_pitchEnabled(false) {
+    m_analysis.rms = 0.0f;
+    m_analysis.peak = 0.0f;
+    m_analysis.envelope = 0.0f;
+    m_analysis.rmsEnvelope = 0.0f;
+    m_analysis.onset = false;
+    m_analysis.onsetCount = 0;
+    m_analysis.frequency = 0.0f;
+    m_analysis.blockCount = 0;
+}
+
+void SignalAnalyzer::Init(float sampleRate) {
+    m_sampleRate = sampleRate;
+
+    // One pole coefficients per sample
+    m_envelopeRelease = expf(-1.0f / (k_envelopeReleaseTime * sampleRate));
+    m_rmsSmoothing = 1.0f - expf(-1.0f / (k_rmsSmoothingTime * sampleRate));
+
+    m_onsetHoldSamples = static_cast<int>(k_onsetHoldTime * sampleRate);
+    m_samplesTilNextOnset = 0;
+
+    m_frequencyDetector.Init(sampleRate);
+}
+
+void SignalAnalyzer::SetPitchEnabled(bool enabled) { m_pitchEnabled = enabled; }
+
+void SignalAnalyzer::ProcessBlock(const float *in, size_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    float sumOfSquares = 0.0f;
+    float peak = 0.0f;
+    float envelope = m_analysis.envelope;
+
+    // The RMS envelope is kept squared, the published one is its root
+    float meanSquare = m_analysis.rmsEnvelope * m_analysis.rmsEnvelope;
+    const float previousRmsEnvelope = m_analysis.rmsEnvelope;
+
+    for (size_t i = 0; i < size; i++) {
+        const float square = in[i] * in[i];
+        const float magnitude = fabsf(in[i]);
+
+        sumOfSquares += square;
+        peak = magnitude > peak ? magnitude : peak;
+        envelope = magnitude > envelope ? magnitude : envelope * m_envelopeRelease;
+        meanSquare += m_rmsSmoothing * (square - meanSquare);
+    }
+
+    m_analysis.rms = sqrtf(sumOfSquares / size);
+    m_analysis.peak = peak;
+    m_analysis.envelope = envelope;
+    m_analysis.rmsEnvelope = sqrtf(meanSquare);
+
+    // Onsets against the RMS envelope before this block
+    m_samplesTilNextOnset -= static_cast<int>(size);
+    m_analysis.onset = false;
+    if (m_samplesTilNextOnset <= 0 && m_analysis.rms > k_onsetFloor && m_analysis.rms > previousRmsEnvelope * k_onsetRatio) {
+        m_analysis.onset = true;
+        m_analysis.onsetCount++;
+        m_samplesTilNextOnset = m_onsetHoldSamples;
+    }
+
+    if (m_pitchEnabled) {
+        float frequency = m_analysis.frequency;
+        for (size_t i = 0; i < size; i++) {
+            frequency = m_frequencyDetector.Process(in[i]);
+        }
+        m_analysis.frequency = frequency;
+    } else {
+        m_analysis.frequency = 0.0f;
+    }
+
+    m_analysis.blockCount++;
+}
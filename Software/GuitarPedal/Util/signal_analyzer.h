@@ -0,0 +1,58 @@
+#pragma once
+#ifndef SIGNAL_ANALYZER_H
+#define SIGNAL_ANALYZER_H
+
+#include "frequency_detector_q.h"
+#include "signal_analysis.h"
+#include <stddef.h>
+
+namespace bkshepherd {
+
+/** Runs the shared analysis of the input once per audio block and publishes it as a SignalAnalysis.
+ *
+ * Levels and onsets cost a few operations per sample and always run. Pitch detection (the q detector of FrequencyDetectorQ,
+ * decimated to 12kHz) is far more expensive and only runs while it is enabled, the audio callback enables it while the active
+ * effect asks for it (BaseEffectModule::NeedsPitchAnalysis()).
+ *
+ * Onsets are rises of the block RMS of more than 9dB over the smoothed RMS, above -50dBFS, at most one per 60ms.
+ */
+class SignalAnalyzer {
+  public:
+    SignalAnalyzer();
+    ~SignalAnalyzer() {}
+
+    /** Initializes the analyzer
+        \param sampleRate Sample rate of the audio engine
+    */
+    void Init(float sampleRate);
+
+    /** Turns the pitch detection on or off, the published frequency is 0 while it is off */
+    void SetPitchEnabled(bool enabled);
+
+    /** Analyzes one block of the input and publishes the result
+        \param in Input samples
+        \param size Number of samples
+    */
+    void ProcessBlock(const float *in, size_t size);
+
+    /** The latest analysis, its address stays the same so effects can keep a pointer to it */
+    const SignalAnalysis &GetAnalysis() const { return m_analysis; }
+
+  private:
+    SignalAnalysis m_analysis;
+    float m_sampleRate;
+
+    // Release of the peak envelope and smoothing of the RMS envelope per sample
+    float m_envelopeRelease;
+    float m_rmsSmoothing;
+
+    // Samples left before the next onset can be detected
+    int m_samplesTilNextOnset;
+    int m_onsetHoldSamples;
+
+    bool m_pitchEnabled;
+    FrequencyDetectorQ m_frequencyDetector;
+};
+
+} // namespace bkshepherd
+#endif
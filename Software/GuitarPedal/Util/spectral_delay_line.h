@@ -0,0 +1,169 @@
+#pragma once
+#ifndef SPECTRAL_DELAY_LINE_H
+#define SPECTRAL_DELAY_LINE_H
+
+#include "memory_arena.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace bkshepherd {
+
+/** Delay line per frequency bin for STFT frames, with its own delay time and feedback for every bin.
+
+    All bins share one ring of spectra indexed by frame number, a frame holds the bins as interleaved 16 bit real / imaginary
+    pairs plus one float scale for the frame (block floating point, the quantization stays around 90dB below the loudest bin
+    of the frame). A frame is written in one sequential run, each bin reads the two frames around its delay.
+
+    The per bin settings and state are kept as arrays indexed by bin and every stage of a frame (delay glide, reads, feedback,
+    quantization) runs as one loop over the bins.
+
+    Spectra use the layout of the real FFTs in STFT/real_fft.h, the real part of bin k at [k] and minus its imaginary part at
+    [Bins + k] (bin 0 holds the real DC and Nyquist values, it is delayed like any other bin).
+
+    \tparam Bins number of bins, N / 2 for N point frames
+*/
+template <size_t Bins> class SpectralDelayLine {
+  public:
+    /** Shared memory needed for a ring of frames */
+    static constexpr size_t MemorySize(size_t frames) {
+        return MemoryArena::AlignedSize(sizeof(int16_t) * 2 * Bins * frames) + MemoryArena::AlignedSize(sizeof(float) * frames);
+    }
+
+    SpectralDelayLine() : bins_(nullptr), scales_(nullptr), frames_(0), write_(0), smoothing_(.0002f) {
+        for (size_t bin = 0; bin < Bins; bin++) {
+            delay_[bin] = 1.0f;
+            delayTarget_[bin] = 1.0f;
+            feedback_[bin] = 0.0f;
+        }
+    }
+
+    /** Takes the ring out of the arena and clears it
+        \param arena Arena to lease from, see MemorySize()
+        \param frames Length of the ring in frames, the longest delay is 2 frames shorter
+        \return false if the arena is too small
+    */
+    bool Init(MemoryArena &arena, size_t frames) {
+        bins_ = arena.NewArray<int16_t>(2 * Bins * frames);
+        scales_ = arena.NewArray<float>(frames);
+        if (bins_ == nullptr || scales_ == nullptr) {
+            Release();
+            return false;
+        }
+
+        frames_ = frames;
+        write_ = 0;
+        for (size_t frame = 0; frame < frames; frame++) {
+            scales_[frame] = 0.0f;
+        }
+        for (size_t i = 0; i < 2 * Bins * frames; i++) {
+            bins_[i] = 0;
+        }
+
+        // Start the glides where they are going
+        for (size_t bin = 0; bin < Bins; bin++) {
+            delay_[bin] = delayTarget_[bin] = ClampDelay(delayTarget_[bin]);
+        }
+        return true;
+    }
+
+    /** Forgets the ring, Process() must not be called until the next Init() */
+    void Release() {
+        bins_ = nullptr;
+        scales_ = nullptr;
+        frames_ = 0;
+    }
+
+    bool IsInitialized() const { return bins_ != nullptr; }
+
+    /** Sets the one pole coefficient the bin delays glide to their targets with, per frame */
+    void SetSmoothing(float coefficient) { smoothing_ = coefficient; }
+
+    /** Sets the delay a bin glides to
+        \param bin Bin index
+        \param frames Delay in frames, clamped to 1 up to the ring length - 2 once initialized
+    */
+    void SetDelay(size_t bin, float frames) { delayTarget_[bin] = frames_ > 0 ? ClampDelay(frames) : frames; }
+
+    /** Sets how much of a bin's output is written back with its input */
+    void SetFeedback(size_t bin, float amount) { feedback_[bin] = amount; }
+
+    /** Delays one spectrum
+        \param in Spectrum of the newest frame
+        \param out Delayed spectrum, may not be in
+    */
+    void Process(const float *in, float *out) {
+        const size_t frames = frames_;
+
+        // Delay glide
+        for (size_t bin = 0; bin < Bins; bin++) {
+            delay_[bin] += smoothing_ * (delayTarget_[bin] - delay_[bin]);
+        }
+
+        // Interpolated reads, a is the frame integral frames back and b the one before it
+        for (size_t bin = 0; bin < Bins; bin++) {
+            const float delay = delay_[bin];
+            const size_t integral = static_cast<size_t>(delay);
+            const float frac = delay - static_cast<float>(integral);
+
+            size_t a = write_ + frames - integral;
+            a -= a >= frames ? frames : 0;
+            const size_t b = a == 0 ? frames - 1 : a - 1;
+
+            const int16_t *binA = bins_ + 2 * (a * Bins + bin);
+            const int16_t *binB = bins_ + 2 * (b * Bins + bin);
+            const float scaleA = scales_[a];
+            const float scaleB = scales_[b];
+
+            const float realA = binA[0] * scaleA, imagA = binA[1] * scaleA;
+            const float realB = binB[0] * scaleB, imagB = binB[1] * scaleB;
+            out[bin] = realA + (realB - realA) * frac;
+            out[Bins + bin] = imagA + (imagB - imagA) * frac;
+        }
+
+        // Input plus feedback, and the peak the frame is scaled by
+        float peak = 0.0f;
+        for (size_t bin = 0; bin < Bins; bin++) {
+            const float real = in[bin] + feedback_[bin] * out[bin];
+            const float imag = in[Bins + bin] + feedback_[bin] * out[Bins + bin];
+            written_[2 * bin] = real;
+            written_[2 * bin + 1] = imag;
+            peak = fmaxf(peak, fmaxf(fabsf(real), fabsf(imag)));
+        }
+
+        // Quantize into the ring
+        const float scale = peak * (1.0f / 32767.0f);
+        const float inverse = peak > 0.0f ? 32767.0f / peak : 0.0f;
+        int16_t *frame = bins_ + 2 * write_ * Bins;
+        for (size_t i = 0; i < 2 * Bins; i++) {
+            frame[i] = static_cast<int16_t>(lrintf(written_[i] * inverse));
+        }
+        scales_[write_] = scale;
+
+        write_ = write_ + 1 == frames ? 0 : write_ + 1;
+    }
+
+  private:
+    float ClampDelay(float frames) const {
+        const float longest = static_cast<float>(frames_ - 2);
+        return frames < 1.0f ? 1.0f : (frames > longest ? longest : frames);
+    }
+
+    int16_t *bins_;
+    float *scales_;
+    size_t frames_;
+    size_t write_;
+    float smoothing_;
+
+    // Per bin settings and state
+    float delay_[Bins];
+    float delayTarget_[Bins];
+    float feedback_[Bins];
+
+    // Interleaved frame being written
+    float written_[2 * Bins];
+};
+
+} // namespace bkshepherd
+
+#endif
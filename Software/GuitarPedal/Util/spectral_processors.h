@@ -0,0 +1,262 @@
+#pragma once
+#ifndef SPECTRAL_PROCESSORS_H
+#define SPECTRAL_PROCESSORS_H
+
+#include "STFT/fourier.h"
+#include <math.h>
+#include <stddef.h>
+
+namespace bkshepherd {
+
+// Processors for STFT frames, to be run by a SpectralEffectModule directly or in a soundmath::SpectralChain. Spectra use the
+// layout of STFT/real_fft.h: the real part of bin k at [k] and minus its imaginary part at [Bins + k], bin 0 holds the real
+// DC and Nyquist values. All of them keep their settings and state per bin in arrays and process a frame in loops over the
+// bins, without trigonometry.
+
+/** Spectral noise gate, every bin opens and closes on its own magnitude.
+
+    A bin opens when its magnitude is above the threshold and closes when it falls below, its gain moves towards open / closed
+    with separate one pole coefficients per frame so the gate doesn't chatter. Magnitudes are those of the unnormalized
+    spectrum, a full scale sine in a 1024 point Hann window frame is about 256.
+
+    \tparam Bins number of bins, N / 2 for N point frames
+*/
+template <size_t Bins> class SpectralGate : public soundmath::SpectralProcessor<float> {
+  public:
+    SpectralGate() : threshold_(0.0f), attack_(0.5f), release_(0.1f) {
+        for (size_t bin = 0; bin < Bins; bin++) {
+            gain_[bin] = 1.0f;
+        }
+    }
+
+    /** Sets the magnitude bins have to reach to open, 0 keeps the gate open */
+    void SetThreshold(float magnitude) { threshold_ = magnitude; }
+
+    /** Sets how fast bins open and close
+        \param attack Coefficient per frame towards open, 0..1
+        \param release Coefficient per frame towards closed, 0..1
+    */
+    void SetTimes(float attack, float release) {
+        attack_ = attack;
+        release_ = release;
+    }
+
+    void process(const float *in, float *out) override {
+        const float threshold = threshold_ * threshold_;
+
+        // Squared magnitudes against the squared threshold, bin 0 goes by its DC part
+        for (size_t bin = 0; bin < Bins; bin++) {
+            const float real = in[bin];
+            const float imag = bin == 0 ? 0.0f : in[Bins + bin];
+            const float target = real * real + imag * imag >= threshold ? 1.0f : 0.0f;
+            const float coefficient = target > gain_[bin] ? attack_ : release_;
+            gain_[bin] += coefficient * (target - gain_[bin]);
+        }
+
+        for (size_t bin = 0; bin < Bins; bin++) {
+            out[bin] = in[bin] * gain_[bin];
+            out[Bins + bin] = in[Bins + bin] * gain_[bin];
+        }
+    }
+
+  private:
+    float threshold_;
+    float attack_;
+    float release_;
+    float gain_[Bins];
+};
+
+/** Spectral freeze, holds the spectrum and keeps it sounding.
+
+    Freezing captures two frames in a row: the magnitudes of the second and, for every bin, the phase advance between them.
+    While frozen a unit phasor per bin is rotated by that advance every frame, so partials keep their frequency instead of
+    repeating one frame (which would buzz at the hop rate). The rotations are complex multiplies, the phasors are pulled back
+    to unit length every frame. Freezing and releasing crossfade between the live and the held spectrum.
+
+    \tparam Bins number of bins, N / 2 for N point frames
+*/
+template <size_t Bins> class SpectralFreeze : public soundmath::SpectralProcessor<float> {
+  public:
+    SpectralFreeze() : frozen_(false), captured_(0), mix_(0.0f), fade_(0.125f), held0_(0.0f), heldNyquist_(0.0f) {
+        for (size_t bin = 0; bin < Bins; bin++) {
+            magnitude_[bin] = 0.0f;
+            phaseReal_[bin] = 1.0f;
+            phaseImag_[bin] = 0.0f;
+            rotationReal_[bin] = 1.0f;
+            rotationImag_[bin] = 0.0f;
+        }
+    }
+
+    /** Freezes the next frames (after a capture of two frames) or goes back to the live input */
+    void SetFrozen(bool frozen) {
+        if (frozen && !frozen_) {
+            captured_ = 0;
+        }
+        frozen_ = frozen;
+    }
+
+    bool IsFrozen() const { return frozen_; }
+
+    /** Sets the crossfade between live and held spectrum, the amount moved per frame */
+    void SetFade(float amount) { fade_ = amount; }
+
+    void process(const float *in, float *out) override {
+        if (frozen_ && captured_ < 2) {
+            Capture(in);
+        }
+
+        // The held spectrum sounds once the capture is done
+        const float target = frozen_ && captured_ == 2 ? 1.0f : 0.0f;
+        mix_ += mix_ < target ? fade_ : (mix_ > target ? -fade_ : 0.0f);
+        mix_ = mix_ < 0.0f ? 0.0f : (mix_ > 1.0f ? 1.0f : mix_);
+
+        if (mix_ == 0.0f) {
+            for (size_t i = 0; i < 2 * Bins; i++) {
+                out[i] = in[i];
+            }
+            return;
+        }
+
+        // Advance the phasors, with one Newton step back to unit length
+        for (size_t bin = 1; bin < Bins; bin++) {
+            const float real = phaseReal_[bin] * rotationReal_[bin] - phaseImag_[bin] * rotationImag_[bin];
+            const float imag = phaseReal_[bin] * rotationImag_[bin] + phaseImag_[bin] * rotationReal_[bin];
+            const float correction = 1.5f - 0.5f * (real * real + imag * imag);
+            phaseReal_[bin] = real * correction;
+            phaseImag_[bin] = imag * correction;
+        }
+
+        const float live = 1.0f - mix_;
+        out[0] = in[0] * live + held0_ * mix_;
+        out[Bins] = in[Bins] * live + heldNyquist_ * mix_;
+        for (size_t bin = 1; bin < Bins; bin++) {
+            const float held = magnitude_[bin] * mix_;
+            out[bin] = in[bin] * live + phaseReal_[bin] * held;
+            out[Bins + bin] = in[Bins + bin] * live + phaseImag_[bin] * held;
+        }
+    }
+
+  private:
+    void Capture(const float *in) {
+        // The first frame keeps its phasors, the second one turns them into rotations and holds its magnitudes
+        const bool second = captured_ == 1;
+        for (size_t bin = 1; bin < Bins; bin++) {
+            const float real = in[bin];
+            const float imag = in[Bins + bin];
+            const float magnitude = sqrtf(real * real + imag * imag);
+            const float inverse = magnitude > 1e-9f ? 1.0f / magnitude : 0.0f;
+            const float unitReal = magnitude > 1e-9f ? real * inverse : 1.0f;
+            const float unitImag = imag * inverse;
+
+            if (second) {
+                // rotation = current * conj(previous)
+                rotationReal_[bin] = unitReal * phaseReal_[bin] + unitImag * phaseImag_[bin];
+                rotationImag_[bin] = unitImag * phaseReal_[bin] - unitReal * phaseImag_[bin];
+                magnitude_[bin] = magnitude;
+            }
+            phaseReal_[bin] = unitReal;
+            phaseImag_[bin] = unitImag;
+        }
+
+        held0_ = in[0];
+        heldNyquist_ = in[Bins];
+        captured_++;
+    }
+
+    bool frozen_;
+    int captured_;
+    float mix_;
+    float fade_;
+    float held0_;
+    float heldNyquist_;
+
+    // Per bin state, bin 0 is held as is
+    float magnitude_[Bins];
+    float phaseReal_[Bins];
+    float phaseImag_[Bins];
+    float rotationReal_[Bins];
+    float rotationImag_[Bins];
+};
+
+/** Cross-synthesis vocoder, imposes the spectral envelope of the processed signal (the modulator) on a carrier spectrum.
+
+    The envelopes are moving averages of the magnitudes over EnvelopeWidth bins on either side, every carrier bin is scaled by
+    modulator envelope / carrier envelope, so the carrier keeps its own fine structure (its harmonics) under the shape of the
+    modulator. The carrier is the spectrum of another STFT running in step with this one, usually another channel of the same
+    effect (see SpectralEffectModule::GetSpectrum()), so both share one FFT plan.
+
+    \tparam Bins number of bins, N / 2 for N point frames
+*/
+template <size_t Bins> class SpectralVocoder : public soundmath::SpectralProcessor<float> {
+  public:
+    /** Bins averaged on either side of a bin for its envelope, 8 bins of 47Hz for 1024 point frames at 48kHz */
+    static constexpr size_t EnvelopeWidth = 8;
+
+    SpectralVocoder() : carrier_(nullptr), amount_(0.0f) {}
+
+    /** Sets the spectrum to vocode, read every frame. nullptr passes the input through */
+    void SetCarrier(const float *carrier) { carrier_ = carrier; }
+
+    /** Sets the blend of vocoded and input spectrum, 0..1 */
+    void SetAmount(float amount) { amount_ = amount; }
+
+    void process(const float *in, float *out) override {
+        if (carrier_ == nullptr || amount_ == 0.0f) {
+            for (size_t i = 0; i < 2 * Bins; i++) {
+                out[i] = in[i];
+            }
+            return;
+        }
+
+        Magnitudes(in, modulator_);
+        Magnitudes(carrier_, carrierMagnitudes_);
+
+        // Sliding window sums over the bins, the ratio of the two is the gain of a carrier bin
+        float modulatorSum = 0.0f;
+        float carrierSum = 0.0f;
+        for (size_t bin = 0; bin < EnvelopeWidth && bin < Bins; bin++) {
+            modulatorSum += modulator_[bin];
+            carrierSum += carrierMagnitudes_[bin];
+        }
+        for (size_t bin = 0; bin < Bins; bin++) {
+            if (bin + EnvelopeWidth < Bins) {
+                modulatorSum += modulator_[bin + EnvelopeWidth];
+                carrierSum += carrierMagnitudes_[bin + EnvelopeWidth];
+            }
+            if (bin > EnvelopeWidth) {
+                modulatorSum -= modulator_[bin - EnvelopeWidth - 1];
+                carrierSum -= carrierMagnitudes_[bin - EnvelopeWidth - 1];
+            }
+            gain_[bin] = modulatorSum / (carrierSum + 1e-3f);
+        }
+
+        const float dry = 1.0f - amount_;
+        for (size_t bin = 0; bin < Bins; bin++) {
+            const float wet = gain_[bin] * amount_;
+            out[bin] = in[bin] * dry + carrier_[bin] * wet;
+            out[Bins + bin] = in[Bins + bin] * dry + carrier_[Bins + bin] * wet;
+        }
+    }
+
+  private:
+    static void Magnitudes(const float *spectrum, float *magnitudes) {
+        magnitudes[0] = fabsf(spectrum[0]);
+        for (size_t bin = 1; bin < Bins; bin++) {
+            const float real = spectrum[bin];
+            const float imag = spectrum[Bins + bin];
+            magnitudes[bin] = sqrtf(real * real + imag * imag);
+        }
+    }
+
+    const float *carrier_;
+    float amount_;
+
+    // Scratch for one frame
+    float modulator_[Bins];
+    float carrierMagnitudes_[Bins];
+    float gain_[Bins];
+};
+
+} // namespace bkshepherd
+
+#endif
@@ -0,0 +1,127 @@
+#pragma once
+#ifndef STAGED_DELAY_LINE_H
+#define STAGED_DELAY_LINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace bkshepherd {
+
+/** Block staging for a MaskedDelayLine that lives in SDRAM.
+
+    Every SDRAM access pays the external memory latency, and interpolated read heads touch two scattered samples per output
+    sample. Over one block a read head only moves through a short contiguous span that is known up front from its delay and
+    how fast the delay is gliding, so the spans are copied into local windows at the start of the block (one sequential run per
+    window), the block is read from the windows, and the samples written during the block are kept locally and written back
+    in one run at the end.
+
+    The staged line has the read/write interface of MaskedDelayLine (Write, ReadPosition, GetWritePosition, Wrap) so code
+    templated on the line can run on either. Reads are exact: positions written during the block come from the pending writes
+    and positions outside every window fall back to reading the line, the windows only decide how many reads stay local. The one
+    difference is that a sample read back within the block it was written in hasn't gone through the storage encoding yet.
+
+    Keep the staged line in internal RAM, typically a HOT_DTCM module global (see memory_placement.h), not in SDRAM with the line.
+
+    Per block: Begin(), LoadSpan() for each read head, up to MaxBlockSize Write() calls with the reads in between, End().
+
+    \tparam Line MaskedDelayLine (or StaticMaskedDelayLine) being staged
+    \tparam WindowCount number of read windows
+    \tparam WindowSize samples per read window, longer spans are truncated and the rest is read from the line
+    \tparam MaxBlockSize largest number of samples written between Begin() and End()
+*/
+template <typename Line, size_t WindowCount, size_t WindowSize, size_t MaxBlockSize> class StagedDelayLine {
+  public:
+    typedef typename Line::Sample Sample;
+
+    StagedDelayLine() : line_(nullptr), write_start_(0), pending_count_(0) { ClearWindows(); }
+
+    /** Starts a block on a line, all windows start out empty */
+    void Begin(Line &line) {
+        line_ = &line;
+        write_start_ = line.GetWritePosition();
+        pending_count_ = 0;
+        ClearWindows();
+    }
+
+    /** Copies the samples between two absolute positions of the line into a window
+        \param window Index of the window, below WindowCount
+        \param oldest First position of the span
+        \param newest Last position of the span (inclusive), positions wrap around the line
+    */
+    void LoadSpan(size_t window, size_t oldest, size_t newest) {
+        size_t count = line_->Wrap(newest - oldest) + 1;
+        if (count > WindowSize) {
+            count = WindowSize;
+        }
+
+        window_first_[window] = line_->Wrap(oldest);
+        window_count_[window] = count;
+
+        const Line &line = *line_;
+        Sample *samples = windows_[window];
+        for (size_t i = 0; i < count; i++) {
+            samples[i] = line.ReadPosition(oldest + i);
+        }
+    }
+
+    /** Writes a sample, it reaches the line in End() */
+    inline void Write(const Sample sample) {
+        if (pending_count_ == MaxBlockSize) {
+            // Block longer than promised, write back early and drop the windows as they may now be stale
+            Flush();
+            ClearWindows();
+        }
+        pending_[pending_count_++] = sample;
+    }
+
+    /** Reads at an absolute position, from the pending writes, a window or (if neither holds it) the line */
+    inline Sample ReadPosition(size_t position) const {
+        const size_t pending = line_->Wrap(position - write_start_);
+        if (pending < pending_count_) {
+            return pending_[pending];
+        }
+
+        for (size_t window = 0; window < WindowCount; window++) {
+            const size_t offset = line_->Wrap(position - window_first_[window]);
+            if (offset < window_count_[window]) {
+                return windows_[window][offset];
+            }
+        }
+
+        return line_->ReadPosition(position);
+    }
+
+    /** Position the next sample is written to, including the writes still pending */
+    inline size_t GetWritePosition() const { return line_->Wrap(write_start_ + pending_count_); }
+
+    inline size_t Wrap(size_t position) const { return line_->Wrap(position); }
+
+    /** Writes the pending samples back to the line and ends the block */
+    void End() { Flush(); }
+
+  private:
+    void Flush() {
+        line_->Write(pending_, pending_count_);
+        write_start_ = line_->GetWritePosition();
+        pending_count_ = 0;
+    }
+
+    void ClearWindows() {
+        for (size_t window = 0; window < WindowCount; window++) {
+            window_first_[window] = 0;
+            window_count_[window] = 0;
+        }
+    }
+
+    Line *line_;
+    size_t write_start_;
+    size_t pending_count_;
+    size_t window_first_[WindowCount];
+    size_t window_count_[WindowCount];
+    Sample pending_[MaxBlockSize];
+    Sample windows_[WindowCount][WindowSize];
+};
+
+} // namespace bkshepherd
+
+#endif
@@ -1,8 +1,8 @@
 #include "tape_modulator.h"
-#include "daisy_seed.h"
+#include "memory_placement.h"
 
-// Actual definitions of the static members
-DSY_SDRAM_BSS uint8_t TapeModulator::perm_[512];
+// Actual definitions of the static members, the permutation is read for every sample
+HOT_DTCM uint8_t TapeModulator::perm_[512];
 
 void TapeModulator::Init(float sample_rate) {
     for(int i = 0; i < 256; i++) {
@@ -7,4 +7,9 @@ if [ $? -ne 0 ]; then
         echo "Failed to compile GuitarPedal firmware"
         exit 1
 fi
+./ci/memory_report.sh build/guitarpedal.elf
+if [ $? -ne 0 ]; then
+        echo "GuitarPedal firmware doesn't fit the memory budget"
+        exit 1
+fi
 echo "done."
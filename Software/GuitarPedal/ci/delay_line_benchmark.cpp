@@ -0,0 +1,149 @@
+// Times the masked delay line of Util/masked_delay_line.h on the host against a delay line that wraps with a modulo, the
+// way the custom delay lines did before, for each storage and for block reads.
+//
+// From /Software/GuitarPedal/:
+//   g++ -O3 -std=gnu++20 -I Util ci/delay_line_benchmark.cpp -o delay_line_benchmark && ./delay_line_benchmark
+//
+// Every line is 8 seconds at 48kHz like the DelayModule lines (the masked ones round up to 524288 samples) and is read with a
+// slowly modulated delay, one interpolated read and one write per sample. The host has a fast divider, so the modulo costs
+// less here than on the Cortex-M7, and the storage formats mostly trade memory bandwidth the host cache hides. The absolute
+// numbers have to be taken on the pedal.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "masked_delay_line.h"
+
+using namespace bkshepherd;
+
+namespace {
+
+const float s_sampleRate = 48000.0f;
+const size_t s_blockSize = 48;
+const size_t s_maxDelay = 48000 * 8;
+
+// Linear interpolated delay line wrapping with a modulo, as the custom delay lines were written before
+template <size_t max_size> class ModuloDelayLine {
+  public:
+    void Init() {
+        for (size_t i = 0; i < max_size; i++) {
+            line_[i] = 0.0f;
+        }
+        write_ptr_ = 0;
+    }
+
+    inline void Write(const float sample) {
+        line_[write_ptr_] = sample;
+        write_ptr_ = (write_ptr_ - 1 + max_size) % max_size;
+    }
+
+    inline float ReadInterpolated(float delay) const {
+        const size_t integral = static_cast<size_t>(delay);
+        const float frac = delay - static_cast<float>(integral);
+        const float a = line_[(write_ptr_ + integral) % max_size];
+        const float b = line_[(write_ptr_ + integral + 1) % max_size];
+        return a + (b - a) * frac;
+    }
+
+  private:
+    float line_[max_size];
+    size_t write_ptr_;
+};
+
+std::vector<float> Signal() {
+    std::vector<float> signal(static_cast<size_t>(s_sampleRate) * 2);
+    for (size_t n = 0; n < signal.size(); n++) {
+        signal[n] = 0.5f * std::sin(2.0f * static_cast<float>(M_PI) * 220.0f * n / s_sampleRate);
+    }
+    return signal;
+}
+
+// Delay for each sample, a second long delay with a slow chorus like sweep on top
+std::vector<float> Delays(size_t size) {
+    std::vector<float> delays(size);
+    for (size_t n = 0; n < size; n++) {
+        delays[n] = s_sampleRate + 200.0f * std::sin(2.0f * static_cast<float>(M_PI) * 0.5f * n / s_sampleRate);
+    }
+    return delays;
+}
+
+// Best of a few rounds of a per sample read and write, time per sample
+template <typename Line> double RunPerSample(Line &line, const std::vector<float> &signal, const std::vector<float> &delays) {
+    volatile float sink = 0.0f;
+
+    double best = 1e30;
+    for (int round = 0; round < 5; round++) {
+        line.Init();
+        float sum = 0.0f;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t n = 0; n < signal.size(); n++) {
+            const float read = line.ReadInterpolated(delays[n]);
+            line.Write(signal[n] + 0.5f * read);
+            sum += read;
+        }
+        const auto end = std::chrono::steady_clock::now();
+        sink = sum;
+
+        const double time = std::chrono::duration<double, std::nano>(end - start).count() / signal.size();
+        best = time < best ? time : best;
+    }
+
+    (void)sink;
+    return best;
+}
+
+// Same, a block of reads followed by a block of writes
+template <typename Line> double RunBlock(Line &line, const std::vector<float> &signal, const std::vector<float> &delays) {
+    volatile float sink = 0.0f;
+
+    double best = 1e30;
+    for (int round = 0; round < 5; round++) {
+        line.Init();
+        float sum = 0.0f;
+        float read[s_blockSize];
+        float write[s_blockSize];
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t n = 0; n + s_blockSize <= signal.size(); n += s_blockSize) {
+            line.ReadInterpolated(&delays[n], read, s_blockSize);
+            for (size_t i = 0; i < s_blockSize; i++) {
+                write[i] = signal[n + i] + 0.5f * read[i];
+                sum += read[i];
+            }
+            line.Write(write, s_blockSize);
+        }
+        const auto end = std::chrono::steady_clock::now();
+        sink = sum;
+
+        const double time = std::chrono::duration<double, std::nano>(end - start).count() / signal.size();
+        best = time < best ? time : best;
+    }
+
+    (void)sink;
+    return best;
+}
+
+ModuloDelayLine<s_maxDelay> s_modulo;
+StaticMaskedDelayLine<float, NextPowerOfTwo(s_maxDelay)> s_float;
+StaticMaskedDelayLine<float, NextPowerOfTwo(s_maxDelay), LinearInterpolation, Int16Storage<1>> s_int16;
+StaticMaskedDelayLine<float, NextPowerOfTwo(s_maxDelay), LinearInterpolation, Packed24Storage<1>> s_packed24;
+StaticMaskedDelayLine<float, NextPowerOfTwo(s_maxDelay), CubicInterpolation> s_cubic;
+
+} // namespace
+
+int main() {
+    const std::vector<float> signal = Signal();
+    const std::vector<float> delays = Delays(signal.size());
+
+    printf("8s delay line, one interpolated read and one write per sample at 48kHz\n\n");
+    printf("| line                      | per sample ns | block of %zu ns |\n", s_blockSize);
+    printf("|---------------------------|---------------|----------------|\n");
+    printf("| modulo, float             | %13.2f | %14s |\n", RunPerSample(s_modulo, signal, delays), "-");
+    printf("| masked, float             | %13.2f | %14.2f |\n", RunPerSample(s_float, signal, delays), RunBlock(s_float, signal, delays));
+    printf("| masked, float, Hermite    | %13.2f | %14.2f |\n", RunPerSample(s_cubic, signal, delays), RunBlock(s_cubic, signal, delays));
+    printf("| masked, int16             | %13.2f | %14.2f |\n", RunPerSample(s_int16, signal, delays), RunBlock(s_int16, signal, delays));
+    printf("| masked, packed 24 bit     | %13.2f | %14.2f |\n", RunPerSample(s_packed24, signal, delays),
+           RunBlock(s_packed24, signal, delays));
+    return 0;
+}
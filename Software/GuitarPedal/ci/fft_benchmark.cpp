@@ -0,0 +1,82 @@
+// Times the real FFT backends of Util/STFT/real_fft.h on the host and checks that they agree with ShyFFT.
+//
+// From /Software/GuitarPedal/:
+//   g++ -O2 -std=gnu++20 -I Util/STFT ci/fft_benchmark.cpp -o fft_benchmark && ./fft_benchmark
+//
+// The CMSIS backend only builds for the target and isn't part of this.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define FFT_BACKEND FFT_BACKEND_SHY
+#include "real_fft.h"
+
+using namespace soundmath;
+
+template <typename FFT, size_t N> double Time(FFT &fft, const float *signal) {
+    static float a[N], b[N];
+    const int runs = static_cast<int>(2000000 / N);
+
+    // Best of a few rounds, the host is rarely quiet
+    double best = 1e30;
+    for (int round = 0; round < 7; round++) {
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; i++) {
+            memcpy(a, signal, sizeof(a));
+            fft.Direct(a, b);
+            fft.Inverse(b, a);
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const double time = std::chrono::duration<double, std::micro>(end - start).count() / runs;
+        best = time < best ? time : best;
+    }
+
+    return best;
+}
+
+template <size_t N> void Run() {
+    static float signal[N];
+    for (size_t i = 0; i < N; i++) {
+        signal[i] = static_cast<float>(rand()) / static_cast<float>(RAND_MAX) - 0.5f;
+    }
+
+    static ShyFFT<float, N, RotationPhasor> shy;
+    static SplitRadixFFT<float, N> splitRadix;
+    shy.Init();
+    splitRadix.Init();
+
+    // Both have to produce the same spectrum and the same (N times) signal back
+    static float a[N], b[N], c[N], d[N];
+    memcpy(a, signal, sizeof(a));
+    memcpy(c, signal, sizeof(c));
+    shy.Direct(a, b);
+    splitRadix.Direct(c, d);
+    float spectrumError = 0.0f;
+    for (size_t i = 0; i < N; i++) {
+        spectrumError = fmaxf(spectrumError, fabsf(b[i] - d[i]));
+    }
+    splitRadix.Inverse(d, c);
+    float signalError = 0.0f;
+    for (size_t i = 0; i < N; i++) {
+        signalError = fmaxf(signalError, fabsf(c[i] / N - signal[i]));
+    }
+
+    const double shyTime = Time<ShyFFT<float, N, RotationPhasor>, N>(shy, signal);
+    const double splitRadixTime = Time<SplitRadixFFT<float, N>, N>(splitRadix, signal);
+    printf("| %4zu | %6.1f | %11.1f | %9.1e | %9.1e |\n", N, shyTime, splitRadixTime, spectrumError, signalError);
+}
+
+int main() {
+    printf("Direct + Inverse in microseconds\n\n");
+    printf("|    N | ShyFFT | split radix | spectrum  | roundtrip |\n");
+    printf("|------|--------|-------------|-----------|-----------|\n");
+    Run<256>();
+    Run<512>();
+    Run<1024>();
+    Run<2048>();
+    Run<4096>();
+    return 0;
+}
@@ -0,0 +1,80 @@
+#!/bin/bash
+
+# Reports how much of each memory region the linked firmware uses and checks that the DTCM working set (HOT_DTCM data,
+# plain globals and whatever else the linker put there) leaves room for the stack. See Util/memory_placement.h.
+#
+# From /Software/GuitarPedal/ after a build: ./ci/memory_report.sh build/guitarpedal.elf
+# DTCM_STACK_RESERVE (bytes, default 16384) sets how much DTCM has to stay free.
+
+ELF=${1:-build/guitarpedal.elf}
+DTCM_STACK_RESERVE=${DTCM_STACK_RESERVE:-16384}
+SIZE=${SIZE:-arm-none-eabi-size}
+NM=${NM:-arm-none-eabi-nm}
+
+if [ ! -f "$ELF" ]; then
+        echo "memory report: $ELF not found, build the firmware first"
+        exit 1
+fi
+
+echo "Memory placement report for $ELF"
+
+# Sections are assigned to regions by their address, so this doesn't depend on the section names of the linker script
+$SIZE -A -d "$ELF" | awk -v reserve="$DTCM_STACK_RESERVE" '
+function region(addr) {
+    if (addr < 65536) return "ITCM";
+    if (addr >= 536870912 && addr < 537001984) return "DTCM";
+    if (addr >= 603979776 && addr < 604504064) return "AXI SRAM";
+    if (addr >= 805306368 && addr < 805601280) return "D2 SRAM";
+    if (addr >= 939524096 && addr < 939589632) return "D3 SRAM";
+    if (addr >= 2415919104 && addr < 2684354560) return "QSPI flash";
+    if (addr >= 3221225472 && addr < 3288334336) return "SDRAM";
+    return "";
+}
+BEGIN {
+    capacity["ITCM"] = 65536;
+    capacity["DTCM"] = 131072;
+    capacity["AXI SRAM"] = 524288;
+    capacity["D2 SRAM"] = 294912;
+    capacity["D3 SRAM"] = 65536;
+    capacity["QSPI flash"] = 8388608;
+    capacity["SDRAM"] = 67108864;
+    order[1] = "ITCM"; order[2] = "DTCM"; order[3] = "AXI SRAM"; order[4] = "D2 SRAM";
+    order[5] = "D3 SRAM"; order[6] = "QSPI flash"; order[7] = "SDRAM";
+}
+NF == 3 && $2 ~ /^[0-9]+$/ && $3 ~ /^[0-9]+$/ && $2 > 0 && $3 > 0 {
+    # The heap / stack reservation is what the check protects, it is not part of the working set
+    if ($1 == "._user_heap_stack") next;
+    r = region($3);
+    if (r == "") next;
+    used[r] += $2;
+    sections[r] = sections[r] " " $1;
+}
+END {
+    for (i = 1; i <= 7; i++) {
+        r = order[i];
+        if (!(r in used)) continue;
+        printf "  %-10s %9d / %9d bytes (%5.1f%%) %s\n", r, used[r], capacity[r], 100.0 * used[r] / capacity[r], sections[r];
+    }
+
+    free = capacity["DTCM"] - used["DTCM"];
+    if (free < reserve) {
+        printf "DTCM working set leaves %d bytes for the stack, %d are reserved. Move large data out with WARM_SRAM or COLD_SDRAM.\n",
+               free, reserve;
+        exit 1;
+    }
+    printf "DTCM leaves %d bytes for the stack (%d reserved)\n", free, reserve;
+}'
+STATUS=$?
+
+# The largest objects in DTCM, the first candidates to move when the working set grows
+echo "Largest objects in DTCM:"
+$NM -S --size-sort -C -t d "$ELF" | awk '
+NF >= 4 && $1 + 0 >= 536870912 && $1 + 0 < 537001984 { lines[n++] = $0 }
+END {
+    for (i = n - 1; i >= 0 && i >= n - 10; i--) {
+        split(lines[i], f, " ");
+        printf "  %8d  %s\n", f[2] + 0, substr(lines[i], index(lines[i], f[4]));
+    }
+}'
+
+exit $STATUS
@@ -0,0 +1,117 @@
+// Times the two engines of the pitch shifter module on the host, the delay line shifter (Util/pitch_shifter.h) at its shortest
+// and longest delay and the PSOLA shifter (Util/psola_shifter.h).
+//
+// From /Software/GuitarPedal/ (with the submodules checked out):
+//   g++ -O3 -std=gnu++20 -I Util -isystem dependencies/DaisySP/Source ci/pitch_shifter_benchmark.cpp
+//       -o pitch_shifter_benchmark && ./pitch_shifter_benchmark
+//
+// (one command, split over two lines here)
+//
+// Both run in blocks of 48 samples like in the firmware. The delay line shifter does two table lookups and two interpolated
+// reads per sample, PSOLA a table lookup and an interpolated read per sounding grain (2 to 5 of them, more the further up
+// it shifts). The absolute numbers have to be taken on the pedal.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "masked_delay_line.h"
+#include "pitch_shifter.h"
+#include "psola_shifter.h"
+
+namespace {
+
+const float s_sampleRate = 48000.0f;
+const size_t s_blockSize = 48;
+
+// An A2 with a few harmonics, the level of a guitar a bit after the attack
+const double s_note = 110.0;
+
+std::vector<float> Signal() {
+    std::vector<float> signal(static_cast<size_t>(s_sampleRate));
+    for (size_t n = 0; n < signal.size(); n++) {
+        double sample = 0;
+        for (int harmonic = 1; harmonic <= 5; harmonic++) {
+            sample += 0.3 / harmonic * std::sin(2 * M_PI * s_note * harmonic * n / s_sampleRate);
+        }
+        signal[n] = static_cast<float>(sample);
+    }
+    return signal;
+}
+
+// Time per sample
+template <typename Shifter> double Run(Shifter &shifter, const std::vector<float> &signal) {
+    std::vector<float> out(signal.size());
+
+    // Best of a few rounds, the host is rarely quiet
+    double best = 1e30;
+    for (int round = 0; round < 5; round++) {
+        shifter.Reset();
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t n = 0; n + s_blockSize <= signal.size(); n += s_blockSize) {
+            shifter.Process(&signal[n], &out[n], s_blockSize);
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const double time = std::chrono::duration<double, std::nano>(end - start).count() / signal.size();
+        best = time < best ? time : best;
+    }
+
+    return best;
+}
+
+float s_bufferA[bkshepherd::NextPowerOfTwo(6000)];
+float s_bufferB[bkshepherd::NextPowerOfTwo(6000)];
+float s_psolaBuffer[8192];
+
+// Adapters that set the engines up the way the module does
+struct DelayEngine {
+    daisysp_modified::PitchShifter shifter;
+    uint32_t delay;
+    float semitones;
+
+    void Reset() {
+        shifter.Init(s_sampleRate, s_bufferA, s_bufferB, 6000);
+        shifter.SetDelSize(delay);
+        shifter.SetTransposition(semitones);
+    }
+    void Process(const float *in, float *out, size_t size) { shifter.Process(in, out, size); }
+};
+
+struct PsolaEngine {
+    bkshepherd::PsolaShifter shifter;
+    float semitones;
+
+    void Reset() {
+        shifter.Init(s_sampleRate, s_psolaBuffer, 8192);
+        shifter.SetTransposition(semitones);
+        shifter.SetFrequency(s_note);
+    }
+    void Process(const float *in, float *out, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            out[i] = shifter.Process(in[i]);
+        }
+    }
+};
+
+} // namespace
+
+int main() {
+    const std::vector<float> signal = Signal();
+
+    printf("Pitch shifter engines on a 110Hz note, per sample at 48kHz\n\n");
+    printf("| semitones | delay 2048 ns | delay 6000 ns |  PSOLA ns |\n");
+    printf("|-----------|---------------|---------------|-----------|\n");
+    const float transpositions[] = {-12, -7, -1, 1, 7, 12};
+    for (float semitones : transpositions) {
+        static DelayEngine shortDelay, longDelay;
+        static PsolaEngine psola;
+        shortDelay.delay = 2048;
+        longDelay.delay = 6000;
+        shortDelay.semitones = longDelay.semitones = psola.semitones = semitones;
+        printf("| %9.0f | %13.1f | %13.1f | %9.1f |\n", semitones, Run(shortDelay, signal), Run(longDelay, signal),
+               Run(psola, signal));
+    }
+    return 0;
+}
@@ -17,6 +17,7 @@ class AllpassDiffuser {
 
     vector<ModulatedAllpass *> filters;
     int delay;
+    float modAmount;
     float modRate;
     vector<float> seedValues;
     int seed;
@@ -25,14 +26,17 @@ class AllpassDiffuser {
   public:
     int Stages;
 
-    AllpassDiffuser(int samplerate, int delayBufferLengthMillis) {
-        auto delayBufferSize = samplerate * ((float)delayBufferLengthMillis / 1000.0);
+    AllpassDiffuser(int bufferSize, int samplerate, int delayBufferLengthMillis) {
+        // The allpass delay memory is fixed in ModulatedAllpass, only the output buffer depends on the block size
         for (int i = 0; i < MaxStageCount; i++) {
-            filters.push_back(new ModulatedAllpass((int)delayBufferSize, 100));
+            filters.push_back(new ModulatedAllpass(bufferSize, 100));
         }
 
+        this->samplerate = samplerate;
         crossSeed = 0.0;
         seed = 23456;
+        modAmount = 0.0;
+        modRate = 0.0;
         UpdateSeeds();
         Stages = 1;
 
@@ -44,6 +48,9 @@ class AllpassDiffuser {
             delete filter;
     }
 
+    // Bytes taken from the custom pool by one instance
+    static constexpr size_t RequiredPoolBytes(int bufferSize) { return MaxStageCount * ModulatedAllpass::RequiredPoolBytes(bufferSize); }
+
     int GetSamplerate() { return samplerate; }
 
     void SetSamplerate(int samplerate) {
@@ -86,6 +93,8 @@ class AllpassDiffuser {
     }
 
     void SetModAmount(float amount) {
+        modAmount = amount;
+
         for (int i = 0; i < filters.size(); i++) {
             filters[i]->ModAmount = amount * (0.85 + 0.3 * seedValues[MaxStageCount + i]);
         }
@@ -113,6 +122,16 @@ class AllpassDiffuser {
             filters[i]->ClearBuffers();
     }
 
+    void AllocateBuffers() {
+        for (auto filter : filters)
+            filter->AllocateBuffers();
+    }
+
+    void ReleaseBuffers() {
+        for (auto filter : filters)
+            filter->ReleaseBuffers();
+    }
+
   private:
     void Update() {
         for (size_t i = 0; i < filters.size(); i++) {
@@ -125,6 +144,10 @@ class AllpassDiffuser {
     void UpdateSeeds() {
         this->seedValues = AudioLib::ShaRandom::Generate(seed, MaxStageCount * 3, crossSeed);
         Update();
+
+        // The modulation depends on the seeds too, a preset sets it before its seeds
+        SetModAmount(modAmount);
+        SetModRate(modRate);
     }
 };
 } // namespace CloudSeed
@@ -38,6 +38,10 @@ class Lp1 {
         b0 = 1 - alpha;
     }
 
+    float GetB0() { return b0; }
+
+    float GetA1() { return a1; }
+
     float Process(float input) {
         if (input == 0 && Output < 0.000000000001) {
             Output = 0;
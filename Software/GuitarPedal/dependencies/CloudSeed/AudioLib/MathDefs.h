@@ -5,6 +5,11 @@
 #define DSY_SDRAM_BSS __attribute__((section(".sdram_bss")))
 #endif
 
+// D2 SRAM, for tables too big for DTCM that are still read every sample (same as WARM_SRAM in the pedal's memory_placement.h)
+#ifndef WARM_SRAM
+#define WARM_SRAM __attribute__((section(".sram1_bss")))
+#endif
+
 //#define M_E        2.71828182845904523536   // e
 //#define M_LOG2E    1.44269504088896340736   // log2(e)
 //#define M_LOG10E   0.434294481903251827651  // log10(e)
@@ -6,7 +6,19 @@
 namespace AudioLib {
 using namespace std;
 
-vector<float> ShaRandom::Generate(long long seed, int count) {
+namespace {
+// The series for a seed is a hash chain, so a longer series always starts with the shorter one. The cache keeps the longest
+// series generated for each seed and serves any count up to that from it.
+struct SeriesCacheEntry {
+    long long seed;
+    vector<float> values;
+    unsigned int lastUse;
+};
+
+vector<SeriesCacheEntry> seriesCache;
+unsigned int seriesCacheClock = 0;
+
+vector<float> GenerateSeries(long long seed, int count) {
     vector<unsigned char> byteList;
     auto iterations = count * sizeof(unsigned int) / (256 / 8) + 1;
     auto byteArr = (unsigned char *)&seed;
@@ -18,10 +30,13 @@ vector<float> ShaRandom::Generate(long long seed, int count) {
             byteList.push_back(b);
     }
 
+    // Keep every value the hashes produced, not just count, they come for free and let the cache serve longer requests
+    auto valueCount = byteList.size() / sizeof(unsigned int);
     auto intArray = (unsigned int *)(&byteList[0]);
     vector<float> output;
+    output.reserve(valueCount);
 
-    for (int i = 0; i < count; i++) {
+    for (size_t i = 0; i < valueCount; i++) {
         unsigned int val = intArray[i];
         float doubleVal = val / (float)UINT_MAX;
         output.push_back(doubleVal);
@@ -30,16 +45,68 @@ vector<float> ShaRandom::Generate(long long seed, int count) {
     return output;
 }
 
+const vector<float> &GetSeries(long long seed, int count) {
+    seriesCacheClock++;
+
+    // Reserve up front so adding a seed never moves the entries, Generate holds references to two series at once
+    if (seriesCache.capacity() < (size_t)ShaRandom::CacheCapacity)
+        seriesCache.reserve(ShaRandom::CacheCapacity);
+
+    SeriesCacheEntry *entry = nullptr;
+    for (auto &e : seriesCache) {
+        if (e.seed == seed) {
+            entry = &e;
+            break;
+        }
+    }
+
+    if (entry == nullptr) {
+        if (seriesCache.size() < (size_t)ShaRandom::CacheCapacity) {
+            seriesCache.push_back(SeriesCacheEntry{seed, vector<float>(), 0});
+            entry = &seriesCache.back();
+        } else {
+            // Evict the least recently used seed
+            entry = &seriesCache[0];
+            for (auto &e : seriesCache) {
+                if (e.lastUse < entry->lastUse)
+                    entry = &e;
+            }
+            entry->seed = seed;
+            entry->values.clear();
+        }
+    }
+
+    if ((int)entry->values.size() < count)
+        entry->values = GenerateSeries(seed, count);
+
+    entry->lastUse = seriesCacheClock;
+    return entry->values;
+}
+} // namespace
+
+vector<float> ShaRandom::Generate(long long seed, int count) {
+    auto &series = GetSeries(seed, count);
+    return vector<float>(series.begin(), series.begin() + count);
+}
+
 vector<float> ShaRandom::Generate(long long seed, int count, float crossSeed) {
     auto seedA = seed;
     auto seedB = ~seed;
-    auto seriesA = Generate(seedA, count);
-    auto seriesB = Generate(seedB, count);
+    auto &seriesA = GetSeries(seedA, count);
+    auto &seriesB = GetSeries(seedB, count);
 
     vector<float> output;
+    output.reserve(count);
     for (int i = 0; i < count; i++)
         output.push_back(seriesA[i] * (1 - crossSeed) + seriesB[i] * crossSeed);
 
     return output;
 }
-} // namespace AudioLib
\ No newline at end of file
+
+void ShaRandom::ClearCache() {
+    seriesCache.clear();
+    seriesCache.shrink_to_fit();
+}
+
+int ShaRandom::GetCachedSeedCount() { return (int)seriesCache.size(); }
+} // namespace AudioLib
@@ -6,8 +6,15 @@
 namespace AudioLib {
 class ShaRandom {
   public:
+    // Number of seeds whose random series are kept, enough for the seeds of every factory preset so switching between
+    // them doesn't have to run SHA-256 again
+    static const int CacheCapacity = 160;
+
     static std::vector<float> Generate(long long seed, int count);
     static std::vector<float> Generate(long long seed, int count, float crossSeed);
+
+    static void ClearCache();
+    static int GetCachedSeedCount();
 };
 } // namespace AudioLib
 
@@ -0,0 +1,364 @@
+#ifndef DELAYLINEBANK
+#define DELAYLINEBANK
+
+#include "AllpassDiffuser.h"
+#include "AudioLib/Biquad2.h"
+#include "AudioLib/Lp1.h"
+#include "ModulatedDelay.h"
+#include "Utils.h"
+
+using namespace AudioLib;
+
+extern void *custom_pool_allocate(size_t size);
+
+namespace CloudSeed {
+// All late reverb delay lines of one channel, replaces the per line DelayLine objects.
+//
+// Every line shares the same filter settings, so the shelf and cutoff filters only keep one set of coefficients
+// while the filter state is stored as arrays indexed by line. The filter buffer is interleaved by line
+// ([sample][line]), which lets the feedback filters run across all lines in one tight inner loop instead of
+// calling into each line separately. The modulated delays and late diffusers still process one line at a time
+// since they work on their own delay memory.
+class DelayLineBank {
+  public:
+    static const int MaxLineCount = 8;
+
+  private:
+    ModulatedDelay *delays[MaxLineCount];
+    AllpassDiffuser *diffusers[MaxLineCount];
+    float *outputs[MaxLineCount];
+    int lineCount;
+    int bufferSize;
+    int samplerate;
+
+    // Designers for the shared filter coefficients
+    Biquad2 lowShelf;
+    Biquad2 highShelf;
+    AudioLib::Lp1 lowPass;
+
+    float lowShelfB[3], lowShelfA[3];
+    float highShelfB[3], highShelfA[3];
+    float lowPassB0, lowPassA1;
+
+    // Per line state, struct of arrays
+    float feedback[MaxLineCount];
+    float lowShelfX1[MaxLineCount], lowShelfX2[MaxLineCount], lowShelfY1[MaxLineCount], lowShelfY2[MaxLineCount];
+    float highShelfX1[MaxLineCount], highShelfX2[MaxLineCount], highShelfY1[MaxLineCount], highShelfY2[MaxLineCount];
+    float lowPassY1[MaxLineCount];
+
+    float *mixedBuffer;        // [line][sample]
+    float *filterOutputBuffer; // [sample][line]
+
+  public:
+    bool DiffuserEnabled;
+    bool LowShelfEnabled;
+    bool HighShelfEnabled;
+    bool CutoffEnabled;
+    bool LateStageTap;
+
+    DelayLineBank(int lineCount, int bufferSize, int samplerate)
+        : lowShelf(AudioLib::Biquad2::FilterType::LowShelf, samplerate),
+          highShelf(AudioLib::Biquad2::FilterType::HighShelf, samplerate), lowPass(samplerate) {
+        if (lineCount > MaxLineCount)
+            lineCount = MaxLineCount;
+
+        this->lineCount = lineCount;
+        this->bufferSize = bufferSize;
+
+        for (int i = 0; i < lineCount; i++) {
+            // 2 second buffer, to prevent buffer overflow with modulation and randomness added (Which may increase effective delay)
+            delays[i] = new ModulatedDelay(bufferSize, samplerate * 2, 10000);
+            diffusers[i] = new AllpassDiffuser(bufferSize, samplerate, 150); // 150ms
+            outputs[i] = nullptr;
+        }
+
+        mixedBuffer = nullptr;
+        filterOutputBuffer = nullptr;
+
+        lowShelf.Slope = 1.0;
+        lowShelf.SetGainDb(-20);
+        lowShelf.Frequency = 20;
+
+        highShelf.Slope = 1.0;
+        highShelf.SetGainDb(-20);
+        highShelf.Frequency = 19000;
+
+        lowPass.SetCutoffHz(1000);
+        SetSamplerate(samplerate);
+
+        for (int i = 0; i < lineCount; i++) {
+            feedback[i] = 0.0;
+            SetDiffuserSeed(i, 1, 0.0);
+        }
+
+        ClearBuffers();
+    }
+
+    // The buffers live in the custom pool, they are released by resetting the pool
+    ~DelayLineBank() {
+        for (int i = 0; i < lineCount; i++) {
+            delete delays[i];
+            delete diffusers[i];
+        }
+    }
+
+    // Takes the buffers from the custom pool, every time it is leased. They have to be cleared before processing.
+    void AllocateBuffers() {
+        for (int i = 0; i < lineCount; i++) {
+            delays[i]->AllocateBuffers();
+            diffusers[i]->AllocateBuffers();
+            outputs[i] = delays[i]->GetOutput();
+        }
+
+        mixedBuffer = new (custom_pool_allocate(sizeof(float) * bufferSize * lineCount)) float[bufferSize * lineCount];
+        filterOutputBuffer = new (custom_pool_allocate(sizeof(float) * bufferSize * lineCount)) float[bufferSize * lineCount];
+    }
+
+    // Drops the buffers when the custom pool is handed back
+    void ReleaseBuffers() {
+        for (int i = 0; i < lineCount; i++) {
+            delays[i]->ReleaseBuffers();
+            diffusers[i]->ReleaseBuffers();
+            outputs[i] = nullptr;
+        }
+
+        mixedBuffer = nullptr;
+        filterOutputBuffer = nullptr;
+    }
+
+    // Bytes taken from the custom pool by one instance
+    static constexpr size_t RequiredPoolBytes(int lineCount, int bufferSize, int samplerate) {
+        if (lineCount > MaxLineCount)
+            lineCount = MaxLineCount;
+
+        return lineCount * (ModulatedDelay::RequiredPoolBytes(bufferSize, samplerate * 2) + AllpassDiffuser::RequiredPoolBytes(bufferSize)) +
+               2 * Utils::PoolBytes(sizeof(float) * bufferSize * lineCount);
+    }
+
+    int GetLineCount() { return lineCount; }
+
+    int GetSamplerate() { return samplerate; }
+
+    void SetSamplerate(int samplerate) {
+        this->samplerate = samplerate;
+        for (int i = 0; i < lineCount; i++)
+            diffusers[i]->SetSamplerate(samplerate);
+
+        lowPass.SetSamplerate(samplerate);
+        lowPass.Update();
+        lowShelf.SetSamplerate(samplerate);
+        highShelf.SetSamplerate(samplerate);
+        UpdateFilterCoefficients();
+    }
+
+    void SetDiffuserSeed(int line, int seed, float crossSeed) {
+        diffusers[line]->SetSeed(seed);
+        diffusers[line]->SetCrossSeed(crossSeed);
+    }
+
+    void SetDelay(int line, int delaySamples) { delays[line]->SampleDelay = delaySamples; }
+
+    void SetFeedback(int line, float feedb) { feedback[line] = feedb; }
+
+    void SetLineModAmount(int line, float amount) { delays[line]->ModAmount = amount; }
+
+    void SetLineModRate(int line, float rate) { delays[line]->ModRate = rate; }
+
+    void SetDiffuserEnabled(bool value) {
+        if (value != DiffuserEnabled)
+            ClearDiffuserBuffers();
+        DiffuserEnabled = value;
+    }
+
+    void SetDiffuserDelay(int delaySamples) {
+        for (int i = 0; i < lineCount; i++)
+            diffusers[i]->SetDelay(delaySamples);
+    }
+
+    void SetDiffuserFeedback(float feedb) {
+        for (int i = 0; i < lineCount; i++)
+            diffusers[i]->SetFeedback(feedb);
+    }
+
+    void SetDiffuserStages(int stages) {
+        for (int i = 0; i < lineCount; i++)
+            diffusers[i]->Stages = stages;
+    }
+
+    void SetDiffuserModAmount(float amount) {
+        for (int i = 0; i < lineCount; i++) {
+            diffusers[i]->SetModulationEnabled(amount > 0.0);
+            diffusers[i]->SetModAmount(amount);
+        }
+    }
+
+    void SetDiffuserModRate(float rate) {
+        for (int i = 0; i < lineCount; i++)
+            diffusers[i]->SetModRate(rate);
+    }
+
+    void SetInterpolationEnabled(bool value) {
+        for (int i = 0; i < lineCount; i++)
+            diffusers[i]->SetInterpolationEnabled(value);
+    }
+
+    void SetLowShelfGain(float gain) {
+        lowShelf.SetGain(gain);
+        UpdateFilterCoefficients();
+    }
+
+    void SetLowShelfFrequency(float frequency) {
+        lowShelf.Frequency = frequency;
+        UpdateFilterCoefficients();
+    }
+
+    void SetHighShelfGain(float gain) {
+        highShelf.SetGain(gain);
+        UpdateFilterCoefficients();
+    }
+
+    void SetHighShelfFrequency(float frequency) {
+        highShelf.Frequency = frequency;
+        UpdateFilterCoefficients();
+    }
+
+    void SetCutoffFrequency(float frequency) {
+        lowPass.SetCutoffHz(frequency);
+        UpdateFilterCoefficients();
+    }
+
+    // Output of a line for the last processed block, valid until the next call to Process
+    float *GetOutput(int line) { return outputs[line]; }
+
+    // Processes the first "count" lines, all fed with the same input
+    void Process(float *input, int count, int sampleCount) {
+        if (count > lineCount)
+            count = lineCount;
+
+        // Mix the input with the filtered feedback of each line
+        for (int l = 0; l < count; l++) {
+            float *mixed = &mixedBuffer[l * bufferSize];
+            const float fb = feedback[l];
+            for (int i = 0; i < sampleCount; i++)
+                mixed[i] = input[i] + filterOutputBuffer[i * lineCount + l] * fb;
+        }
+
+        // Run the delay and diffuser stages, these own their delay memory so they stay per line
+        for (int l = 0; l < count; l++) {
+            float *mixed = &mixedBuffer[l * bufferSize];
+            ModulatedDelay *delay = delays[l];
+            AllpassDiffuser *diffuser = diffusers[l];
+            float *tap;
+
+            if (LateStageTap) {
+                if (DiffuserEnabled) {
+                    diffuser->Process(mixed, sampleCount);
+                    delay->Process(diffuser->GetOutput(), sampleCount);
+                    outputs[l] = diffuser->GetOutput();
+                } else {
+                    delay->Process(mixed, sampleCount);
+                    outputs[l] = mixed;
+                }
+                tap = delay->GetOutput();
+            } else {
+                delay->Process(mixed, sampleCount);
+                if (DiffuserEnabled) {
+                    diffuser->Process(delay->GetOutput(), sampleCount);
+                    tap = diffuser->GetOutput();
+                } else {
+                    tap = delay->GetOutput();
+                }
+                outputs[l] = delay->GetOutput();
+            }
+
+            for (int i = 0; i < sampleCount; i++)
+                filterOutputBuffer[i * lineCount + l] = tap[i];
+        }
+
+        // Feedback filters, across all lines for each sample
+        if (LowShelfEnabled)
+            ProcessBiquad(lowShelfB, lowShelfA, lowShelfX1, lowShelfX2, lowShelfY1, lowShelfY2, count, sampleCount);
+        if (HighShelfEnabled)
+            ProcessBiquad(highShelfB, highShelfA, highShelfX1, highShelfX2, highShelfY1, highShelfY2, count, sampleCount);
+        if (CutoffEnabled)
+            ProcessLowPass(count, sampleCount);
+    }
+
+    void ClearDiffuserBuffers() {
+        for (int i = 0; i < lineCount; i++)
+            diffusers[i]->ClearBuffers();
+    }
+
+    void ClearBuffers() {
+        for (int i = 0; i < lineCount; i++) {
+            delays[i]->ClearBuffers();
+            diffusers[i]->ClearBuffers();
+
+            lowShelfX1[i] = lowShelfX2[i] = lowShelfY1[i] = lowShelfY2[i] = 0.0;
+            highShelfX1[i] = highShelfX2[i] = highShelfY1[i] = highShelfY2[i] = 0.0;
+            lowPassY1[i] = 0.0;
+        }
+
+        Utils::ZeroBuffer(mixedBuffer, bufferSize * lineCount);
+        Utils::ZeroBuffer(filterOutputBuffer, bufferSize * lineCount);
+    }
+
+  private:
+    void UpdateFilterCoefficients() {
+        lowShelf.Update();
+        highShelf.Update();
+
+        auto b = lowShelf.GetB();
+        auto a = lowShelf.GetA();
+        for (int i = 0; i < 3; i++) {
+            lowShelfB[i] = b[i];
+            lowShelfA[i] = a[i];
+        }
+
+        b = highShelf.GetB();
+        a = highShelf.GetA();
+        for (int i = 0; i < 3; i++) {
+            highShelfB[i] = b[i];
+            highShelfA[i] = a[i];
+        }
+
+        lowPassB0 = lowPass.GetB0();
+        lowPassA1 = lowPass.GetA1();
+    }
+
+    void ProcessBiquad(const float *b, const float *a, float *x1, float *x2, float *y1, float *y2, int count, int sampleCount) {
+        const float b0 = b[0], b1 = b[1], b2 = b[2];
+        const float a1 = a[1], a2 = a[2];
+
+        for (int i = 0; i < sampleCount; i++) {
+            float *frame = &filterOutputBuffer[i * lineCount];
+            for (int l = 0; l < count; l++) {
+                const float x = frame[l];
+                const float y = b0 * x + b1 * x1[l] + b2 * x2[l] - a1 * y1[l] - a2 * y2[l];
+                x2[l] = x1[l];
+                y2[l] = y1[l];
+                x1[l] = x;
+                y1[l] = y;
+                frame[l] = y;
+            }
+        }
+    }
+
+    void ProcessLowPass(int count, int sampleCount) {
+        const float b0 = lowPassB0, a1 = lowPassA1;
+
+        for (int i = 0; i < sampleCount; i++) {
+            float *frame = &filterOutputBuffer[i * lineCount];
+            for (int l = 0; l < count; l++) {
+                const float x = frame[l];
+                // Same silence handling as Lp1::Process, written as a select so the loop stays branch free
+                const float y = (x == 0 && lowPassY1[l] < 0.000000000001f) ? 0.0f : b0 * x + a1 * lowPassY1[l];
+                lowPassY1[l] = y;
+                frame[l] = y;
+            }
+        }
+    }
+};
+} // namespace CloudSeed
+
+#endif
@@ -5,5 +5,5 @@
 #include <cmath>
 
 namespace CloudSeed {
-DSY_SDRAM_BSS float FastSin::data[FastSin::DataSize];
+WARM_SRAM float FastSin::data[FastSin::DataSize];
 }
@@ -8,7 +8,8 @@ namespace CloudSeed {
 class FastSin {
   private:
     static const int DataSize = 32768;
-    static DSY_SDRAM_BSS float data[DataSize];
+    // 128KB read by every modulated delay and allpass each sample, too big for DTCM but it doesn't need the SDRAM latency
+    static WARM_SRAM float data[DataSize];
 
   public:
     static void ZeroBuffer(float *buffer, int len);
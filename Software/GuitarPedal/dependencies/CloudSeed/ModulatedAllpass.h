@@ -9,7 +9,7 @@ extern void *custom_pool_allocate(size_t size);
 namespace CloudSeed {
 class ModulatedAllpass {
   public:
-    const int DelayBufferSamples = 19200; // 100ms at 192Khz
+    static const int DelayBufferSamples = 19200; // 100ms at 192Khz
     static const int ModulationUpdateRate = 8;
 
   private:
@@ -37,8 +37,8 @@ class ModulatedAllpass {
     ModulatedAllpass(int bufferSize, int sampleDelay) {
         this->InterpolationEnabled = true;
         this->bufferSize = bufferSize;
-        delayBuffer = new (custom_pool_allocate(sizeof(float) * DelayBufferSamples)) float[DelayBufferSamples];
-        output = new (custom_pool_allocate(sizeof(float) * bufferSize)) float[bufferSize];
+        delayBuffer = nullptr;
+        output = nullptr;
         SampleDelay = sampleDelay;
         index = DelayBufferSamples - 1;
         modPhase = 0.01 + 0.98 * std::rand() / (float)RAND_MAX;
@@ -47,9 +47,24 @@ class ModulatedAllpass {
         Update();
     }
 
-    ~ModulatedAllpass() {
-        delete delayBuffer;
-        delete output;
+    // The buffers live in the custom pool, they are released by resetting the pool
+    ~ModulatedAllpass() {}
+
+    // Takes the buffers from the custom pool, every time it is leased. They have to be cleared before processing.
+    void AllocateBuffers() {
+        delayBuffer = new (custom_pool_allocate(sizeof(float) * DelayBufferSamples)) float[DelayBufferSamples];
+        output = new (custom_pool_allocate(sizeof(float) * bufferSize)) float[bufferSize];
+    }
+
+    // Drops the buffers when the custom pool is handed back, clearing them is a no-op until they are allocated again
+    void ReleaseBuffers() {
+        delayBuffer = nullptr;
+        output = nullptr;
+    }
+
+    // Bytes taken from the custom pool by one instance
+    static constexpr size_t RequiredPoolBytes(int bufferSize) {
+        return Utils::PoolBytes(sizeof(float) * DelayBufferSamples) + Utils::PoolBytes(sizeof(float) * bufferSize);
     }
 
     inline float *GetOutput() { return output; }
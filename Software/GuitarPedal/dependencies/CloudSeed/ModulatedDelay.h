@@ -34,8 +34,8 @@ class ModulatedDelay {
     ModulatedDelay(int bufferSize, int delayBufferSizeSamples, int sampleDelay) {
         this->delayBufferSizeSamples = delayBufferSizeSamples;
         this->bufferSize = bufferSize;
-        this->delayBuffer = new (custom_pool_allocate(sizeof(float) * delayBufferSizeSamples)) float[delayBufferSizeSamples];
-        this->output = new (custom_pool_allocate(sizeof(float) * bufferSize)) float[bufferSize];
+        this->delayBuffer = nullptr;
+        this->output = nullptr;
         this->SampleDelay = sampleDelay;
         writeIndex = 0;
         modPhase = 0.01 + 0.98 * (std::rand() / (float)RAND_MAX);
@@ -44,9 +44,24 @@ class ModulatedDelay {
         Update();
     }
 
-    ~ModulatedDelay() {
-        delete delayBuffer;
-        delete output;
+    // The buffers live in the custom pool, they are released by resetting the pool
+    ~ModulatedDelay() {}
+
+    // Takes the buffers from the custom pool, every time it is leased. They have to be cleared before processing.
+    void AllocateBuffers() {
+        delayBuffer = new (custom_pool_allocate(sizeof(float) * delayBufferSizeSamples)) float[delayBufferSizeSamples];
+        output = new (custom_pool_allocate(sizeof(float) * bufferSize)) float[bufferSize];
+    }
+
+    // Drops the buffers when the custom pool is handed back, clearing them is a no-op until they are allocated again
+    void ReleaseBuffers() {
+        delayBuffer = nullptr;
+        output = nullptr;
+    }
+
+    // Bytes taken from the custom pool by one instance
+    static constexpr size_t RequiredPoolBytes(int bufferSize, int delayBufferSizeSamples) {
+        return Utils::PoolBytes(sizeof(float) * delayBufferSizeSamples) + Utils::PoolBytes(sizeof(float) * bufferSize);
     }
 
     float *GetOutput() { return output; }
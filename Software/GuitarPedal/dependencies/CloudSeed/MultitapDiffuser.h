@@ -20,6 +20,7 @@ class MultitapDiffuser {
     float *buffer;
     float *output;
     int len;
+    int bufferSize;
 
     int index;
     vector<float> tapGains;
@@ -38,10 +39,11 @@ class MultitapDiffuser {
     int countTemp;
 
   public:
-    MultitapDiffuser(int delayBufferSize) {
+    MultitapDiffuser(int bufferSize, int delayBufferSize) {
         len = delayBufferSize;
-        buffer = new (custom_pool_allocate(sizeof(float) * delayBufferSize)) float[delayBufferSize];
-        output = new (custom_pool_allocate(sizeof(float) * delayBufferSize)) float[delayBufferSize];
+        this->bufferSize = bufferSize;
+        buffer = nullptr;
+        output = nullptr;
         index = 0;
         count = 1;
         length = 1;
@@ -51,9 +53,24 @@ class MultitapDiffuser {
         UpdateSeeds();
     }
 
-    ~MultitapDiffuser() {
-        delete buffer;
-        delete output;
+    // The buffers live in the custom pool, they are released by resetting the pool
+    ~MultitapDiffuser() {}
+
+    // Takes the buffers from the custom pool, every time it is leased. They have to be cleared before processing.
+    void AllocateBuffers() {
+        buffer = new (custom_pool_allocate(sizeof(float) * len)) float[len];
+        output = new (custom_pool_allocate(sizeof(float) * bufferSize)) float[bufferSize];
+    }
+
+    // Drops the buffers when the custom pool is handed back, clearing them is a no-op until they are allocated again
+    void ReleaseBuffers() {
+        buffer = nullptr;
+        output = nullptr;
+    }
+
+    // Bytes taken from the custom pool by one instance
+    static constexpr size_t RequiredPoolBytes(int bufferSize, int delayBufferSize) {
+        return Utils::PoolBytes(sizeof(float) * delayBufferSize) + Utils::PoolBytes(sizeof(float) * bufferSize);
     }
 
     void SetSeed(int seed) {
@@ -118,7 +135,7 @@ class MultitapDiffuser {
 
     void ClearBuffers() {
         Utils::ZeroBuffer(buffer, len);
-        Utils::ZeroBuffer(output, len);
+        Utils::ZeroBuffer(output, bufferSize);
     }
 
   private:
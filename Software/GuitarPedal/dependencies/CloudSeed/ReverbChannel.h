@@ -6,7 +6,7 @@
 #include "AudioLib/Hp1.h"
 #include "AudioLib/Lp1.h"
 #include "AudioLib/ShaRandom.h"
-#include "DelayLine.h"
+#include "DelayLineBank.h"
 #include "ModulatedDelay.h"
 #include "MultitapDiffuser.h"
 #include "Parameter.h"
@@ -27,13 +27,6 @@ enum class ChannelLR { Left, Right };
 
 class ReverbChannel {
   private:
-    // IMPORTANT: CHANGE "TotalLineCount" FOR DAISY SEED HARDWARE
-    //            Original CloudSeed plugin uses 8 Delay Lines, or 12 delay lines?
-    //            DaisyCloudSeed adjusted to 2 to use with Stereo on DaisyPatch hardware (otherwise causes buffer underruns for most
-    //            presets (except ChorusDelay) 4/26/2023 GuitarML fork of DaisyCloudSeed uses 4, able to increase for Mono Only
-    //            Terrarium platform (mono guitar pedal using Daisy Seed)
-    static const int TotalLineCount = 3;
-
     map<Parameter2, float> parameters;
     int samplerate;
     int bufferSize;
@@ -41,7 +34,7 @@ class ReverbChannel {
     ModulatedDelay preDelay;
     MultitapDiffuser multitap;
     AllpassDiffuser diffuser;
-    vector<DelayLine *> lines;
+    DelayLineBank lines;
     AudioLib::ShaRandom rand;
     AudioLib::Hp1 highPass;
     AudioLib::Lp1 lowPass;
@@ -65,43 +58,70 @@ class ReverbChannel {
     ChannelLR channelLr;
 
   public:
-    ReverbChannel(int bufferSize, int samplerate, ChannelLR leftOrRight)
+    // IMPORTANT: "totalLineCount" sets the memory and CPU used by the late reverb on DAISY SEED HARDWARE
+    //            Original CloudSeed plugin uses 8 Delay Lines, or 12 delay lines? Up to DelayLineBank::MaxLineCount are supported.
+    //            The line count used while processing can be lowered further with Parameter2::LineCount.
+    ReverbChannel(int bufferSize, int samplerate, ChannelLR leftOrRight, int totalLineCount)
         : preDelay(bufferSize, (int)(samplerate * 1.0), 100) // 1 second delay buffer
           ,
-          multitap(samplerate) // use samplerate = 1 second delay buffer
+          multitap(bufferSize, samplerate) // use samplerate = 1 second delay buffer
+          ,
+          highPass(samplerate), lowPass(samplerate),
+          diffuser(bufferSize, samplerate, 150) // 150ms buffer, to allow for 100ms + modulation time
           ,
-          highPass(samplerate), lowPass(samplerate), diffuser(samplerate, 150) // 150ms buffer, to allow for 100ms + modulation time
-    {
+          lines(totalLineCount, bufferSize, samplerate) {
         this->channelLr = leftOrRight;
 
-        for (int i = 0; i < TotalLineCount; i++)
-            lines.push_back(new (custom_pool_allocate(sizeof(DelayLine))) DelayLine(bufferSize, samplerate));
-
         this->bufferSize = bufferSize;
 
         for (auto value = 0; value < (int)Parameter2::Count; value++)
             this->parameters[static_cast<Parameter2>(value)] = 0.0;
 
         crossSeed = 0.0;
-        lineCount = TotalLineCount;
+        lineCount = lines.GetLineCount();
         diffuser.SetInterpolationEnabled(true);
         highPass.SetCutoffHz(20);
         lowPass.SetCutoffHz(20000);
 
+        tempBuffer = nullptr;
+        lineOutBuffer = nullptr;
+        outBuffer = nullptr;
+
+        this->samplerate = samplerate;
+    }
+
+    // The buffers live in the custom pool, they are released by resetting the pool
+    ~ReverbChannel() {}
+
+    // Takes the buffers from the custom pool, every time it is leased. They have to be cleared before processing.
+    void AllocateBuffers() {
+        preDelay.AllocateBuffers();
+        multitap.AllocateBuffers();
+        diffuser.AllocateBuffers();
+        lines.AllocateBuffers();
+
         tempBuffer = new (custom_pool_allocate(sizeof(float) * bufferSize)) float[bufferSize];
         lineOutBuffer = new (custom_pool_allocate(sizeof(float) * bufferSize)) float[bufferSize];
         outBuffer = new (custom_pool_allocate(sizeof(float) * bufferSize)) float[bufferSize];
-
-        this->samplerate = samplerate;
     }
 
-    ~ReverbChannel() {
-        for (auto line : lines)
-            delete line;
+    // Drops the buffers when the custom pool is handed back
+    void ReleaseBuffers() {
+        preDelay.ReleaseBuffers();
+        multitap.ReleaseBuffers();
+        diffuser.ReleaseBuffers();
+        lines.ReleaseBuffers();
+
+        tempBuffer = nullptr;
+        lineOutBuffer = nullptr;
+        outBuffer = nullptr;
+    }
 
-        delete tempBuffer;
-        delete lineOutBuffer;
-        delete outBuffer;
+    // Bytes taken from the custom pool by one instance
+    static constexpr size_t RequiredPoolBytes(int bufferSize, int samplerate, int totalLineCount) {
+        return ModulatedDelay::RequiredPoolBytes(bufferSize, samplerate) + MultitapDiffuser::RequiredPoolBytes(bufferSize, samplerate) +
+               AllpassDiffuser::RequiredPoolBytes(bufferSize) + DelayLineBank::RequiredPoolBytes(totalLineCount, bufferSize, samplerate) +
+               3 * Utils::PoolBytes(sizeof(float) * bufferSize);
     }
 
     int GetSamplerate() { return samplerate; }
@@ -111,9 +131,7 @@ class ReverbChannel {
         highPass.SetSamplerate(samplerate);
         lowPass.SetSamplerate(samplerate);
 
-        for (int i = 0; i < lines.size(); i++) {
-            lines[i]->SetSamplerate(samplerate);
-        }
+        lines.SetSamplerate(samplerate);
 
         auto update = [&](Parameter2 p) { SetParameter(p, parameters[p]); };
         update(Parameter2::PreDelay);
@@ -177,8 +195,9 @@ class ReverbChannel {
             break;
 
         case Parameter2::LineCount:
-            lineCount = (int)value; // Originally commented out
-                                    // perLineGain = GetPerLineGain();  // In original Cloud Seed
+            // Originally commented out, perLineGain = GetPerLineGain();  // In original Cloud Seed
+            // Limited to the lines allocated for this channel
+            lineCount = std::max(1, std::min((int)value, lines.GetLineCount()));
             break;
         case Parameter2::LineDelay:
             UpdateLines();
@@ -188,45 +207,32 @@ class ReverbChannel {
             break;
 
         case Parameter2::LateDiffusionEnabled:
-            for (auto line : lines) {
-                auto newVal = value >= 0.5;
-                if (newVal != line->DiffuserEnabled)
-                    line->ClearDiffuserBuffer();
-                line->DiffuserEnabled = newVal;
-            }
+            lines.SetDiffuserEnabled(value >= 0.5);
             break;
         case Parameter2::LateDiffusionStages:
-            for (auto line : lines)
-                line->SetDiffuserStages((int)value);
+            lines.SetDiffuserStages((int)value);
             break;
         case Parameter2::LateDiffusionDelay:
-            for (auto line : lines)
-                line->SetDiffuserDelay((int)Ms2Samples(value));
+            lines.SetDiffuserDelay((int)Ms2Samples(value));
             break;
         case Parameter2::LateDiffusionFeedback:
-            for (auto line : lines)
-                line->SetDiffuserFeedback(value);
+            lines.SetDiffuserFeedback(value);
             break;
 
         case Parameter2::PostLowShelfGain:
-            for (auto line : lines)
-                line->SetLowShelfGain(value);
+            lines.SetLowShelfGain(value);
             break;
         case Parameter2::PostLowShelfFrequency:
-            for (auto line : lines)
-                line->SetLowShelfFrequency(value);
+            lines.SetLowShelfFrequency(value);
             break;
         case Parameter2::PostHighShelfGain:
-            for (auto line : lines)
-                line->SetHighShelfGain(value);
+            lines.SetHighShelfGain(value);
             break;
         case Parameter2::PostHighShelfFrequency:
-            for (auto line : lines)
-                line->SetHighShelfFrequency(value);
+            lines.SetHighShelfFrequency(value);
             break;
         case Parameter2::PostCutoffFrequency:
-            for (auto line : lines)
-                line->SetCutoffFrequency(value);
+            lines.SetCutoffFrequency(value);
             break;
 
         case Parameter2::EarlyDiffusionModAmount:
@@ -293,25 +299,20 @@ class ReverbChannel {
             lowPassEnabled = value >= 0.5;
             break;
         case Parameter2::LowShelfEnabled:
-            for (auto line : lines)
-                line->LowShelfEnabled = value >= 0.5;
+            lines.LowShelfEnabled = value >= 0.5;
             break;
         case Parameter2::HighShelfEnabled:
-            for (auto line : lines)
-                line->HighShelfEnabled = value >= 0.5;
+            lines.HighShelfEnabled = value >= 0.5;
             break;
         case Parameter2::CutoffEnabled:
-            for (auto line : lines)
-                line->CutoffEnabled = value >= 0.5;
+            lines.CutoffEnabled = value >= 0.5;
             break;
         case Parameter2::LateStageTap:
-            for (auto line : lines)
-                line->LateStageTap = value >= 0.5;
+            lines.LateStageTap = value >= 0.5;
             break;
 
         case Parameter2::Interpolation:
-            for (auto line : lines)
-                line->SetInterpolationEnabled(value >= 0.5);
+            lines.SetInterpolationEnabled(value >= 0.5);
             break;
         }
     }
@@ -352,36 +353,27 @@ class ReverbChannel {
         // for (int i = 0; i < len; i++)
         //	tempBuffer[i] += crossMix[i];
 
-        for (int i = 0; i < lineCount; i++)
-            lines[i]->Process(tempBuffer, len);
-
-        for (int i = 0; i < lineCount; i++) {
-            auto buf = lines[i]->GetOutput();
-
-            if (i == 0) {
-                for (int j = 0; j < len; j++)
-                    tempBuffer[j] = buf[j];
-            } else {
-                for (int j = 0; j < len; j++)
-                    tempBuffer[j] += buf[j];
-            }
-        }
+        lines.Process(tempBuffer, lineCount, len);
 
+        // Sum the lines, the per line gain is applied in the same pass
         auto perLineGain = GetPerLineGain();
-        Utils::Gain(tempBuffer, perLineGain, len);
-        Utils::Copy(tempBuffer, lineOutBuffer, len);
+        Utils::Copy(lines.GetOutput(0), lineOutBuffer, len);
+        for (int i = 1; i < lineCount; i++) {
+            auto buf = lines.GetOutput(i);
+            for (int j = 0; j < len; j++)
+                lineOutBuffer[j] += buf[j];
+        }
+        Utils::Gain(lineOutBuffer, perLineGain, len);
 
         for (int i = 0; i < len; i++) {
-            outBuffer[i] = dryOut * input[i] + predelayOut * predelayOutput[i] + earlyOut * earlyOutStage[i] + lineOut * tempBuffer[i];
+            outBuffer[i] = dryOut * input[i] + predelayOut * predelayOutput[i] + earlyOut * earlyOutStage[i] + lineOut * lineOutBuffer[i];
         }
     }
 
     void ClearBuffers() {
-        for (int i = 0; i < bufferSize; i++) {
-            tempBuffer[i] = 0.0;
-            lineOutBuffer[i] = 0.0;
-            outBuffer[i] = 0.0;
-        }
+        Utils::ZeroBuffer(tempBuffer, bufferSize);
+        Utils::ZeroBuffer(lineOutBuffer, bufferSize);
+        Utils::ZeroBuffer(outBuffer, bufferSize);
 
         lowPass.Output = 0;
         highPass.Output = 0;
@@ -389,8 +381,7 @@ class ReverbChannel {
         preDelay.ClearBuffers();
         multitap.ClearBuffers();
         diffuser.ClearBuffers();
-        for (auto line : lines)
-            line->ClearBuffers();
+        lines.ClearBuffers();
     }
 
   private:
@@ -407,8 +398,8 @@ class ReverbChannel {
         auto lateDiffusionModAmount = Ms2Samples(parameters[Parameter2::LateDiffusionModAmount]);
         auto lateDiffusionModRate = parameters[Parameter2::LateDiffusionModRate];
 
-        auto delayLineSeeds = ShaRandom::Generate(delayLineSeed, (int)lines.size() * 3, crossSeed);
-        int count = (int)lines.size();
+        int count = lines.GetLineCount();
+        auto delayLineSeeds = ShaRandom::Generate(delayLineSeed, count * 3, crossSeed);
 
         for (int i = 0; i < count; i++) {
             auto modAmount = lineModAmount * (0.7 + 0.3 * delayLineSeeds[i + count]);
@@ -422,18 +413,19 @@ class ReverbChannel {
             auto dbAfter1Iteration = delaySamples / lineDecaySamples * (-60); // lineDecay is the time it takes to reach T60
             auto gainAfter1Iteration = Utils::DB2gain(dbAfter1Iteration);
 
-            lines[i]->SetDelay((int)delaySamples);
-            lines[i]->SetFeedback(gainAfter1Iteration);
-            lines[i]->SetLineModAmount(modAmount);
-            lines[i]->SetLineModRate(modRate);
-            lines[i]->SetDiffuserModAmount(lateDiffusionModAmount);
-            lines[i]->SetDiffuserModRate(lateDiffusionModRate);
+            lines.SetDelay(i, (int)delaySamples);
+            lines.SetFeedback(i, gainAfter1Iteration);
+            lines.SetLineModAmount(i, modAmount);
+            lines.SetLineModRate(i, modRate);
         }
+
+        lines.SetDiffuserModAmount(lateDiffusionModAmount);
+        lines.SetDiffuserModRate(lateDiffusionModRate);
     }
 
     void UpdatePostDiffusion() {
-        for (int i = 0; i < lines.size(); i++)
-            lines[i]->SetDiffuserSeed(((long long)postDiffusionSeed) * (i + 1), crossSeed);
+        for (int i = 0; i < lines.GetLineCount(); i++)
+            lines.SetDiffuserSeed(i, ((long long)postDiffusionSeed) * (i + 1), crossSeed);
     }
 
     float Ms2Samples(float value) { return value / 1000.0 * samplerate; }
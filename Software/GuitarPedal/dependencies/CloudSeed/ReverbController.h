@@ -17,8 +17,14 @@
 
 namespace CloudSeed {
 class ReverbController {
+  public:
+    // Number of late reverb lines per channel used when none is given, see ReverbChannel
+    static const int DefaultLineCount = 3;
+
   private:
-    static const int bufferSize = 1; // just make it huge by default...
+    // Maximum number of samples processed per call to the channels, matches the audio callback block size.
+    // Larger requests to Process() are split into chunks of this size.
+    static const int bufferSize = 48;
     int samplerate;
 
     ReverbChannel channelL;
@@ -30,8 +36,8 @@ class ReverbController {
     float parameters[(int)Parameter2::Count];
 
   public:
-    ReverbController(int samplerate)
-        : channelL(bufferSize, samplerate, ChannelLR::Left), channelR(bufferSize, samplerate, ChannelLR::Right) {
+    ReverbController(int samplerate, int lineCount = DefaultLineCount)
+        : channelL(bufferSize, samplerate, ChannelLR::Left, lineCount), channelR(bufferSize, samplerate, ChannelLR::Right, lineCount) {
         this->samplerate = samplerate;
         // initFactoryChorus();
         // initFactoryDullEchos();
@@ -44,6 +50,12 @@ class ReverbController {
         // initFactoryThroughTheLookingGlass();
     }
 
+    // Bytes of the custom pool needed by a ReverbController with this configuration, the controller itself is on the heap.
+    // The pool only holds the audio buffers, they are taken with AllocateBuffers() whenever the pool is leased.
+    static constexpr size_t RequiredPoolBytes(int samplerate, int lineCount = DefaultLineCount) {
+        return 2 * ReverbChannel::RequiredPoolBytes(bufferSize, samplerate, lineCount);
+    }
+
     void initFactoryChorus() {
         // parameters from Chorus Delay in
         // https://github.com/ValdemarOrn/CloudSeed/tree/master/Factory%20Programs
@@ -687,8 +699,34 @@ class ReverbController {
         channelR.ClearBuffers();
     }
 
-    void Process(float *inputL, float *inputR, float *outputL, float *outputR, int bufferSize) {
-        auto len = bufferSize;
+    // Takes the audio buffers from the custom pool, they have to be cleared before processing
+    void AllocateBuffers() {
+        channelL.AllocateBuffers();
+        channelR.AllocateBuffers();
+    }
+
+    // Drops the audio buffers when the custom pool is handed back, everything else is kept
+    void ReleaseBuffers() {
+        channelL.ReleaseBuffers();
+        channelR.ReleaseBuffers();
+    }
+
+    void Process(float *inputL, float *inputR, float *outputL, float *outputR, int sampleCount) {
+        while (sampleCount > bufferSize) {
+            ProcessChunk(inputL, inputR, outputL, outputR, bufferSize);
+            inputL += bufferSize;
+            inputR += bufferSize;
+            outputL += bufferSize;
+            outputR += bufferSize;
+            sampleCount -= bufferSize;
+        }
+
+        if (sampleCount > 0)
+            ProcessChunk(inputL, inputR, outputL, outputR, sampleCount);
+    }
+
+  private:
+    void ProcessChunk(float *inputL, float *inputR, float *outputL, float *outputR, int len) {
         auto cm = GetScaledParameter(Parameter2::InputMix) * 0.5;
         auto cmi = (1 - cm);
 
@@ -712,7 +750,6 @@ class ReverbController {
         }
     }
 
-  private:
     float P(Parameter2 para) {
         auto idx = (int)para;
         return idx >= 0 && idx < (int)Parameter2::Count ? parameters[idx] : 0.0;
@@ -3,12 +3,23 @@
 
 #include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <cstring>
 
 namespace CloudSeed {
 class Utils {
   public:
+    // Alignment used by custom_pool_allocate, every allocation from the pool is padded to this
+    static const size_t PoolAlignment = 8;
+
+    // Number of pool bytes used by an allocation of the given size
+    static constexpr size_t PoolBytes(size_t size) { return (size + PoolAlignment - 1) & ~(PoolAlignment - 1); }
+
+    // Buffers are only allocated while the custom pool is leased, there's nothing to clear without them
     static inline void ZeroBuffer(float *buffer, int len) {
+        if (buffer == nullptr)
+            return;
+
         for (int i = 0; i < len; i++)
             buffer[i] = 0.0;
     }
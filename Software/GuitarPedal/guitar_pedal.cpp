@@ -5,6 +5,8 @@
 
 #include "UI/guitar_pedal_ui.h"
 #include "Util/audio_utilities.h"
+#include "Util/memory_placement.h"
+#include "Util/signal_analyzer.h"
 
 using namespace daisy;
 using namespace daisysp;
@@ -52,6 +54,14 @@ int prevActiveEffectID = 0;
 int tunerModuleIndex = -1;
 BaseEffectModule *activeEffect = nullptr;
 
+// SDRAM shared by the effects, only the active effect holds its buffers in it (see UpdateSharedMemoryLease)
+alignas(MemoryArena::DefaultAlignment) COLD_SDRAM uint8_t sharedMemory[k_sharedMemorySize];
+MemoryArena sharedMemoryArena;
+BaseEffectModule *sharedMemoryOwner = nullptr;
+
+// Analysis of the input shared by all effects, runs once per block before the active effect
+SignalAnalyzer signalAnalyzer;
+
 // UI Related Variables
 GuitarPedalUI guitarPedalUI;
 
@@ -111,6 +121,13 @@ int crossFaderTransitionTimeInSamples;
 int samplesTilCrossFadingComplete;
 CpuLoadMeter cpuLoadMeter;
 
+// Audio Block Related Variables, the active effect processes a whole block at once
+constexpr size_t audioBlockSize = 48;
+float inputBlockLeft[audioBlockSize];
+float inputBlockRight[audioBlockSize];
+float effectBlockLeft[audioBlockSize];
+float effectBlockRight[audioBlockSize];
+
 void SetActiveEffect(int effectID);
 
 static void AudioCallback(AudioHandle::InputBuffer in, AudioHandle::OutputBuffer out, size_t size) {
@@ -358,6 +375,34 @@ static void AudioCallback(AudioHandle::InputBuffer in, AudioHandle::OutputBuffer
         }
     }
 
+    // Handle Mono vs Stereo
+    for (size_t i = 0; i < size; i++) {
+        inputBlockLeft[i] = in[0][i];
+        inputBlockRight[i] = in[1][i];
+
+        // Split the Mono Input to Stereo (Only allowed if relay bypass non enabled)
+        if (settings.globalSplitMonoInputToStereo && !settings.globalRelayBypassEnabled) {
+            inputBlockRight[i] = inputBlockLeft[i];
+        }
+    }
+
+    // Only calculate the active effect when it's needed
+    // An effect that was just switched to may not have its memory yet, the dry signal is passed through until it does
+    const bool effectProcessed = activeEffect != nullptr && activeEffect->HasSharedMemory() && (effectOn || isCrossFading);
+
+    if (effectProcessed) {
+        // Publish the analysis of the input for the effect, pitch only if it reads it
+        signalAnalyzer.SetPitchEnabled(activeEffect->NeedsPitchAnalysis());
+        signalAnalyzer.ProcessBlock(inputBlockLeft, size);
+
+        // Apply the Active Effect
+        if (hardware.SupportsStereo()) {
+            activeEffect->ProcessStereoBlock(inputBlockLeft, inputBlockRight, effectBlockLeft, effectBlockRight, size);
+        } else {
+            activeEffect->ProcessMonoBlock(inputBlockLeft, effectBlockLeft, effectBlockRight, size);
+        }
+    }
+
     for (size_t i = 0; i < size; i++) {
         if (isCrossFading) {
             float crossFadeFactor = (float)samplesTilCrossFadingComplete / (float)crossFaderTransitionTimeInSamples;
@@ -393,14 +438,8 @@ static void AudioCallback(AudioHandle::InputBuffer in, AudioHandle::OutputBuffer
             }
         }
 
-        // Handle Mono vs Stereo
-        inputLeft = in[0][i];
-        inputRight = in[1][i];
-
-        // Split the Mono Input to Stereo (Only allowed if relay bypass non enabled)
-        if (settings.globalSplitMonoInputToStereo && !settings.globalRelayBypassEnabled) {
-            inputRight = inputLeft;
-        }
+        inputLeft = inputBlockLeft[i];
+        inputRight = inputBlockRight[i];
 
         // Setup Master Crossfader. By default source & target is always the input signal
         float crossFadeSourceLeft = inputLeft;
@@ -410,17 +449,9 @@ static void AudioCallback(AudioHandle::InputBuffer in, AudioHandle::OutputBuffer
         float effectOutputLeft = inputLeft;
         float effectOutputRight = inputRight;
 
-        // Only calculate the active effect when it's needed
-        if (activeEffect != nullptr && (effectOn || isCrossFading)) {
-            // Apply the Active Effect
-            if (hardware.SupportsStereo()) {
-                activeEffect->ProcessStereo(inputLeft, inputRight);
-            } else {
-                activeEffect->ProcessMono(inputLeft);
-            }
-
-            effectOutputLeft = activeEffect->GetAudioLeft();
-            effectOutputRight = activeEffect->GetAudioRight();
+        if (effectProcessed) {
+            effectOutputLeft = effectBlockLeft[i];
+            effectOutputRight = effectBlockRight[i];
 
             // Update state of the LEDs
             led1Brightness = activeEffect->GetBrightnessForLED(0);
@@ -472,6 +503,33 @@ void SetActiveEffect(int effectID) {
     }
 }
 
+// Hands the shared SDRAM over to the active effect after it changed. This runs in the main loop instead of SetActiveEffect
+// because leasing can clear megabytes of memory (the looper) which would stall the audio callback, the callback doesn't
+// process the effect until it is done.
+void UpdateSharedMemoryLease() {
+    BaseEffectModule *effect = activeEffect;
+
+    if (effect == nullptr || effect == sharedMemoryOwner) {
+        return;
+    }
+
+    // Effects without arena buffers run next to the owner instead of evicting it
+    if (!effect->UsesSharedMemory()) {
+        if (!effect->HasSharedMemory()) {
+            effect->AcquireSharedMemory(sharedMemoryArena);
+        }
+        return;
+    }
+
+    if (sharedMemoryOwner != nullptr) {
+        sharedMemoryOwner->ReleaseSharedMemory();
+    }
+
+    sharedMemoryArena.Reset();
+    sharedMemoryOwner = effect;
+    effect->AcquireSharedMemory(sharedMemoryArena);
+}
+
 // Typical Switch case for Message Type.
 void HandleMidiMessage(MidiEvent m) {
     if (!hardware.SupportsMidi()) {
@@ -557,7 +615,7 @@ void HandleMidiMessage(MidiEvent m) {
 }
 
 int main(void) {
-    const size_t blockSize = 48;
+    const size_t blockSize = audioBlockSize;
     const bool boost = true; // true enables cpu boost (480Mhz instead of 400Mhz)
 
     hardware.Init(blockSize, boost);
@@ -572,11 +630,15 @@ int main(void) {
     bypassToggleTransitionTimeInSamples = hardware.GetNumberOfSamplesForTime(bypassToggleTransitionTimeInSeconds);
     crossFaderTransitionTimeInSamples = hardware.GetNumberOfSamplesForTime(crossFaderTransitionTimeInSeconds);
 
+    // Init the shared analysis of the input
+    signalAnalyzer.Init(sample_rate);
+
     // Init the Effects Modules
     load_effects(availableEffectsCount, availableEffects);
 
     for (int i = 0; i < availableEffectsCount; i++) {
         availableEffects[i]->Init(sample_rate);
+        availableEffects[i]->SetSignalAnalysis(&signalAnalyzer.GetAnalysis());
 
         if (std::string(availableEffects[i]->GetName()) == std::string("Tuner")) {
             // Store the index for the tuner module so that we can quickswitch
@@ -598,6 +660,10 @@ int main(void) {
     activeEffectID = settings.globalActiveEffectID;
     activeEffect->SetEnabled(effectOn);
 
+    // Lease the shared SDRAM to it
+    sharedMemoryArena.Init(sharedMemory, sizeof(sharedMemory));
+    UpdateSharedMemoryLease();
+
     // Init the Menu UI System
     if (hardware.SupportsDisplay()) {
         guitarPedalUI.Init();
@@ -713,6 +779,9 @@ int main(void) {
             }
         }
 
+        // Move the shared SDRAM over if the active effect changed (from here, the footswitches or midi)
+        UpdateSharedMemoryLease();
+
         // Set the latest cpu load to the effect
         activeEffect->SetCPUUsage(cpuLoadMeter.GetAvgCpuLoad());
 
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "Effect-Modules/base_effect_module.h"
+#include <algorithm>
 
 // Include all effect modules
 #include "Effect-Modules/amp_module.h"
@@ -17,6 +18,7 @@
 #include "Effect-Modules/delay_module.h"
 #include "Effect-Modules/distortion_module.h"
 #include "Effect-Modules/drum_module.h"
+#include "Effect-Modules/fdn_reverb_module.h"
 #include "Effect-Modules/flanger_module.h"
 #include "Effect-Modules/geq_module.h"
 #include "Effect-Modules/granulardelay_module.h"
@@ -35,6 +37,7 @@
 #include "Effect-Modules/reverb_module.h"
 #include "Effect-Modules/scifi_module.h"
 #include "Effect-Modules/spectral_delay_module.h"
+#include "Effect-Modules/spectral_fx_module.h"
 #include "Effect-Modules/tuner_module.h"
 
 // Keyboard modules
@@ -46,6 +49,23 @@
 
 namespace bkshepherd {
 
+// Size of the SDRAM arena shared by the effects. Only the active effect holds memory in it, so this is the largest lease instead
+// of the sum of them. Every effect that overrides OnAcquireSharedMemory (and
+// UsesSharedMemory) has to be listed here.
+constexpr size_t k_sharedMemorySize = std::max({
+    CloudSeedModule::s_sharedMemorySize,
+    DelayModule::s_sharedMemorySize,
+    FdnReverbModule::s_sharedMemorySize,
+    GranularDelayModule::s_sharedMemorySize,
+    LooperModule::s_sharedMemorySize,
+    MultiDelayModule::s_sharedMemorySize,
+    PitchShifterModule::s_sharedMemorySize,
+    ReverbModule::s_sharedMemorySize,
+    SciFiModule::s_sharedMemorySize,
+    SpectralDelayModule::s_sharedMemorySize,
+    SpectralFxModule::s_sharedMemorySize,
+});
+
 void load_effects(int &availableEffectsCount, BaseEffectModule **&availableEffects) {
     // clang-format off
     static BaseEffectModule* effectList[] = {
@@ -77,6 +97,8 @@ void load_effects(int &availableEffectsCount, BaseEffectModule **&availableEffec
         new DrumModule(),  // This module can be used with MIDI keyboard as a drum machine
         new PhaserModule(),
         new FlangerModule(),
+        new FdnReverbModule(),
+        new SpectralFxModule(),
 
         // The following require a MIDI keyboard
         // new MidiKeysModule(),